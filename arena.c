@@ -0,0 +1,45 @@
+#include "arena.h"
+
+void init_arena(Arena* arena) {
+    arena->blocks = NULL;
+}
+
+void add_arena_block(Arena* arena, size_t size) {
+    size_t capacity = size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE;
+    ArenaBlock* block = malloc(sizeof(ArenaBlock) + capacity);
+    block->next = arena->blocks;
+    block->used = 0;
+    block->capacity = capacity;
+    arena->blocks = block;
+}
+
+void reserve_arena(Arena* arena, size_t size) {
+    ArenaBlock* block = arena->blocks;
+    if (!block || block->capacity - block->used < size) {
+        add_arena_block(arena, size);
+    }
+}
+
+void* arena_alloc(Arena* arena, size_t size) {
+    size = ARENA_ROUND(size);
+    reserve_arena(arena, size);
+    ArenaBlock* block = arena->blocks;
+    void* memory = block->data + block->used;
+    block->used += size;
+    return memory;
+}
+
+char* arena_strndup(Arena* arena, const char* str, size_t length) {
+    char* copy = arena_alloc(arena, length + 1);
+    memcpy(copy, str, length);
+    copy[length] = '\0';
+    return copy;
+}
+
+void free_arena(Arena* arena) {
+    while (arena->blocks) {
+        ArenaBlock* next = arena->blocks->next;
+        free(arena->blocks);
+        arena->blocks = next;
+    }
+}
@@ -0,0 +1,95 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include "helper.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_BLOCK_SIZE (64 * KIBIBYTE)
+#define ARENA_ALIGNMENT sizeof(void*)
+#define ARENA_ROUND(size) (((size) + ARENA_ALIGNMENT - 1) & \
+        ~(ARENA_ALIGNMENT - 1))
+
+//A block of arena memory. Blocks are chained so that the arena can grow 
+//without moving what has already been allocated.
+typedef struct ArenaBlock {
+    struct ArenaBlock* next;
+    size_t used;
+    size_t capacity;
+    char data[];
+} ArenaBlock;
+
+//A bump allocator for memory that lives as long as the jobs, such as the
+//strings of every job. Nothing is freed individually; free_arena() releases
+//everything at once.
+typedef struct {
+    ArenaBlock* blocks;
+} Arena;
+
+#endif //ARENA_H
+
+/* init_arena()
+ * ------------
+ * Initialises an empty arena. No memory is allocated until it is used.
+ *
+ * arena: the arena to be initialised.
+ */
+void init_arena(Arena* arena);
+
+/* reserve_arena()
+ * ---------------
+ * Makes sure the arena can allocate at least size more bytes without adding
+ * another block, so memory whose total is known up front comes from a 
+ * single allocation.
+ *
+ * arena: the arena to reserve memory in.
+ *
+ * size: the number of bytes to reserve.
+ */
+void reserve_arena(Arena* arena, size_t size);
+
+/* arena_alloc()
+ * -------------
+ * Allocates memory from the arena.
+ *
+ * arena: the arena to allocate from.
+ *
+ * size: the number of bytes to allocate.
+ *
+ * Returns: a pointer to the memory, aligned for any pointer.
+ */
+void* arena_alloc(Arena* arena, size_t size);
+
+/* arena_strndup()
+ * ---------------
+ * Copies a string, which need not be NUL-terminated, into the arena.
+ *
+ * arena: the arena to copy the string into.
+ *
+ * str: the start of the string.
+ *
+ * length: the length of the string.
+ *
+ * Returns: the NUL-terminated copy.
+ */
+char* arena_strndup(Arena* arena, const char* str, size_t length);
+
+/* add_arena_block()
+ * -----------------
+ * Adds a new block with room for at least size bytes to the front of the
+ * arena.
+ *
+ * arena: the arena to add the block to.
+ *
+ * size: the number of bytes the block must hold.
+ */
+void add_arena_block(Arena* arena, size_t size);
+
+/* free_arena()
+ * ------------
+ * Frees every block of an arena, and so everything allocated from it.
+ *
+ * arena: the arena to be freed.
+ */
+void free_arena(Arena* arena);
@@ -0,0 +1,198 @@
+#include "attrs.h"
+
+void init_job_attrs(JobAttrs* attrs) {
+    attrs->queueLimit = DEFAULT_QUEUE_LIMIT;
+    attrs->queuePolicy = QUEUE_BLOCK;
+    attrs->forkSpawn = false;
+    attrs->restartDelayMs = DEFAULT_RESTART_DELAY_MS;
+    attrs->backoffFactor = DEFAULT_BACKOFF_FACTOR;
+    attrs->maxRestartDelayMs = DEFAULT_MAX_RESTART_DELAY_MS;
+    attrs->jitterPercent = DEFAULT_JITTER_PERCENT;
+    attrs->numEnv = 0;
+    attrs->pooled = false;
+    attrs->dispatch = DISPATCH_BROADCAST;
+    attrs->keyField = WHOLE_LINE_KEY;
+    attrs->minReplicas = 1;
+    attrs->maxReplicas = 1;
+    attrs->scaleAt = DEFAULT_SCALE_AT;
+    attrs->idleMs = DEFAULT_IDLE_MS;
+    attrs->orderWindow = UNORDERED;
+    attrs->orderTimeoutMs = NO_ORDER_TIMEOUT;
+    attrs->dropStragglers = false;
+    init_placement(&attrs->placement);
+}
+
+bool parse_job_attrs(char* field, JobAttrs* attrs) {
+    char* savePtr;
+    for (char* attr = strtok_r(field, ATTR_SEPARATOR, &savePtr); attr;
+            attr = strtok_r(NULL, ATTR_SEPARATOR, &savePtr)) {
+        char* value = strchr(attr, ATTR_ASSIGN);
+        if (!value) {
+            return false;
+        }
+        *value++ = '\0';
+        if (!parse_job_attr(attr, value, attrs)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool parse_job_attr(char* key, char* value, JobAttrs* attrs) {
+    if (!strcmp(key, "queue")) {
+        return parse_size(value, &attrs->queueLimit) && attrs->queueLimit;
+    } else if (!strcmp(key, "policy")) {
+        return parse_queue_policy(value, &attrs->queuePolicy);
+    } else if (!strcmp(key, "spawn")) {
+        return parse_spawn_method(value, &attrs->forkSpawn);
+    } else if (!strcmp(key, "delay")) {
+        return parse_duration(value, &attrs->restartDelayMs);
+    } else if (!strcmp(key, "backoff")) {
+        return parse_backoff_factor(value, &attrs->backoffFactor);
+    } else if (!strcmp(key, "maxdelay")) {
+        return parse_duration(value, &attrs->maxRestartDelayMs);
+    } else if (!strcmp(key, "jitter")) {
+        attrs->jitterPercent = atoi(value);
+        return isdigit(value[0]) && is_non_neg_int(value) && 
+                attrs->jitterPercent <= MAX_JITTER_PERCENT;
+    } else if (!strcmp(key, POOL_ATTR)) {
+        attrs->pooled = true;
+        return value[0] != '\0';
+    } else if (!strcmp(key, "dispatch")) {
+        return parse_dispatch_mode(value, &attrs->dispatch);
+    } else if (!strcmp(key, "key")) {
+        attrs->keyField = atoi(value);
+        return isdigit(value[0]) && is_non_neg_int(value);
+    } else if (!strcmp(key, "replicas")) {
+        return parse_replicas(value, &attrs->minReplicas, 
+                &attrs->maxReplicas);
+    } else if (!strcmp(key, "scaleat")) {
+        attrs->scaleAt = atoi(value);
+        return isdigit(value[0]) && is_non_neg_int(value) && 
+                attrs->scaleAt > 0;
+    } else if (!strcmp(key, "idle")) {
+        return parse_duration(value, &attrs->idleMs) && attrs->idleMs;
+    } else if (!strcmp(key, "order")) {
+        attrs->orderWindow = atoi(value);
+        return isdigit(value[0]) && is_non_neg_int(value) && 
+                attrs->orderWindow > 0;
+    } else if (!strcmp(key, "ordertimeout")) {
+        return parse_duration(value, &attrs->orderTimeoutMs);
+    } else if (!strcmp(key, "straggler")) {
+        return parse_straggler_policy(value, &attrs->dropStragglers);
+    } else if (!strcmp(key, "cpus")) {
+        return parse_cpu_list(value, &attrs->placement);
+    } else if (!strcmp(key, "nice")) {
+        return parse_nice(value, &attrs->placement.nice);
+    } else if (!strcmp(key, "sched")) {
+        return parse_sched_policy(value, &attrs->placement.schedPolicy);
+    } else if (!strcmp(key, "rtprio")) {
+        attrs->placement.rtPriority = atoi(value);
+        return isdigit(value[0]) && is_non_neg_int(value) && 
+                attrs->placement.rtPriority >= 1 &&
+                attrs->placement.rtPriority <= MAX_RT_PRIORITY;
+    } else if (!strcmp(key, "memlimit")) {
+        return parse_size(value, &attrs->placement.memLimit) && 
+                attrs->placement.memLimit;
+    } else if (!strcmp(key, "nofile")) {
+        attrs->placement.fileLimit = atol(value);
+        return isdigit(value[0]) && is_non_neg_int(value) && 
+                attrs->placement.fileLimit > 0;
+    } else if (!strcmp(key, "pipe")) {
+        return parse_size(value, &attrs->placement.pipeSize) && 
+                attrs->placement.pipeSize;
+    } else if (!strcmp(key, ENV_ATTR)) {
+        //The variables themselves are collected when the job is made
+        char* assign = strchr(value, ATTR_ASSIGN);
+        attrs->numEnv++;
+        return assign && assign != value;
+    }
+    return false;
+}
+
+int collect_env_attrs(char* field, char** env) {
+    char* savePtr;
+    int numEnv = 0;
+    for (char* attr = strtok_r(field, ATTR_SEPARATOR, &savePtr); attr;
+            attr = strtok_r(NULL, ATTR_SEPARATOR, &savePtr)) {
+        char* value = strchr(attr, ATTR_ASSIGN);
+        *value++ = '\0';
+        if (!strcmp(attr, ENV_ATTR)) {
+            env[numEnv++] = value;
+        }
+    }
+    return numEnv;
+}
+
+char* collect_pool_attr(char* field) {
+    char* savePtr;
+    for (char* attr = strtok_r(field, ATTR_SEPARATOR, &savePtr); attr;
+            attr = strtok_r(NULL, ATTR_SEPARATOR, &savePtr)) {
+        char* value = strchr(attr, ATTR_ASSIGN);
+        *value++ = '\0';
+        if (!strcmp(attr, POOL_ATTR)) {
+            return value;
+        }
+    }
+    return DEFAULT_POOL;
+}
+
+bool job_pooled(JobAttrs* attrs) {
+    return attrs->pooled || attrs->dispatch != DISPATCH_BROADCAST || 
+            attrs->maxReplicas > 1 || job_scalable(attrs) || 
+            attrs->orderWindow != UNORDERED;
+}
+
+bool job_scalable(JobAttrs* attrs) {
+    return attrs->minReplicas < attrs->maxReplicas;
+}
+
+bool parse_replicas(char* value, int* minReplicas, int* maxReplicas) {
+    char* max = strchr(value, REPLICA_RANGE);
+    if (max) {
+        *max++ = '\0';
+    } else {
+        max = value;
+    }
+    if (!isdigit(value[0]) || !is_non_neg_int(value) || !isdigit(max[0]) ||
+            !is_non_neg_int(max)) {
+        return false;
+    }
+    *minReplicas = atoi(value);
+    *maxReplicas = atoi(max);
+    return *maxReplicas >= 1 && *maxReplicas >= *minReplicas && 
+            *maxReplicas <= MAX_REPLICAS;
+}
+
+bool parse_backoff_factor(char* value, double* factor) {
+    char* pEnd;
+    if (!isdigit(value[0])) {
+        return false;
+    }
+    *factor = strtod(value, &pEnd);
+    return *pEnd == '\0' && *factor >= 1.0;
+}
+
+bool parse_spawn_method(char* value, bool* forkSpawn) {
+    if (!strcmp(value, "fork")) {
+        *forkSpawn = true;
+    } else if (!strcmp(value, "posix")) {
+        *forkSpawn = false;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool parse_queue_policy(char* value, QueuePolicy* policy) {
+    if (!strcmp(value, "block")) {
+        *policy = QUEUE_BLOCK;
+    } else if (!strcmp(value, "drop")) {
+        *policy = QUEUE_DROP_OLDEST;
+    } else if (!strcmp(value, "spill")) {
+        *policy = QUEUE_SPILL;
+    } else {
+        return false;
+    }
+    return true;
+}
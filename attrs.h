@@ -0,0 +1,185 @@
+#ifndef ATTRS_H
+#define ATTRS_H
+
+#include "helper.h"
+#include "outq.h"
+#include "pool.h"
+#include "placement.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#define ATTR_SEPARATOR ","
+#define ATTR_ASSIGN '='
+#define ENV_ATTR "env"
+#define POOL_ATTR "pool"
+#define DEFAULT_POOL ""
+#define DEFAULT_RESTART_DELAY_MS 100
+#define DEFAULT_BACKOFF_FACTOR 2.0
+#define DEFAULT_MAX_RESTART_DELAY_MS 30000
+#define DEFAULT_JITTER_PERCENT 10
+#define MAX_JITTER_PERCENT 100
+#define REPLICA_RANGE '-'
+#define MAX_REPLICAS 1024
+
+//Optional settings for a job, given as a comma separated list of 
+//key=value pairs in the attribute field of a jobfile entry. A job is in a
+//pool if it is given a pool name, which is collected when the job is made,
+//or a dispatch mode other than broadcast. An entry with a replica range 
+//registers maxReplicas jobs, of which minReplicas are always started and 
+//the rest are started as the load grows, and is also in a pool. A job 
+//given an order window is in a pool that keeps its answers in input order.
+//placement is where and how the job's process runs.
+typedef struct {
+    size_t queueLimit;
+    QueuePolicy queuePolicy;
+    bool forkSpawn;
+    long long restartDelayMs;
+    double backoffFactor;
+    long long maxRestartDelayMs;
+    int jitterPercent;
+    int numEnv;
+    bool pooled;
+    DispatchMode dispatch;
+    int keyField;
+    int minReplicas;
+    int maxReplicas;
+    int scaleAt;
+    long long idleMs;
+    int orderWindow;
+    long long orderTimeoutMs;
+    bool dropStragglers;
+    Placement placement;
+} JobAttrs;
+
+#endif //ATTRS_H
+
+/* init_job_attrs()
+ * ----------------
+ * Initialises job attributes to their defaults.
+ *
+ * attrs: the attributes to be initialised.
+ */
+void init_job_attrs(JobAttrs* attrs);
+
+/* parse_job_attrs()
+ * -----------------
+ * Parses the attribute field of a jobfile entry, e.g., 
+ * "queue=64K,policy=drop". An empty field leaves the defaults unchanged.
+ *
+ * field: the attribute field. It is modified by parsing.
+ *
+ * attrs: the attributes to be filled in.
+ *
+ * Returns: true if every attribute is known and has a valid value, false 
+ * otherwise.
+ */
+bool parse_job_attrs(char* field, JobAttrs* attrs);
+
+/* parse_job_attr()
+ * ----------------
+ * Parses a single attribute.
+ *
+ * key: the name of the attribute.
+ *
+ * value: the value given for the attribute.
+ *
+ * attrs: the attributes to be filled in.
+ *
+ * Returns: true if the attribute is known and the value valid, false 
+ * otherwise.
+ */
+bool parse_job_attr(char* key, char* value, JobAttrs* attrs);
+
+/* collect_env_attrs()
+ * -------------------
+ * Finds the NAME=value variables given by env attributes in an attribute 
+ * field that has already been validated by parse_job_attrs().
+ *
+ * field: the attribute field. It is modified by collecting.
+ *
+ * env: filled with pointers into field to each variable, in order. It must
+ * have room for the field's numEnv variables.
+ *
+ * Returns: the number of variables found.
+ */
+int collect_env_attrs(char* field, char** env);
+
+/* collect_pool_attr()
+ * -------------------
+ * Finds the pool attribute in a job's attribute field.
+ *
+ * field: the attribute field, which has already been parsed successfully.
+ * It is modified.
+ *
+ * Returns: the name of the pool, pointing into field, or DEFAULT_POOL if
+ * no pool is named.
+ */
+char* collect_pool_attr(char* field);
+
+/* job_pooled()
+ * ------------
+ * Returns: true if the job with the given attributes is in a pool, false 
+ * if it is sent every line.
+ */
+bool job_pooled(JobAttrs* attrs);
+
+/* job_scalable()
+ * --------------
+ * Returns: true if the jobs of an entry with the given attributes are 
+ * started and retired as the load changes, false if they all always run.
+ */
+bool job_scalable(JobAttrs* attrs);
+
+/* parse_replicas()
+ * ----------------
+ * Parses a replica range, "MIN-MAX", or a fixed number of replicas, "N". 
+ * MAX must be at least 1 and at least MIN, and no more than MAX_REPLICAS.
+ *
+ * value: the range to be parsed. It is modified by parsing.
+ *
+ * minReplicas: set to the number of replicas always started.
+ *
+ * maxReplicas: set to the number of replicas registered.
+ *
+ * Returns: true if the value is a valid range, false otherwise.
+ */
+bool parse_replicas(char* value, int* minReplicas, int* maxReplicas);
+
+/* parse_backoff_factor()
+ * ----------------------
+ * Parses the factor the restart delay grows by after each quick exit, e.g.,
+ * "1.5". It must be at least 1.
+ *
+ * value: the factor as a decimal number.
+ *
+ * factor: set to the factor.
+ *
+ * Returns: true if the value is a valid factor, false otherwise.
+ */
+bool parse_backoff_factor(char* value, double* factor);
+
+/* parse_spawn_method()
+ * --------------------
+ * Parses how a job is spawned: "fork" or "posix" (posix_spawn()).
+ *
+ * value: the name of the spawn method.
+ *
+ * forkSpawn: set to true for "fork" and false for "posix".
+ *
+ * Returns: true if the name is a known spawn method, false otherwise.
+ */
+bool parse_spawn_method(char* value, bool* forkSpawn);
+
+/* parse_queue_policy()
+ * --------------------
+ * Parses the name of a queue policy: "block", "drop" or "spill".
+ *
+ * value: the name of the policy.
+ *
+ * policy: set to the named policy.
+ *
+ * Returns: true if the name is a known policy, false otherwise.
+ */
+bool parse_queue_policy(char* value, QueuePolicy* policy);
@@ -0,0 +1,99 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <time.h>
+
+#define NS_PER_US 1000LL
+#define US_PER_SECOND 1000000LL
+#define READ_SIZE 65536
+
+/* echoworker
+ * ----------
+ * A synthetic line-in/line-out worker for benchmarking jobthing. Each line
+ * read from stdin is written back to stdout unchanged after sleeping for
+ * delayUs microseconds and then spinning the CPU for cpuUs microseconds,
+ * standing in for a worker that waits on something and one that computes.
+ * Every line from one read is answered with one write, so a busy worker
+ * answers in batches like a real one.
+ *
+ * Usage: echoworker [delayUs] [cpuUs]
+ */
+
+/* now_us()
+ * --------
+ * Returns: the current time of the monotonic clock in microseconds.
+ */
+long long now_us(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * US_PER_SECOND + now.tv_nsec / NS_PER_US;
+}
+
+/* write_all()
+ * -----------
+ * Writes the whole of data to stdout.
+ */
+void write_all(char* data, size_t length) {
+    while (length) {
+        ssize_t numWritten = write(STDOUT_FILENO, data, length);
+        if (numWritten <= 0) {
+            exit(1);
+        }
+        data += numWritten;
+        length -= numWritten;
+    }
+}
+
+/* spin()
+ * ------
+ * Keeps the CPU busy for the given number of microseconds.
+ */
+void spin(long long us) {
+    long long end = now_us() + us;
+    volatile unsigned long counter = 0;
+    while (now_us() < end) {
+        counter++;
+    }
+}
+
+int main(int argc, char** argv) {
+    long long delayUs = argc > 1 ? atoll(argv[1]) : 0;
+    long long cpuUs = argc > 2 ? atoll(argv[2]) : 0;
+    if (delayUs < 0 || cpuUs < 0) {
+        fprintf(stderr, "Usage: echoworker [delayUs] [cpuUs]\n");
+        return 1;
+    }
+
+    //Lines are answered in place in the read buffer. A partial line at the
+    //end of a read is moved to the front to be finished by the next read.
+    char buffer[READ_SIZE];
+    size_t length = 0;
+    ssize_t numRead;
+    while ((numRead = read(STDIN_FILENO, buffer + length, 
+            sizeof(buffer) - length)) > 0) {
+        length += numRead;
+        char* start = buffer;
+        char* end;
+        while ((end = memchr(start, '\n', buffer + length - start))) {
+            if (delayUs) {
+                usleep(delayUs);
+            }
+            if (cpuUs) {
+                spin(cpuUs);
+            }
+            start = end + 1;
+        }
+        write_all(buffer, start - buffer);
+        length -= start - buffer;
+        memmove(buffer, start, length);
+        if (length == sizeof(buffer)) {
+            //A line longer than the buffer is passed on as it is
+            write_all(buffer, length);
+            length = 0;
+        }
+    }
+    write_all(buffer, length);
+    return 0;
+}
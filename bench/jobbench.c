@@ -0,0 +1,574 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <errno.h>
+#include <limits.h>
+#include <sys/wait.h>
+#include "../latency.h"
+
+#define DEFAULT_WORKERS 4
+#define DEFAULT_LINES 200000
+#define DEFAULT_LINE_BYTES 64
+#define DEFAULT_RESTART_SECONDS 2.0
+#define MIN_LINE_BYTES 24
+#define CHUNK_SIZE 65536
+#define READ_SIZE 65536
+#define RATE_POLL_MS 1
+//Input is closed if jobs stop answering for this long
+#define ANSWER_TIMEOUT_US 5000000LL
+#define MAX_PATH 512
+#define MAX_DIR 64
+#define MAX_JOBTHING_ARGS 8
+
+/* jobbench
+ * --------
+ * Measures jobthing end to end and prints the results as one line of JSON,
+ * so that runs on different commits can be compared. Three runs are made,
+ * each against a generated jobfile:
+ *
+ * - throughput: lines are streamed into jobthing (as fast as it accepts
+ *   them, or at a fixed rate) for workers jobs of the chosen kind. Each line
+ *   carries the time it was sent, so the time until a job's answer is
+ *   relayed back gives the relay latency. jobthing's own CPU time is read
+ *   from /proc before it is reaped, so the jobs' CPU time is not included.
+ * - spawn: workers cat jobs are started and timed until the last one is
+ *   reported as spawned.
+ * - restart: workers jobs that exit straight away are restarted with no
+ *   delay for a fixed time, counting their terminations.
+ *
+ * Job kinds are cat, echo (bench/echoworker, with a delay and CPU cost per
+ * line) and sink (cat writing to a file, so nothing is relayed back). With
+ * a dispatch mode, the throughput jobs are one pool that shares the lines
+ * rather than each being sent every line. With a number of I/O threads,
+ * the throughput run uses jobthing's threaded mode.
+ *
+ * Usage: jobbench [-j workers] [-k cat|echo|sink] [-m rr|least|hash]
+ *         [-n lines] [-s linebytes] [-r linespersec] [-d delayus]
+ *         [-c cpuus] [-t restartseconds] [-T threads] [-x jobthing]
+ *         [-e echoworker]
+ */
+
+//What is measured and with which programs
+typedef struct {
+    int workers;
+    char* kind;
+    char* dispatch;
+    char* threads;
+    long long lines;
+    int lineBytes;
+    long long rate;
+    long long delayUs;
+    long long cpuUs;
+    double restartSeconds;
+    char* jobthing;
+    char* echoWorker;
+    char dir[MAX_DIR];
+} Config;
+
+//A running jobthing and the ends of its stdin and stdout
+typedef struct {
+    pid_t pid;
+    int inFd;
+    int outFd;
+    long long startUs;
+    char buffer[READ_SIZE];
+    size_t length;
+} Run;
+
+/* now_us()
+ * --------
+ * Returns: the current time of the monotonic clock in microseconds.
+ */
+long long now_us(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long) now.tv_sec * US_PER_SECOND + now.tv_nsec / NS_PER_US;
+}
+
+/* usage()
+ * -------
+ * Prints the usage message and exits.
+ */
+void usage(void) {
+    fprintf(stderr, "Usage: jobbench [-j workers] [-k cat|echo|sink] "
+            "[-m rr|least|hash]\n        [-n lines] [-s linebytes] "
+            "[-r linespersec] [-d delayus]\n        [-c cpuus] "
+            "[-t restartseconds] [-T threads] [-x jobthing]\n"
+            "        [-e echoworker]\n");
+    exit(1);
+}
+
+/* parse_config()
+ * --------------
+ * Reads the benchmark settings from the command line.
+ */
+void parse_config(Config* config, int argc, char** argv) {
+    config->workers = DEFAULT_WORKERS;
+    config->kind = "cat";
+    config->dispatch = NULL;
+    config->threads = NULL;
+    config->lines = DEFAULT_LINES;
+    config->lineBytes = DEFAULT_LINE_BYTES;
+    config->rate = 0;
+    config->delayUs = 0;
+    config->cpuUs = 0;
+    config->restartSeconds = DEFAULT_RESTART_SECONDS;
+    config->jobthing = "./jobthing";
+    config->echoWorker = "./bench/echoworker";
+
+    int option;
+    while ((option = getopt(argc, argv, "j:k:m:n:s:r:d:c:t:T:x:e:")) != -1) {
+        switch (option) {
+            case 'j':
+                config->workers = atoi(optarg);
+                break;
+            case 'k':
+                config->kind = optarg;
+                break;
+            case 'm':
+                config->dispatch = optarg;
+                break;
+            case 'n':
+                config->lines = atoll(optarg);
+                break;
+            case 's':
+                config->lineBytes = atoi(optarg);
+                break;
+            case 'r':
+                config->rate = atoll(optarg);
+                break;
+            case 'd':
+                config->delayUs = atoll(optarg);
+                break;
+            case 'c':
+                config->cpuUs = atoll(optarg);
+                break;
+            case 't':
+                config->restartSeconds = atof(optarg);
+                break;
+            case 'T':
+                config->threads = optarg;
+                break;
+            case 'x':
+                config->jobthing = optarg;
+                break;
+            case 'e':
+                config->echoWorker = optarg;
+                break;
+            default:
+                usage();
+        }
+    }
+    if (optind != argc || config->workers <= 0 || config->lines <= 0 ||
+            config->lineBytes < MIN_LINE_BYTES || config->lineBytes >
+            CHUNK_SIZE || config->rate < 0 || config->delayUs < 0 ||
+            config->cpuUs < 0 || config->restartSeconds <= 0 ||
+            (strcmp(config->kind, "cat") && strcmp(config->kind, "echo") &&
+            strcmp(config->kind, "sink")) || (config->dispatch &&
+            strcmp(config->dispatch, "rr") && strcmp(config->dispatch,
+            "least") && strcmp(config->dispatch, "hash")) ||
+            (config->threads && atoi(config->threads) <= 0)) {
+        usage();
+    }
+}
+
+/* write_jobfile()
+ * ---------------
+ * Writes a jobfile of config->workers jobs of the given kind, which is a
+ * job kind or "restart", to name in the benchmark's directory. Jobs of a
+ * job kind are given the dispatch mode, if there is one.
+ *
+ * Returns: the path of the jobfile, which must be freed.
+ */
+char* write_jobfile(Config* config, const char* name, const char* kind) {
+    char* path = malloc(MAX_PATH);
+    snprintf(path, MAX_PATH, "%s/%s", config->dir, name);
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        perror(path);
+        exit(1);
+    }
+    char attrs[MAX_PATH] = "";
+    if (config->dispatch && strcmp(kind, "restart")) {
+        snprintf(attrs, sizeof(attrs), "dispatch=%s:", config->dispatch);
+    }
+    for (int i = 0; i < config->workers; i++) {
+        if (!strcmp(kind, "echo")) {
+            fprintf(file, "1:::%s%s %lld %lld\n", attrs, config->echoWorker,
+                    config->delayUs, config->cpuUs);
+        } else if (!strcmp(kind, "sink")) {
+            fprintf(file, "1::%s/sink%d.out:%scat\n", config->dir, i, attrs);
+        } else if (!strcmp(kind, "restart")) {
+            fprintf(file, "0:::delay=0,jitter=0:true\n");
+        } else if (!strcmp(kind, "cat")) {
+            fprintf(file, "1:::%scat\n", attrs);
+        } else {
+            fprintf(file, "1:::cat\n");
+        }
+    }
+    fclose(file);
+    return path;
+}
+
+/* start_jobthing()
+ * ----------------
+ * Starts jobthing on a jobfile with its stdin and stdout connected to
+ * non-blocking pipes. Its stderr, where verbose mode reports each job's EOF,
+ * is discarded.
+ *
+ * args: the options given to jobthing, ending in NULL.
+ */
+void start_jobthing(Config* config, Run* run, char* jobfile, char** args) {
+    int in[2], out[2];
+    if (pipe(in) == -1 || pipe(out) == -1) {
+        perror("pipe");
+        exit(1);
+    }
+    char* argv[MAX_JOBTHING_ARGS + 2];
+    int argc = 0;
+    argv[argc++] = config->jobthing;
+    while (*args && argc < MAX_JOBTHING_ARGS) {
+        argv[argc++] = *args++;
+    }
+    argv[argc++] = jobfile;
+    argv[argc] = NULL;
+
+    run->startUs = now_us();
+    run->pid = fork();
+    if (!run->pid) {
+        dup2(in[0], STDIN_FILENO);
+        dup2(out[1], STDOUT_FILENO);
+        close(in[0]);
+        close(in[1]);
+        close(out[0]);
+        close(out[1]);
+        int devNull = open("/dev/null", O_WRONLY);
+        dup2(devNull, STDERR_FILENO);
+        close(devNull);
+        execv(argv[0], argv);
+        perror(argv[0]);
+        _exit(99);
+    }
+    close(in[0]);
+    close(out[1]);
+    run->inFd = in[1];
+    run->outFd = out[0];
+    run->length = 0;
+    fcntl(run->inFd, F_SETFL, O_NONBLOCK);
+    fcntl(run->outFd, F_SETFL, O_NONBLOCK);
+}
+
+/* read_output()
+ * -------------
+ * Reads what jobthing has written and calls onLine for each whole line.
+ *
+ * Returns: false once jobthing has closed its stdout, true otherwise.
+ */
+bool read_output(Run* run, void (*onLine)(char*, size_t, void*),
+        void* context) {
+    while (true) {
+        ssize_t numRead = read(run->outFd, run->buffer + run->length,
+                sizeof(run->buffer) - run->length);
+        if (numRead == -1 && errno == EINTR) {
+            continue;
+        } else if (numRead == -1) {
+            return errno == EAGAIN;
+        } else if (numRead == 0) {
+            return false;
+        }
+        run->length += numRead;
+        char* start = run->buffer;
+        char* end;
+        while ((end = memchr(start, '\n', run->buffer + run->length -
+                start))) {
+            onLine(start, end - start, context);
+            start = end + 1;
+        }
+        run->length -= start - run->buffer;
+        memmove(run->buffer, start, run->length);
+        if (run->length == sizeof(run->buffer)) {
+            //Overlong lines are not jobthing's and are skipped
+            run->length = 0;
+        }
+    }
+}
+
+/* finish_jobthing()
+ * -----------------
+ * Closes jobthing's stdin, waits for it to exit and reaps it.
+ *
+ * Returns: the CPU time, in seconds, used by jobthing itself and not its
+ * jobs, read from /proc while it is a zombie.
+ */
+double finish_jobthing(Run* run) {
+    if (run->inFd != -1) {
+        close(run->inFd);
+        run->inFd = -1;
+    }
+    siginfo_t info;
+    waitid(P_PID, run->pid, &info, WEXITED | WNOWAIT);
+
+    char path[MAX_PATH];
+    snprintf(path, sizeof(path), "/proc/%d/stat", (int) run->pid);
+    unsigned long userTicks = 0, systemTicks = 0;
+    FILE* stat = fopen(path, "r");
+    if (stat) {
+        char line[READ_SIZE];
+        if (fgets(line, sizeof(line), stat) && strrchr(line, ')')) {
+            //Fields after the command name, from the state to stime
+            sscanf(strrchr(line, ')') + 1, " %*c %*d %*d %*d %*d %*d %*u "
+                    "%*u %*u %*u %*u %lu %lu", &userTicks, &systemTicks);
+        }
+        fclose(stat);
+    }
+    waitpid(run->pid, NULL, 0);
+    close(run->outFd);
+    return (double) (userTicks + systemTicks) / sysconf(_SC_CLK_TCK);
+}
+
+/* record_latency()
+ * ----------------
+ * Records the relay latency of a relayed line, N->'sentus ...'.
+ */
+void record_latency(char* line, size_t length, void* context) {
+    long long nowUs = now_us();
+    char* relayed = memmem(line, length, "->'", 3);
+    if (relayed) {
+        long long sentUs = strtoll(relayed + 3, NULL, 10);
+        latency_sent(context, sentUs);
+        latency_answered(context, nowUs);
+    }
+}
+
+/* fill_chunk()
+ * ------------
+ * Adds lines that are due to be sent to chunk, each starting with the time
+ * it was made and padded to config->lineBytes.
+ *
+ * Returns: the new length of chunk.
+ */
+size_t fill_chunk(Config* config, char* chunk, size_t length,
+        long long* linesMade, long long startUs) {
+    long long due = config->lines;
+    long long nowUs = now_us();
+    if (config->rate) {
+        due = (nowUs - startUs) * config->rate / US_PER_SECOND;
+        due = due < config->lines ? due : config->lines;
+    }
+    while (*linesMade < due && length + config->lineBytes <= CHUNK_SIZE) {
+        int stamp = sprintf(chunk + length, "%lld ", nowUs);
+        memset(chunk + length + stamp, 'x', config->lineBytes - stamp - 1);
+        chunk[length + config->lineBytes - 1] = '\n';
+        length += config->lineBytes;
+        (*linesMade)++;
+    }
+    return length;
+}
+
+/* run_throughput()
+ * ----------------
+ * Streams config->lines lines through workers jobs of the configured kind.
+ * Input is held open until every line has been answered (or answers stop
+ * coming), so that the jobs are not cut off by jobthing's drain timeout.
+ *
+ * Returns: the time taken in seconds, until jobthing has exited.
+ */
+double run_throughput(Config* config, Latency* latency, double* cpuSeconds) {
+    char* jobfile = write_jobfile(config, "throughput.jobs", config->kind);
+    char* args[] = {"-n", config->threads ? "-t" : NULL, config->threads,
+            NULL};
+    Run run;
+    start_jobthing(config, &run, jobfile, args);
+
+    bool answers = strcmp(config->kind, "sink");
+    unsigned long long expected = config->lines *
+            (config->dispatch ? 1 : config->workers);
+    long long lastAnswerUs = run.startUs;
+    char chunk[CHUNK_SIZE];
+    size_t length = 0, sent = 0;
+    long long linesMade = 0;
+    bool outputOpen = true;
+    while (outputOpen) {
+        bool allSent = linesMade == config->lines && sent == length;
+        if (run.inFd != -1 && !allSent) {
+            if (sent == length) {
+                sent = 0;
+                length = fill_chunk(config, chunk, 0, &linesMade,
+                        run.startUs);
+            }
+            ssize_t numWritten = length > sent ?
+                    write(run.inFd, chunk + sent, length - sent) : 0;
+            if (numWritten > 0) {
+                sent += numWritten;
+            } else if (numWritten == -1 && errno != EAGAIN &&
+                    errno != EINTR) {
+                break;
+            }
+            allSent = linesMade == config->lines && sent == length;
+        }
+        if (run.inFd != -1 && allSent && (!answers ||
+                latency->numSamples >= expected ||
+                now_us() - lastAnswerUs > ANSWER_TIMEOUT_US)) {
+            close(run.inFd);
+            run.inFd = -1;
+        }
+
+        struct pollfd fds[2] = {{run.outFd, POLLIN, 0}, {run.inFd, 0, 0}};
+        int timeout = -1;
+        if (run.inFd != -1 && sent < length) {
+            fds[1].events = POLLOUT;
+        } else if (run.inFd != -1 && !allSent) {
+            //Waiting for more lines to come due at the configured rate
+            timeout = RATE_POLL_MS;
+        } else if (run.inFd != -1) {
+            timeout = ANSWER_TIMEOUT_US / 1000;
+        }
+        poll(fds, run.inFd != -1 ? 2 : 1, timeout);
+        unsigned long long numAnswered = latency->numSamples;
+        outputOpen = read_output(&run, record_latency, latency);
+        if (latency->numSamples != numAnswered) {
+            lastAnswerUs = now_us();
+        }
+    }
+    *cpuSeconds = finish_jobthing(&run);
+    free(jobfile);
+    return (now_us() - run.startUs) / (double) US_PER_SECOND;
+}
+
+/* count_line()
+ * ------------
+ * Counts lines that contain the string being looked for.
+ */
+void count_line(char* line, size_t length, void* context) {
+    void** counter = context;
+    const char* wanted = counter[0];
+    if (memmem(line, length, wanted, strlen(wanted))) {
+        (*(long long*) counter[1])++;
+    }
+}
+
+/* run_counting()
+ * --------------
+ * Starts jobthing on a jobfile of workers jobs of the given kind and counts
+ * the lines of its output containing wanted, until count lines have been
+ * seen or seconds have passed.
+ *
+ * Returns: the number of seconds until the count was reached or time ran
+ * out.
+ */
+double run_counting(Config* config, const char* kind, char** args,
+        const char* wanted, long long* count, long long limit,
+        double seconds) {
+    char name[MAX_PATH];
+    snprintf(name, sizeof(name), "%s.jobs", kind);
+    char* jobfile = write_jobfile(config, name, kind);
+    Run run;
+    start_jobthing(config, &run, jobfile, args);
+
+    void* counter[] = {(void*) wanted, count};
+    long long endUs = run.startUs + seconds * US_PER_SECOND;
+    long long nowUs = run.startUs;
+    bool outputOpen = true;
+    *count = 0;
+    while (outputOpen && *count < limit && nowUs < endUs) {
+        struct pollfd fds = {run.outFd, POLLIN, 0};
+        poll(&fds, 1, (endUs - nowUs) / 1000 + 1);
+        outputOpen = read_output(&run, count_line, counter);
+        nowUs = now_us();
+    }
+    double elapsed = (nowUs - run.startUs) / (double) US_PER_SECOND;
+
+    //Whatever is left is drained once jobthing sees EOF and exits
+    close(run.inFd);
+    run.inFd = -1;
+    long long ignored = 0;
+    void* drain[] = {(void*) wanted, &ignored};
+    while (outputOpen) {
+        struct pollfd fds = {run.outFd, POLLIN, 0};
+        poll(&fds, 1, -1);
+        outputOpen = read_output(&run, count_line, drain);
+    }
+    finish_jobthing(&run);
+    free(jobfile);
+    return elapsed;
+}
+
+/* remove_dir()
+ * ------------
+ * Removes the benchmark's directory and the files made in it.
+ */
+void remove_dir(Config* config) {
+    char command[MAX_DIR + 16];
+    snprintf(command, sizeof(command), "rm -rf '%s'", config->dir);
+    if (system(command)) {
+        fprintf(stderr, "jobbench: could not remove %s\n", config->dir);
+    }
+}
+
+int main(int argc, char** argv) {
+    Config config;
+    parse_config(&config, argc, argv);
+    if (access(config.jobthing, X_OK) || (!strcmp(config.kind, "echo") &&
+            access(config.echoWorker, X_OK))) {
+        fprintf(stderr, "jobbench: build jobthing and bench/echoworker "
+                "first (make bench)\n");
+        return 1;
+    }
+    strcpy(config.dir, "/tmp/jobbench.XXXXXX");
+    if (!mkdtemp(config.dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    //Lines sent to sink jobs are not relayed back, so are counted as sent
+    bool answers = strcmp(config.kind, "sink");
+    Latency latency;
+    init_latency(&latency);
+    double cpuSeconds;
+    double seconds = run_throughput(&config, &latency, &cpuSeconds);
+
+    long long spawned;
+    char* spawnArgs[] = {"-v", "-w", "line", NULL};
+    double spawnSeconds = run_counting(&config, "cat", spawnArgs,
+            "Spawning worker", &spawned, config.workers, config.restartSeconds
+            * 10);
+
+    long long restarted;
+    char* restartArgs[] = {"-w", "line", NULL};
+    double restartSeconds = run_counting(&config, "restart", restartArgs,
+            "has terminated", &restarted, LLONG_MAX, config.restartSeconds);
+    remove_dir(&config);
+
+    char* commit = getenv("BENCH_COMMIT");
+    printf("{\"commit\": \"%s\", \"kind\": \"%s\", \"dispatch\": \"%s\", "
+            "\"threads\": %d, \"workers\": %d, \"lines\": %lld, "
+            "\"line_bytes\": %d, \"rate\": %lld, "
+            "\"delay_us\": %lld, \"cpu_us\": %lld, \"seconds\": %.3f, "
+            "\"lines_per_sec\": %.1f, \"relayed_lines\": %llu, ",
+            commit ? commit : "", config.kind, config.dispatch ?
+            config.dispatch : "broadcast", config.threads ?
+            atoi(config.threads) : 0, config.workers, config.lines,
+            config.lineBytes, config.rate, config.delayUs, config.cpuUs,
+            seconds, (answers ? latency.numSamples : config.lines *
+            (config.dispatch ? 1 : config.workers)) / seconds,
+            latency.numSamples);
+    if (latency.numSamples) {
+        printf("\"p50_relay_us\": %llu, \"p99_relay_us\": %llu, ",
+                latency_percentile(&latency, 0.5),
+                latency_percentile(&latency, 0.99));
+    } else {
+        printf("\"p50_relay_us\": null, \"p99_relay_us\": null, ");
+    }
+    printf("\"supervisor_cpu_percent\": %.1f, \"spawns_per_sec\": %.1f, "
+            "\"restarts_per_sec\": %.1f}\n", 100 * cpuSeconds / seconds,
+            spawned / spawnSeconds, restarted / restartSeconds);
+    free_latency(&latency);
+    return 0;
+}
@@ -0,0 +1,131 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <spawn.h>
+#include <time.h>
+#include <sys/wait.h>
+
+#define DEFAULT_SPAWNS 2000
+#define DEFAULT_BALLAST_MB 256
+#define BYTES_PER_MB (1024 * 1024)
+#define PAGE_STRIDE 4096
+#define NS_PER_SECOND 1000000000.0
+
+extern char** environ;
+
+/* spawnbench
+ * ----------
+ * Compares how many jobs per second can be started with fork()/execvp(), as
+ * jobthing -f does, and with posix_spawnp(), as jobthing does by default. 
+ * Each job runs /bin/true with its stdin and stdout redirected like a piped
+ * jobthing job. Ballast memory is touched first so that the benchmark 
+ * process has an RSS like a busy supervisor, which fork() must copy the page
+ * tables of.
+ *
+ * Usage: spawnbench [spawns] [ballastMB]
+ */
+
+/* elapsed_seconds()
+ * -----------------
+ * Returns: the number of seconds since start on the monotonic clock.
+ */
+double elapsed_seconds(struct timespec* start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + 
+            (now.tv_nsec - start->tv_nsec) / NS_PER_SECOND;
+}
+
+/* fork_spawn()
+ * ------------
+ * Starts /bin/true the way spawn_job() does after fork().
+ *
+ * Returns: the process id of the child.
+ */
+pid_t fork_spawn(int in[2], int out[2], char** argv) {
+    pid_t pid = fork();
+    if (!pid) {
+        dup2(in[0], STDIN_FILENO);
+        close(in[0]);
+        close(in[1]);
+        dup2(out[1], STDOUT_FILENO);
+        close(out[0]);
+        close(out[1]);
+        execvp(argv[0], argv);
+        _exit(99);
+    }
+    return pid;
+}
+
+/* posix_spawn_child()
+ * -------------------
+ * Starts /bin/true the way posix_spawn_job() does.
+ *
+ * Returns: the process id of the child.
+ */
+pid_t posix_spawn_child(int in[2], int out[2], char** argv) {
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, in[0], STDIN_FILENO);
+    posix_spawn_file_actions_addclose(&actions, in[0]);
+    posix_spawn_file_actions_addclose(&actions, in[1]);
+    posix_spawn_file_actions_adddup2(&actions, out[1], STDOUT_FILENO);
+    posix_spawn_file_actions_addclose(&actions, out[0]);
+    posix_spawn_file_actions_addclose(&actions, out[1]);
+    pid_t pid;
+    if (posix_spawnp(&pid, argv[0], &actions, NULL, argv, environ)) {
+        pid = -1;
+    }
+    posix_spawn_file_actions_destroy(&actions);
+    return pid;
+}
+
+/* run()
+ * -----
+ * Starts and reaps count jobs one after another with the given method.
+ *
+ * Returns: the number of jobs started per second.
+ */
+double run(pid_t (*spawn)(int[2], int[2], char**), int count) {
+    char* argv[] = {"true", NULL};
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < count; i++) {
+        int in[2], out[2];
+        pipe(in);
+        pipe(out);
+        pid_t pid = spawn(in, out, argv);
+        close(in[0]);
+        close(in[1]);
+        close(out[0]);
+        close(out[1]);
+        waitpid(pid, NULL, 0);
+    }
+    return count / elapsed_seconds(&start);
+}
+
+int main(int argc, char** argv) {
+    int count = argc > 1 ? atoi(argv[1]) : DEFAULT_SPAWNS;
+    size_t ballastMb = argc > 2 ? atoi(argv[2]) : DEFAULT_BALLAST_MB;
+    if (count <= 0) {
+        fprintf(stderr, "Usage: spawnbench [spawns] [ballastMB]\n");
+        return 1;
+    }
+
+    //Touch every page so the ballast is resident
+    char* ballast = malloc(ballastMb * BYTES_PER_MB + 1);
+    for (size_t i = 0; i < ballastMb * BYTES_PER_MB; i += PAGE_STRIDE) {
+        ballast[i] = 1;
+    }
+
+    double forkRate = run(fork_spawn, count);
+    double spawnRate = run(posix_spawn_child, count);
+    printf("{\"spawns\": %d, \"ballast_mb\": %zu, "
+            "\"fork_spawns_per_sec\": %.1f, "
+            "\"posix_spawns_per_sec\": %.1f, \"speedup\": %.2f}\n", 
+            count, ballastMb, forkRate, spawnRate, spawnRate / forkRate);
+    free(ballast);
+    return 0;
+}
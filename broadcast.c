@@ -0,0 +1,138 @@
+#include "broadcast.h"
+
+bool init_broadcast(Broadcast* broadcast, bool enabled) {
+    broadcast->enabled = false;
+    broadcast->chunk = NULL;
+    broadcast->sent = NULL;
+    broadcast->sentSize = 0;
+    if (!enabled || pipe2(broadcast->staging, O_CLOEXEC) == -1) {
+        return false;
+    }
+    //A larger staging pipe moves more input per splice. This is best 
+    //effort as the size may be limited by /proc/sys/fs/pipe-max-size.
+    fcntl(broadcast->staging[WRITE_END], F_SETPIPE_SZ, BROADCAST_CHUNK);
+    broadcast->chunk = malloc(BROADCAST_CHUNK);
+    broadcast->enabled = true;
+    return true;
+}
+
+bool broadcast_input(Broadcast* broadcast, Params* params, LineBuffer* echo,
+        Jobs* jobs, Reactor* reactor) {
+    ssize_t staged = splice(params->inputFile, NULL, 
+            broadcast->staging[WRITE_END], NULL, BROADCAST_CHUNK, 
+            SPLICE_F_MOVE);
+    if (staged == -1 && (errno == EINVAL || errno == ESPIPE)) {
+        if (params->verbose) {
+            fprintf(stderr, "Input cannot be spliced, broadcasting lines\n");
+        }
+        free_broadcast(broadcast);
+        return read_process_input(params, echo, jobs, reactor);
+    } else if (staged == -1 && (errno == EINTR || errno == EAGAIN)) {
+        return true;
+    } else if (staged <= 0) {
+        return false;
+    }
+
+    if (broadcast->sentSize < jobs->numberJobs) {
+        broadcast->sentSize = jobs->numberJobs;
+        broadcast->sent = realloc(broadcast->sent, 
+                sizeof(size_t) * broadcast->sentSize);
+    }
+
+    //tee() leaves the staged bytes in place, so every job gets them from the
+    //same pages. Jobs with input already queued must wait their turn to 
+    //keep their input in order.
+    bool queued = false;
+    for (int i = 0; i < jobs->numberJobs; i++) {
+        Job* job = &jobs->tasks[i];
+        broadcast->sent[i] = NOT_SENT;
+        if (!job_state(jobs, i, JOB_RUNNABLE) || !job->in.isPipe || 
+                job->in.fd == -1 || job->removed) {
+            continue;
+        }
+        job->inputBytes += staged;
+        ssize_t sent = 0;
+        if (out_queue_empty(&job->inQueue)) {
+            sent = tee(broadcast->staging[READ_END], job->in.fd, staged, 
+                    SPLICE_F_NONBLOCK);
+        }
+        if (sent == -1 && errno == EPIPE) {
+            set_job_state(jobs, i, JOB_KILLED, true);
+            continue;
+        }
+        broadcast->sent[i] = sent > 0 ? sent : 0;
+        queued |= sent < staged;
+    }
+
+    copy_staged_input(broadcast, staged, params, echo, jobs);
+    if (queued) {
+        flush_job_inputs(jobs, reactor);
+    }
+    return true;
+}
+
+void copy_staged_input(Broadcast* broadcast, size_t staged, Params* params, 
+        LineBuffer* echo, Jobs* jobs) {
+    size_t numRead = 0;
+    while (numRead < staged) {
+        ssize_t result = read(broadcast->staging[READ_END], 
+                broadcast->chunk + numRead, staged - numRead);
+        if (result <= 0) {
+            break;
+        }
+        numRead += result;
+    }
+
+    //Every job that was sent the chunk has received the lines ending in it
+    int lines = 0;
+    for (char* end = broadcast->chunk; 
+            (end = memchr(end, '\n', broadcast->chunk + numRead - end)); 
+            end++) {
+        lines++;
+    }
+
+    for (int i = 0; i < jobs->numberJobs; i++) {
+        Job* job = &jobs->tasks[i];
+        if (broadcast->sent[i] == NOT_SENT) {
+            continue;
+        }
+        job->inputReceived += lines;
+        if (broadcast->sent[i] < numRead) {
+            enqueue_bytes(&job->inQueue, broadcast->chunk + 
+                    broadcast->sent[i], numRead - broadcast->sent[i], false);
+            update_input_blocked(jobs, job);
+        }
+    }
+
+    if (params->echo) {
+        append_line_buffer(echo, broadcast->chunk, numRead);
+        echo_input(echo, jobs);
+    }
+}
+
+void echo_input(LineBuffer* echo, Jobs* jobs) {
+    char* line;
+    size_t length;
+    while ((line = next_line(echo, &length))) {
+        for (int i = 0; i < jobs->numberJobs; i++) {
+            Job* job = &jobs->tasks[i];
+            if (!job_state(jobs, i, JOB_RUNNING) || !job->in.isPipe || 
+                    job->removed) {
+                continue;
+            }
+            write_relay_line(&output, job->jobNumber, "<-", line, length);
+        }
+    }
+}
+
+void free_broadcast(Broadcast* broadcast) {
+    if (broadcast->enabled) {
+        close(broadcast->staging[READ_END]);
+        close(broadcast->staging[WRITE_END]);
+    }
+    free(broadcast->chunk);
+    free(broadcast->sent);
+    broadcast->chunk = NULL;
+    broadcast->sent = NULL;
+    broadcast->enabled = false;
+}
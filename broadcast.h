@@ -0,0 +1,106 @@
+#ifndef BROADCAST_H
+#define BROADCAST_H
+
+#include "job.h"
+#include "linebuf.h"
+#include "reactor.h"
+#include "parsing.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define BROADCAST_CHUNK (256 * 1024)
+#define NOT_SENT ((size_t)-1)
+
+//State for zero-copy broadcast mode. Input is spliced into a staging pipe
+//once and tee()d from there into every job's input pipe, so the bytes are
+//read into user space once, to count lines, rather than once for each job.
+typedef struct {
+    bool enabled;
+    int staging[2];
+    char* chunk;
+    size_t* sent;
+    int sentSize;
+} Broadcast;
+
+#endif //BROADCAST_H
+
+/* init_broadcast()
+ * ----------------
+ * Sets up the staging pipe used by zero-copy broadcast mode.
+ *
+ * broadcast: the broadcast state to be initialised.
+ *
+ * enabled: whether zero-copy broadcast was requested.
+ *
+ * Returns: true if broadcast mode is enabled and ready, false otherwise.
+ */
+bool init_broadcast(Broadcast* broadcast, bool enabled);
+
+/* broadcast_input()
+ * -----------------
+ * Moves one chunk of input into the staging pipe and duplicates it into the
+ * input pipe of every runnable job with a piped input. A job that takes only
+ * part of the chunk, or already has input queued, has the rest copied into
+ * its input queue to be written once its pipe has room. Input is treated as
+ * raw data, so lines starting with '*' are not handled as commands.
+ *
+ * broadcast: the broadcast state.
+ *
+ * params: the parameters specified by the command line.
+ *
+ * echo: the line buffer used to split input into lines when it is echoed.
+ *
+ * jobs: the jobs to send input to.
+ *
+ * reactor: the reactor that watches job input pipes that are full.
+ *
+ * Returns: false if EOF (or a read error) was reached on the input file, 
+ * true otherwise.
+ * Errors: if the input cannot be spliced (e.g., it is a terminal), 
+ * broadcast mode is disabled and the input is read as lines instead.
+ */
+bool broadcast_input(Broadcast* broadcast, Params* params, LineBuffer* echo,
+        Jobs* jobs, Reactor* reactor);
+
+/* copy_staged_input()
+ * -------------------
+ * Reads the staged chunk into user space, counting the lines each job was 
+ * sent, queueing whatever each job did not receive from tee() and echoing 
+ * the input if required.
+ *
+ * broadcast: the broadcast state.
+ *
+ * staged: the number of bytes in the staging pipe.
+ *
+ * params: the parameters specified by the command line.
+ *
+ * echo: the line buffer used to split input into lines when it is echoed.
+ *
+ * jobs: the jobs to send input to.
+ */
+void copy_staged_input(Broadcast* broadcast, size_t staged, Params* params, 
+        LineBuffer* echo, Jobs* jobs);
+
+/* echo_input()
+ * ------------
+ * Prints every complete line of input that has been broadcast, once for 
+ * each job it was sent to.
+ *
+ * echo: the line buffer holding the input.
+ *
+ * jobs: the jobs input was sent to.
+ */
+void echo_input(LineBuffer* echo, Jobs* jobs);
+
+/* free_broadcast()
+ * ----------------
+ * Closes the staging pipe and frees the memory used by broadcast mode.
+ *
+ * broadcast: the broadcast state to be freed.
+ */
+void free_broadcast(Broadcast* broadcast);
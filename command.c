@@ -0,0 +1,116 @@
+#include "command.h"
+
+void compile_command(Command* command, const char* cmd, char** env, 
+        int numEnv, Arena* arena) {
+    //The vector and the arguments it points to are one block
+    int argc = split_args(cmd, NULL, NULL);
+    size_t vectorSize = ARENA_ROUND(sizeof(char*) * (argc + 1));
+    char* block = arena_alloc(arena, vectorSize + strlen(cmd) + argc + 1);
+    command->argv = (char**) block;
+    command->argc = split_args(cmd, command->argv, block + vectorSize);
+    command->argv[argc] = NULL;
+
+    command->envp = numEnv ? build_envp(env, numEnv, arena) : NULL;
+    command->path = argc ? resolve_executable(command->argv[0], arena) : 
+            NULL;
+}
+
+int split_args(const char* cmd, char** args, char* buffer) {
+    int numArgs = 0;
+    const char* c = cmd;
+    while (*c) {
+        while (*c == ARG_SEPARATOR) {
+            c++;
+        }
+        if (!*c) {
+            break;
+        }
+        if (args) {
+            args[numArgs] = buffer;
+        }
+        bool quoted = false;
+        for (; *c && (quoted || *c != ARG_SEPARATOR); c++) {
+            if (*c == ARG_QUOTE) {
+                quoted = !quoted;
+            } else if (buffer) {
+                *buffer++ = *c;
+            }
+        }
+        if (buffer) {
+            *buffer++ = '\0';
+        }
+        numArgs++;
+    }
+    return numArgs;
+}
+
+char** build_envp(char** env, int numEnv, Arena* arena) {
+    int numInherited = 0;
+    while (environ[numInherited]) {
+        numInherited++;
+    }
+    char** envp = arena_alloc(arena, 
+            sizeof(char*) * (numEnv + numInherited + 1));
+
+    //The job's own variables come first and hide inherited ones
+    int count = 0;
+    for (int i = 0; i < numEnv; i++) {
+        envp[count++] = arena_strndup(arena, env[i], strlen(env[i]));
+    }
+    for (int i = 0; i < numInherited; i++) {
+        bool replaced = false;
+        size_t nameLength = env_name_length(environ[i]);
+        for (int j = 0; j < numEnv && !replaced; j++) {
+            replaced = env_name_length(env[j]) == nameLength && 
+                    !strncmp(env[j], environ[i], nameLength);
+        }
+        if (!replaced) {
+            envp[count++] = environ[i];
+        }
+    }
+    envp[count] = NULL;
+    return envp;
+}
+
+size_t env_name_length(const char* variable) {
+    const char* assign = strchr(variable, ENV_ASSIGN);
+    return assign ? assign - variable : strlen(variable);
+}
+
+char* resolve_executable(char* name, Arena* arena) {
+    //Jobs tend to repeat the same few commands, so the last lookup is kept
+    static char* lastName = NULL;
+    static char* lastPath = NULL;
+    if (strchr(name, '/')) {
+        return name;
+    }
+    if (lastName && !strcmp(name, lastName)) {
+        return lastPath;
+    }
+
+    const char* path = getenv("PATH");
+    path = path ? path : DEFAULT_PATH;
+    char candidate[PATH_MAX];
+    char* resolved = name;
+    while (true) {
+        const char* dirEnd = strchr(path, PATH_SEPARATOR);
+        int dirLength = dirEnd ? dirEnd - path : strlen(path);
+
+        //An empty directory means the current directory
+        int length = snprintf(candidate, sizeof(candidate), "%.*s%s%s", 
+                dirLength, path, dirLength ? "/" : "", name);
+        struct stat info;
+        if (length < (int) sizeof(candidate) && !stat(candidate, &info) && 
+                S_ISREG(info.st_mode) && !access(candidate, X_OK)) {
+            resolved = arena_strndup(arena, candidate, length);
+            break;
+        }
+        if (!dirEnd) {
+            break;
+        }
+        path = dirEnd + 1;
+    }
+    lastName = name;
+    lastPath = resolved;
+    return resolved;
+}
@@ -0,0 +1,102 @@
+#ifndef COMMAND_H
+#define COMMAND_H
+
+#include "arena.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <limits.h>
+#include <sys/stat.h>
+
+#define ARG_SEPARATOR ' '
+#define ARG_QUOTE '"'
+#define ENV_ASSIGN '='
+#define DEFAULT_PATH "/usr/bin:/bin"
+#define PATH_SEPARATOR ':'
+
+//A job's command parsed once, when the job is registered, into the argv 
+//and (if the job sets environment variables) envp vectors passed to exec.
+//Both vectors and the strings they point to live in the jobs' arena and 
+//are never modified. path is the executable found on PATH, or argv[0] if
+//none was found, in which case exec fails as it would have.
+typedef struct {
+    char* path;
+    char** argv;
+    char** envp;
+    int argc;
+} Command;
+
+#endif //COMMAND_H
+
+/* compile_command()
+ * -----------------
+ * Splits a command line into an argv vector, splitting on spaces that are
+ * not between double quotes and removing the quotes, builds the envp 
+ * vector and resolves the executable.
+ *
+ * command: the command to be filled in.
+ *
+ * cmd: the command line from the jobfile.
+ *
+ * env: the NAME=value variables the job sets, which replace any of the same
+ * name in jobthing's environment.
+ *
+ * numEnv: the number of variables in env. If 0, the job inherits jobthing's
+ * environment and envp is NULL.
+ *
+ * arena: the arena the vectors are allocated in.
+ */
+void compile_command(Command* command, const char* cmd, char** env, 
+        int numEnv, Arena* arena);
+
+/* split_args()
+ * ------------
+ * Splits a command line into arguments. When args is NULL, only counts 
+ * them.
+ *
+ * cmd: the command line.
+ *
+ * args: filled with a pointer to each argument, or NULL.
+ *
+ * buffer: where the arguments are written, at most strlen(cmd) + 1 bytes 
+ * per argument in total, or NULL when counting.
+ *
+ * Returns: the number of arguments.
+ */
+int split_args(const char* cmd, char** args, char* buffer);
+
+/* build_envp()
+ * ------------
+ * Builds an environment from jobthing's environment with the job's own 
+ * variables added or replacing those of the same name.
+ *
+ * env: the job's NAME=value variables.
+ *
+ * numEnv: the number of variables in env.
+ *
+ * arena: the arena the vector is allocated in.
+ *
+ * Returns: the NULL-terminated environment.
+ */
+char** build_envp(char** env, int numEnv, Arena* arena);
+
+/* env_name_length()
+ * -----------------
+ * Returns: the length of the name of a NAME=value variable.
+ */
+size_t env_name_length(const char* variable);
+
+/* resolve_executable()
+ * --------------------
+ * Finds the executable that execvp() would run for a name by searching 
+ * PATH. Names containing a slash are used as they are.
+ *
+ * name: the name of the executable.
+ *
+ * arena: the arena a resolved path is copied into.
+ *
+ * Returns: the path of the executable, or name if it was not found.
+ */
+char* resolve_executable(char* name, Arena* arena);
@@ -0,0 +1,156 @@
+#include "control.h"
+
+bool init_control_server(ControlServer* server, char* path) {
+    server->listenFd = -1;
+    server->path = path;
+    for (int i = 0; i < MAX_CONTROL_CLIENTS; i++) {
+        server->clients[i].fd = -1;
+    }
+    if (!path) {
+        return true;
+    }
+
+    server->listenFd = listen_unix_socket(path, MAX_CONTROL_CLIENTS);
+    if (server->listenFd == -1) {
+        server->path = NULL;
+        return false;
+    }
+    return true;
+}
+
+void watch_control_server(ControlServer* server, Reactor* reactor) {
+    if (server->listenFd != -1) {
+        reactor_watch(reactor, server->listenFd, WATCH_CONTROL_LISTEN, 0,
+                EPOLLIN);
+    }
+}
+
+void accept_control_clients(ControlServer* server, Reactor* reactor) {
+    int fd;
+    while ((fd = accept4(server->listenFd, NULL, NULL,
+            SOCK_NONBLOCK | SOCK_CLOEXEC)) != -1) {
+        int index = 0;
+        while (index < MAX_CONTROL_CLIENTS &&
+                server->clients[index].fd != -1) {
+            index++;
+        }
+        if (index == MAX_CONTROL_CLIENTS) {
+            close(fd);
+            continue;
+        }
+
+        ControlClient* client = &server->clients[index];
+        client->fd = fd;
+        init_line_buffer(&client->commands);
+        init_writer(&client->replies, fd, FLUSH_ON_SIZE, 0, 0);
+        client->replies.flush = queue_control_replies;
+        client->replies.context = client;
+        init_out_queue(&client->queue, CONTROL_REPLY_LIMIT,
+                QUEUE_DROP_OLDEST);
+        client->closing = false;
+        client->events = EPOLLIN;
+        reactor_watch(reactor, fd, WATCH_CONTROL_CLIENT, index, EPOLLIN);
+    }
+}
+
+void handle_control_client(ControlServer* server, int index, uint32_t events,
+        Jobs* jobs, Reactor* reactor) {
+    ControlClient* client = &server->clients[index];
+    //One read per pass, so a client sending a flood of commands cannot hold
+    //up relaying input and output
+    if (!client->closing && (events & (EPOLLIN | EPOLLHUP | EPOLLERR))) {
+        ssize_t numRead = fill_line_buffer(&client->commands, client->fd);
+        if (numRead == 0 || (numRead == -1 && errno != EAGAIN &&
+                errno != EINTR)) {
+            client->closing = true;
+        }
+        //A last command need not end in a newline
+        if (numRead == 0) {
+            end_partial_line(&client->commands);
+        }
+        char* line;
+        size_t length;
+        while ((line = next_line(&client->commands, &length))) {
+            run_control_command(client, line, jobs);
+        }
+        if (client->commands.end - client->commands.start >
+                MAX_CONTROL_COMMAND) {
+            writer_printf(&client->replies, "Error: Command too long\n");
+            client->closing = true;
+        }
+        flush_writer(&client->replies);
+    }
+    send_control_replies(server, index, reactor);
+}
+
+void run_control_command(ControlClient* client, char* line, Jobs* jobs) {
+    size_t length = strlen(line);
+    if (length && line[length - 1] == '\r') {
+        line[--length] = '\0';
+    }
+    if (!length) {
+        return;
+    }
+
+    //Commands are handled just as they are in the input, where they start
+    //with '*'
+    char* command;
+    if (line[0] == '*') {
+        command = strdup(line);
+    } else if (asprintf(&command, "*%s", line) == -1) {
+        return;
+    }
+    if (handle_command(command, jobs, &client->replies)) {
+        writer_printf(&client->replies, "OK\n");
+    }
+    free(command);
+}
+
+bool queue_control_replies(Writer* writer) {
+    ControlClient* client = writer->context;
+    enqueue_bytes(&client->queue, writer->data, writer->length, false);
+    return true;
+}
+
+void send_control_replies(ControlServer* server, int index,
+        Reactor* reactor) {
+    ControlClient* client = &server->clients[index];
+    FlushResult result = flush_out_queue(&client->queue, client->fd);
+    if (result == FLUSH_BROKEN || (result == FLUSH_EMPTY &&
+            client->closing)) {
+        close_control_client(server, index, reactor);
+        return;
+    }
+    uint32_t events = (client->closing ? 0 : EPOLLIN) |
+            (result == FLUSH_PENDING ? EPOLLOUT : 0);
+    if (events != client->events) {
+        reactor_modify(reactor, client->fd, WATCH_CONTROL_CLIENT, index,
+                events);
+        client->events = events;
+    }
+}
+
+void close_control_client(ControlServer* server, int index,
+        Reactor* reactor) {
+    ControlClient* client = &server->clients[index];
+    reactor_unwatch(reactor, client->fd);
+    close(client->fd);
+    client->fd = -1;
+    free_line_buffer(&client->commands);
+    free_writer(&client->replies);
+    free_out_queue(&client->queue);
+}
+
+void free_control_server(ControlServer* server) {
+    for (int i = 0; i < MAX_CONTROL_CLIENTS; i++) {
+        if (server->clients[i].fd != -1) {
+            close(server->clients[i].fd);
+            server->clients[i].fd = -1;
+        }
+    }
+    if (server->listenFd != -1) {
+        close(server->listenFd);
+        unlink(server->path);
+        server->listenFd = -1;
+    }
+}
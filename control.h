@@ -0,0 +1,165 @@
+#ifndef CONTROL_H
+#define CONTROL_H
+
+#include "job.h"
+#include "reactor.h"
+#include "writer.h"
+#include "linebuf.h"
+#include "outq.h"
+#include "helper.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#define MAX_CONTROL_CLIENTS 16
+//Replies a client has not read beyond this are dropped, oldest first, so
+//that a client that never reads cannot grow them without bound
+#define CONTROL_REPLY_LIMIT (64 * 1024)
+#define MAX_CONTROL_COMMAND 4096
+
+//A connection to the control socket. Every line the client sends is a
+//command, with or without its leading '*', which is carried out between
+//passes of the event loop and answered with its output and then "OK" or
+//its error. Replies are formatted by replies, whose flush queues them in
+//queue to be sent as the client reads them. closing is set once the client
+//has shut down its end, after which it is closed as soon as its replies
+//have been sent. events are the events the client is watched for.
+typedef struct {
+    int fd;
+    LineBuffer commands;
+    Writer replies;
+    OutQueue queue;
+    bool closing;
+    uint32_t events;
+} ControlClient;
+
+//Takes commands on a Unix-domain socket that the reactor watches alongside
+//everything else, so that controlling jobthing never has to go through its
+//input or wait for it.
+typedef struct {
+    int listenFd;
+    char* path;
+    ControlClient clients[MAX_CONTROL_CLIENTS];
+} ControlServer;
+
+#endif //CONTROL_H
+
+/* init_control_server()
+ * ---------------------
+ * Creates the control socket at the given path, replacing a stale socket
+ * left there by an earlier run, and starts listening on it.
+ *
+ * server: the control server to be initialised.
+ *
+ * path: the path of the socket, or NULL if there is no control socket.
+ *
+ * Returns: true if the socket is listening or no path was given, false
+ * otherwise.
+ */
+bool init_control_server(ControlServer* server, char* path);
+
+/* watch_control_server()
+ * ----------------------
+ * Adds the control socket to the reactor, if there is one.
+ *
+ * server: the control server.
+ *
+ * reactor: the reactor to watch the socket with.
+ */
+void watch_control_server(ControlServer* server, Reactor* reactor);
+
+/* accept_control_clients()
+ * ------------------------
+ * Accepts every pending connection to the control socket. Connections
+ * beyond MAX_CONTROL_CLIENTS are closed straight away.
+ *
+ * server: the control server whose socket is ready.
+ *
+ * reactor: the reactor the clients are watched with.
+ */
+void accept_control_clients(ControlServer* server, Reactor* reactor);
+
+/* handle_control_client()
+ * -----------------------
+ * Makes one read of a client's commands, if it has sent any, carries out
+ * every complete command read and sends the client what it can of the
+ * replies. Once the client has shut down its end, a command left without a
+ * newline is carried out too.
+ *
+ * server: the control server.
+ *
+ * index: the client's slot in the server.
+ *
+ * events: the events the client is ready for.
+ *
+ * jobs: the jobs the commands apply to.
+ *
+ * reactor: the reactor the client is watched with.
+ */
+void handle_control_client(ControlServer* server, int index, uint32_t events,
+        Jobs* jobs, Reactor* reactor);
+
+/* run_control_command()
+ * ---------------------
+ * Carries out one command sent by a client and writes its replies.
+ *
+ * client: the client that sent the command.
+ *
+ * line: the command, with or without its leading '*'.
+ *
+ * jobs: the jobs the command applies to.
+ */
+void run_control_command(ControlClient* client, char* line, Jobs* jobs);
+
+/* queue_control_replies()
+ * -----------------------
+ * The flush of a client's replies writer, which queues what has been
+ * written for the client rather than writing it straight away.
+ *
+ * writer: the client's replies writer.
+ *
+ * Returns: true.
+ */
+bool queue_control_replies(Writer* writer);
+
+/* send_control_replies()
+ * ----------------------
+ * Sends a client as much of its queued replies as it will take, watching
+ * it for being writable while some are left. The client is closed if it
+ * has gone away, or if it has shut down its end and every reply is sent.
+ *
+ * server: the control server.
+ *
+ * index: the client's slot in the server.
+ *
+ * reactor: the reactor the client is watched with.
+ */
+void send_control_replies(ControlServer* server, int index,
+        Reactor* reactor);
+
+/* close_control_client()
+ * ----------------------
+ * Closes a client's connection, discarding anything not yet sent, and frees
+ * its slot.
+ *
+ * server: the control server.
+ *
+ * index: the client's slot in the server.
+ *
+ * reactor: the reactor the client is watched with.
+ */
+void close_control_client(ControlServer* server, int index,
+        Reactor* reactor);
+
+/* free_control_server()
+ * ---------------------
+ * Closes the control socket and every client, and removes the socket from
+ * the file system.
+ *
+ * server: the control server to be freed.
+ */
+void free_control_server(ControlServer* server);
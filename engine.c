@@ -0,0 +1,461 @@
+#include "engine.h"
+
+void start_engine(Engine* engine, int numShards, int numJobs, 
+        Params* params, bool trackLatency) {
+    engine->numShards = numShards;
+    engine->numJobs = numJobs;
+    engine->verbose = params->verbose;
+    engine->trackLatency = trackLatency;
+    engine->inputFd = params->inputFile;
+    init_spsc_ring(&engine->input, sizeof(Chunk), INPUT_RING_CHUNKS);
+    engine->inputWakeFd = open_wake_fd();
+    engine->replyWakeFd = open_wake_fd();
+    init_spsc_ring(&engine->mainOutput.ring, sizeof(Chunk), 
+            OUTPUT_RING_CHUNKS);
+    engine->mainOutput.engine = engine;
+    engine->writerWakeFd = open_wake_fd();
+    engine->nextSeq = 0;
+    engine->bytesWritten = 0;
+    engine->numWrites = 0;
+    engine->shards = malloc(sizeof(Shard) * numShards);
+    for (int i = 0; i < numShards; i++) {
+        init_shard(&engine->shards[i], engine, i, numJobs, params);
+    }
+
+    //Output buffered so far is written directly, and the rest is handed
+    //to the writer thread
+    flush_writer(&output);
+    output.flush = hand_off_output;
+    output.context = &engine->mainOutput;
+
+    //Threads inherit the signal mask, so every signal is blocked while they
+    //are created
+    sigset_t allSignals;
+    sigset_t oldSignals;
+    sigfillset(&allSignals);
+    pthread_sigmask(SIG_SETMASK, &allSignals, &oldSignals);
+    bool started = !pthread_create(&engine->writerThread, NULL, 
+            run_output_writer, engine) && 
+            !pthread_create(&engine->readerThread, NULL, run_input_reader, 
+            engine);
+    for (int i = 0; started && i < numShards; i++) {
+        Shard* shard = &engine->shards[i];
+        started = !pthread_create(&shard->thread, NULL, run_shard, shard);
+    }
+    pthread_sigmask(SIG_SETMASK, &oldSignals, NULL);
+    if (!started) {
+        perror("pthread_create");
+        exit(EXIT_FAILURE);
+    }
+    pthread_detach(engine->readerThread);
+}
+
+void init_shard(Shard* shard, Engine* engine, int id, int numJobs, 
+        Params* params) {
+    shard->engine = engine;
+    shard->id = id;
+    init_spsc_ring(&shard->messages, sizeof(ShardMessage), 
+            MESSAGE_RING_SIZE);
+    shard->wakeFd = open_wake_fd();
+    init_spsc_ring(&shard->replies, sizeof(ShardReply), REPLY_RING_SIZE);
+    init_spsc_ring(&shard->output.ring, sizeof(Chunk), OUTPUT_RING_CHUNKS);
+    shard->output.engine = engine;
+    init_writer(&shard->writer, STDOUT_FILENO, params->flushPolicy, 
+            params->flushSize, params->flushDeadlineMs);
+    shard->writer.flush = hand_off_output;
+    shard->writer.framed = params->framed;
+    shard->writer.context = &shard->output;
+    if (!init_reactor(&shard->reactor)) {
+        perror("epoll_create1");
+        exit(EXIT_FAILURE);
+    }
+    reactor_watch(&shard->reactor, shard->wakeFd, WATCH_SHARD_MESSAGES, 0,
+            EPOLLIN);
+
+    //Slots are the job indexes congruent to id modulo the number of shards
+    shard->numJobs = (numJobs - id + engine->numShards - 1) / 
+            engine->numShards;
+    shard->jobs = malloc(sizeof(ShardJob) * shard->numJobs);
+    for (int slot = 0; slot < shard->numJobs; slot++) {
+        ShardJob* job = &shard->jobs[slot];
+        job->index = id + slot * engine->numShards;
+        job->jobNumber = 0;
+        job->fd = -1;
+        init_line_buffer(&job->output);
+        job->output.framed = params->framed;
+        job->killed = false;
+        job->touched = false;
+        job->numLines = 0;
+        job->numBytes = 0;
+        job->readUs = 0;
+    }
+    shard->touched = malloc(sizeof(int) * shard->numJobs);
+    shard->numTouched = 0;
+    shard->pendingCapacity = INITIAL_PENDING_REPLIES;
+    shard->pending = malloc(sizeof(ShardReply) * shard->pendingCapacity);
+    shard->numPending = 0;
+}
+
+int open_wake_fd(void) {
+    int wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeFd == -1) {
+        perror("eventfd");
+        exit(EXIT_FAILURE);
+    }
+    return wakeFd;
+}
+
+void wake_thread(int wakeFd) {
+    uint64_t wakeup = 1;
+    write(wakeFd, &wakeup, sizeof(wakeup));
+}
+
+void clear_wakeups(int wakeFd) {
+    uint64_t wakeups;
+    read(wakeFd, &wakeups, sizeof(wakeups));
+}
+
+void* run_input_reader(void* arg) {
+    Engine* engine = arg;
+    char* data = NULL;
+    while (true) {
+        if (!data) {
+            data = malloc(INPUT_CHUNK_SIZE);
+        }
+        ssize_t numRead = read(engine->inputFd, data, INPUT_CHUNK_SIZE);
+        if (numRead == -1 && (errno == EAGAIN || errno == EINTR)) {
+            //A non-blocking input is waited for here instead
+            struct pollfd readable = {.fd = engine->inputFd, 
+                    .events = POLLIN};
+            poll(&readable, 1, -1);
+            continue;
+        }
+
+        //End of file, or a read error which is treated the same
+        Chunk chunk = {.data = numRead > 0 ? data : NULL, 
+                .length = numRead > 0 ? numRead : 0, .seq = 0};
+        spsc_push_wait(&engine->input, &chunk);
+        wake_thread(engine->inputWakeFd);
+        if (numRead <= 0) {
+            free(data);
+            return NULL;
+        }
+        data = NULL;
+    }
+}
+
+bool next_input_chunk(Engine* engine, Chunk* chunk) {
+    return spsc_pop(&engine->input, chunk);
+}
+
+void wake_input(Engine* engine) {
+    wake_thread(engine->inputWakeFd);
+}
+
+void* run_output_writer(void* arg) {
+    Engine* engine = arg;
+    Writer sink;
+    init_writer(&sink, STDOUT_FILENO, FLUSH_ON_SIZE, 0, 0);
+    while (true) {
+        clear_wakeups(engine->writerWakeFd);
+        Chunk chunk;
+        bool ended = false;
+        while (!ended && next_output_chunk(engine, &chunk)) {
+            if (chunk.data) {
+                writer_append(&sink, chunk.data, chunk.length);
+                free(chunk.data);
+            } else {
+                ended = true;
+            }
+        }
+        flush_writer(&sink);
+        __atomic_store_n(&engine->bytesWritten, sink.bytesWritten, 
+                __ATOMIC_RELAXED);
+        __atomic_store_n(&engine->numWrites, sink.numWrites, 
+                __ATOMIC_RELAXED);
+        if (ended) {
+            free_writer(&sink);
+            return NULL;
+        }
+        struct pollfd woken = {.fd = engine->writerWakeFd, .events = POLLIN};
+        poll(&woken, 1, -1);
+    }
+}
+
+bool next_output_chunk(Engine* engine, Chunk* chunk) {
+    if (!lowest_output_ring(engine)) {
+        return false;
+    }
+    return spsc_pop(lowest_output_ring(engine), chunk);
+}
+
+SpscRing* lowest_output_ring(Engine* engine) {
+    SpscRing* lowest = NULL;
+    unsigned long long lowestSeq = 0;
+    for (int i = -1; i < engine->numShards; i++) {
+        SpscRing* ring = i < 0 ? &engine->mainOutput.ring : 
+                &engine->shards[i].output.ring;
+        Chunk* first = spsc_peek(ring);
+        if (first && (!lowest || first->seq < lowestSeq)) {
+            lowest = ring;
+            lowestSeq = first->seq;
+        }
+    }
+    return lowest;
+}
+
+bool hand_off_output(Writer* writer) {
+    OutputStream* stream = writer->context;
+    Engine* engine = stream->engine;
+    Chunk chunk = {.data = writer->data, .length = writer->length, 
+            .seq = __atomic_fetch_add(&engine->nextSeq, 1, 
+            __ATOMIC_SEQ_CST)};
+    spsc_push_wait(&stream->ring, &chunk);
+    wake_thread(engine->writerWakeFd);
+    writer->data = malloc(writer->capacity);
+    return true;
+}
+
+void send_shard_message(Engine* engine, ShardMessageKind kind, int index,
+        int jobNumber, int fd) {
+    Shard* shard = &engine->shards[index % engine->numShards];
+    ShardMessage message = {.kind = kind, .index = index, 
+            .jobNumber = jobNumber, .fd = fd};
+    spsc_push_wait(&shard->messages, &message);
+    wake_thread(shard->wakeFd);
+}
+
+bool next_shard_reply(Engine* engine, ShardReply* reply) {
+    for (int i = 0; i < engine->numShards; i++) {
+        if (spsc_pop(&engine->shards[i].replies, reply)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void* run_shard(void* arg) {
+    Shard* shard = arg;
+    Reactor* reactor = &shard->reactor;
+    while (true) {
+        //Replies left over from a full ring are retried shortly
+        int timeout = shard->numPending ? SHARD_RETRY_MS : WAIT_FOREVER;
+        int flushTimeout = writer_timeout(&shard->writer);
+        if (flushTimeout != NO_DEADLINE && (timeout == WAIT_FOREVER || 
+                flushTimeout < timeout)) {
+            timeout = flushTimeout;
+        }
+        if (timeout != 0) {
+            writer_idle(&shard->writer);
+        }
+        int numReady = reactor_wait(reactor, timeout);
+        writer_check_deadline(&shard->writer);
+
+        long long readUs = shard->engine->trackLatency ? now_us() : 0;
+        for (int i = 0; i < numReady; i++) {
+            struct epoll_event* event = &reactor->events[i];
+            if (event_kind(event) == WATCH_SHARD_MESSAGES) {
+                if (!handle_shard_messages(shard)) {
+                    flush_writer(&shard->writer);
+                    return NULL;
+                }
+                continue;
+            }
+            //The pipe may have been closed by a message in this pass
+            ShardJob* job = shard_job(shard, event_index(event));
+            if (job->fd != -1) {
+                relay_shard_output(shard, job, readUs);
+            }
+        }
+        send_shard_replies(shard);
+    }
+}
+
+bool handle_shard_messages(Shard* shard) {
+    clear_wakeups(shard->wakeFd);
+    ShardMessage message;
+    while (spsc_pop(&shard->messages, &message)) {
+        if (message.kind == SHARD_STOP) {
+            return false;
+        }
+        ShardJob* job = shard_job(shard, message.index);
+        switch (message.kind) {
+            case SHARD_WATCH:
+                job->jobNumber = message.jobNumber;
+                job->fd = message.fd;
+                job->killed = false;
+                reset_line_buffer(&job->output);
+                reactor_watch(&shard->reactor, job->fd, WATCH_JOB_OUTPUT, 
+                        job->index, EPOLLIN);
+                break;
+            case SHARD_EXITED:
+                drain_shard_job(shard, job);
+                break;
+            case SHARD_KILLED:
+                job->killed = true;
+                break;
+            default:
+                break;
+        }
+    }
+    return true;
+}
+
+ShardJob* shard_job(Shard* shard, int index) {
+    return &shard->jobs[index / shard->engine->numShards];
+}
+
+bool relay_shard_output(Shard* shard, ShardJob* job, long long readUs) {
+    ssize_t numRead = fill_line_buffer(&job->output, job->fd);
+    if (numRead == -1 && (errno == EAGAIN || errno == EINTR)) {
+        return false;
+    }
+
+    char* line;
+    size_t length;
+    while ((line = next_line(&job->output, &length))) {
+        if (!job->killed) {
+            write_relay_line(&shard->writer, job->jobNumber, "->", line, 
+                    length);
+        }
+        job->numLines++;
+        job->numBytes += length + record_overhead(job->output.framed);
+    }
+    job->readUs = readUs;
+    if (!job->touched) {
+        job->touched = true;
+        shard->touched[shard->numTouched++] = job->index / 
+                shard->engine->numShards;
+    }
+
+    if (numRead <= 0) {
+        //End of file, or a read error which is treated the same
+        if (shard->engine->verbose) {
+            fprintf(stderr, "Received EOF from job %d\n", job->jobNumber);
+        }
+        close_shard_job(shard, job);
+        answer_shard_job(shard, job);
+        add_shard_reply(shard, SHARD_OUTPUT_CLOSED, job);
+        return false;
+    }
+    return true;
+}
+
+void drain_shard_job(Shard* shard, ShardJob* job) {
+    long long readUs = shard->engine->trackLatency ? now_us() : 0;
+    bool more = job->fd != -1;
+    while (more) {
+        more = relay_shard_output(shard, job, readUs);
+    }
+    //Whatever still holds the pipe open once the job has exited is not 
+    //waited for
+    if (job->fd != -1) {
+        close_shard_job(shard, job);
+    }
+    answer_shard_job(shard, job);
+    flush_writer(&shard->writer);
+    add_shard_reply(shard, SHARD_DRAINED, job);
+}
+
+void close_shard_job(Shard* shard, ShardJob* job) {
+    reactor_unwatch(&shard->reactor, job->fd);
+    close(job->fd);
+    job->fd = -1;
+}
+
+void answer_shard_job(Shard* shard, ShardJob* job) {
+    if (job->numLines) {
+        add_shard_reply(shard, SHARD_ANSWERED, job);
+        job->numLines = 0;
+        job->numBytes = 0;
+    }
+}
+
+void add_shard_reply(Shard* shard, ShardReplyKind kind, ShardJob* job) {
+    if (shard->numPending == shard->pendingCapacity) {
+        shard->pendingCapacity *= 2;
+        shard->pending = realloc(shard->pending, 
+                sizeof(ShardReply) * shard->pendingCapacity);
+    }
+    ShardReply* reply = &shard->pending[shard->numPending++];
+    reply->kind = kind;
+    reply->index = job->index;
+    reply->numLines = job->numLines;
+    reply->numBytes = job->numBytes;
+    reply->readUs = job->readUs;
+}
+
+void send_shard_replies(Shard* shard) {
+    for (int i = 0; i < shard->numTouched; i++) {
+        ShardJob* job = &shard->jobs[shard->touched[i]];
+        answer_shard_job(shard, job);
+        job->touched = false;
+    }
+    shard->numTouched = 0;
+
+    int numSent = 0;
+    while (numSent < shard->numPending && spsc_push(&shard->replies, 
+            &shard->pending[numSent])) {
+        numSent++;
+    }
+    if (numSent) {
+        shard->numPending -= numSent;
+        memmove(shard->pending, shard->pending + numSent, 
+                sizeof(ShardReply) * shard->numPending);
+        wake_thread(shard->engine->replyWakeFd);
+    }
+}
+
+unsigned long long engine_bytes_written(Engine* engine) {
+    return __atomic_load_n(&engine->bytesWritten, __ATOMIC_RELAXED);
+}
+
+unsigned long long engine_num_writes(Engine* engine) {
+    return __atomic_load_n(&engine->numWrites, __ATOMIC_RELAXED);
+}
+
+void stop_engine(Engine* engine) {
+    for (int i = 0; i < engine->numShards; i++) {
+        send_shard_message(engine, SHARD_STOP, i, 0, -1);
+    }
+    for (int i = 0; i < engine->numShards; i++) {
+        pthread_join(engine->shards[i].thread, NULL);
+    }
+
+    //Every other thread's output now has a lower seq than the end marker
+    flush_writer(&output);
+    Chunk end = {.data = NULL, .length = 0, 
+            .seq = __atomic_fetch_add(&engine->nextSeq, 1, 
+            __ATOMIC_SEQ_CST)};
+    spsc_push_wait(&engine->mainOutput.ring, &end);
+    wake_thread(engine->writerWakeFd);
+    pthread_join(engine->writerThread, NULL);
+    output.flush = write_all;
+
+    for (int i = 0; i < engine->numShards; i++) {
+        free_shard(&engine->shards[i]);
+    }
+    free(engine->shards);
+    free_spsc_ring(&engine->mainOutput.ring);
+    close(engine->replyWakeFd);
+    close(engine->writerWakeFd);
+}
+
+void free_shard(Shard* shard) {
+    for (int slot = 0; slot < shard->numJobs; slot++) {
+        ShardJob* job = &shard->jobs[slot];
+        if (job->fd != -1) {
+            close(job->fd);
+        }
+        free_line_buffer(&job->output);
+    }
+    free(shard->jobs);
+    free(shard->touched);
+    free(shard->pending);
+    free_writer(&shard->writer);
+    free_spsc_ring(&shard->messages);
+    free_spsc_ring(&shard->replies);
+    free_spsc_ring(&shard->output.ring);
+    close_reactor(&shard->reactor);
+    close(shard->wakeFd);
+}
@@ -0,0 +1,455 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include "helper.h"
+#include "parsing.h"
+#include "writer.h"
+#include "reactor.h"
+#include "linebuf.h"
+#include "spsc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <sys/eventfd.h>
+
+#define INPUT_CHUNK_SIZE (64 * 1024)
+#define INPUT_RING_CHUNKS 8
+#define OUTPUT_RING_CHUNKS 8
+#define MESSAGE_RING_SIZE 4096
+#define REPLY_RING_SIZE 4096
+#define INITIAL_PENDING_REPLIES 64
+#define SHARD_RETRY_MS 1
+
+//A buffer handed from one thread to another, which the receiver frees. 
+//Output chunks are stamped with seq when they are handed over, so that the
+//writer thread can put output that one thread wrote because of another's 
+//after it. A chunk without data marks the end of input, or of output.
+typedef struct {
+    char* data;
+    size_t length;
+    unsigned long long seq;
+} Chunk;
+
+//What the main thread tells an I/O thread about one of its jobs: that the
+//job has started with its output on fd, that its process has been reaped,
+//that its input pipe has broken, or, for SHARD_STOP, to stop.
+typedef enum {
+    SHARD_WATCH,
+    SHARD_EXITED,
+    SHARD_KILLED,
+    SHARD_STOP
+} ShardMessageKind;
+
+typedef struct {
+    ShardMessageKind kind;
+    int index;
+    int jobNumber;
+    int fd;
+} ShardMessage;
+
+//What an I/O thread tells the main thread about one of its jobs: that it 
+//relayed numLines lines of numBytes bytes, read at readUs, that the job 
+//closed its output, or that the output of a reaped job has been relayed.
+typedef enum {
+    SHARD_ANSWERED,
+    SHARD_OUTPUT_CLOSED,
+    SHARD_DRAINED
+} ShardReplyKind;
+
+typedef struct {
+    ShardReplyKind kind;
+    int index;
+    int numLines;
+    unsigned long long numBytes;
+    long long readUs;
+} ShardReply;
+
+//An I/O thread's own record of one of its jobs. fd is the read end of the
+//job's output pipe, or -1 once it is closed. The lines and bytes relayed 
+//since they were last reported are counted until the end of the pass.
+typedef struct {
+    int index;
+    int jobNumber;
+    int fd;
+    LineBuffer output;
+    bool killed;
+    bool touched;
+    int numLines;
+    unsigned long long numBytes;
+    long long readUs;
+} ShardJob;
+
+//A ring of output chunks from one thread to the writer thread. It is the
+//context of that thread's writer.
+typedef struct {
+    SpscRing ring;
+    struct Engine* engine;
+} OutputStream;
+
+//An I/O thread, which owns the output pipes of every job whose index is 
+//its id modulo the number of I/O threads. Job index i is kept in slot i / 
+//numShards of jobs. touched lists the slots with lines to report. Replies 
+//wait in pending while the reply ring is full, so that the thread never 
+//blocks on the main thread while the main thread may block on it.
+typedef struct {
+    struct Engine* engine;
+    int id;
+    pthread_t thread;
+    SpscRing messages;
+    int wakeFd;
+    SpscRing replies;
+    OutputStream output;
+    Writer writer;
+    Reactor reactor;
+    ShardJob* jobs;
+    int numJobs;
+    int* touched;
+    int numTouched;
+    ShardReply* pending;
+    int numPending;
+    int pendingCapacity;
+} Shard;
+
+//The threads of threaded mode: an input reader, which passes chunks of 
+//input to the main thread, I/O threads, which relay the output of their
+//shard of the jobs, and a writer, which writes the output of every thread
+//to standard output. The main thread still dispatches input, writes it to
+//the jobs and reaps them, and so owns every job's state. Each thread waits
+//on an eventfd that is written after something is pushed to it. The writer
+//thread's stdout totals are published for the metrics. numJobs is the 
+//number of jobs when the engine was started, which are the only jobs the I/O
+//threads have room for.
+typedef struct Engine {
+    Shard* shards;
+    int numShards;
+    int numJobs;
+    bool verbose;
+    bool trackLatency;
+    pthread_t readerThread;
+    int inputFd;
+    SpscRing input;
+    int inputWakeFd;
+    int replyWakeFd;
+    pthread_t writerThread;
+    OutputStream mainOutput;
+    int writerWakeFd;
+    unsigned long long nextSeq;
+    unsigned long long bytesWritten;
+    unsigned long long numWrites;
+} Engine;
+
+#endif //ENGINE_H
+
+/* start_engine()
+ * --------------
+ * Starts the threads of threaded mode and hands standard output over to the
+ * writer thread. All signals are blocked in the new threads, so that they 
+ * are all handled by the main thread.
+ *
+ * engine: the engine to be started.
+ *
+ * numShards: the number of I/O threads.
+ *
+ * numJobs: the number of jobs. Jobs added later by a reload are relayed by
+ * the main thread.
+ *
+ * params: the setup parameters specified by command line arguments.
+ *
+ * trackLatency: whether response latency is recorded, so that the time 
+ * lines were read is reported.
+ *
+ * Errors: exits with EXIT_FAILURE if a thread or eventfd cannot be created.
+ */
+void start_engine(Engine* engine, int numShards, int numJobs, 
+        Params* params, bool trackLatency);
+
+/* init_shard()
+ * ------------
+ * Initialises an I/O thread's rings, reactor and writer, and its records of
+ * its jobs, which are all closed.
+ *
+ * shard: the I/O thread to be initialised.
+ *
+ * engine: the engine it belongs to.
+ *
+ * id: the number of the I/O thread, from 0.
+ *
+ * numJobs: the total number of jobs.
+ *
+ * params: the setup parameters, whose flush policy the thread's writer 
+ * follows.
+ */
+void init_shard(Shard* shard, Engine* engine, int id, int numJobs, 
+        Params* params);
+
+/* open_wake_fd()
+ * --------------
+ * Returns: a new non-blocking eventfd.
+ *
+ * Errors: exits with EXIT_FAILURE if it cannot be created.
+ */
+int open_wake_fd(void);
+
+/* wake_thread()
+ * -------------
+ * Wakes the thread waiting on an eventfd.
+ *
+ * wakeFd: the eventfd.
+ */
+void wake_thread(int wakeFd);
+
+/* clear_wakeups()
+ * ---------------
+ * Resets an eventfd before what it signalled is looked at, so that anything
+ * pushed afterwards wakes the thread again.
+ *
+ * wakeFd: the eventfd.
+ */
+void clear_wakeups(int wakeFd);
+
+/* run_input_reader()
+ * ------------------
+ * The input reader thread, which reads input in chunks of up to 
+ * INPUT_CHUNK_SIZE and passes them to the main thread, followed by an empty
+ * chunk at end of file. It waits while the main thread is not taking input.
+ *
+ * arg: the engine.
+ *
+ * Returns: NULL once input has ended.
+ */
+void* run_input_reader(void* arg);
+
+/* next_input_chunk()
+ * ------------------
+ * Takes the next chunk of input passed on by the input reader thread.
+ *
+ * engine: the engine.
+ *
+ * chunk: set to the chunk, whose data the caller frees.
+ *
+ * Returns: true if there was a chunk, false otherwise.
+ */
+bool next_input_chunk(Engine* engine, Chunk* chunk);
+
+/* wake_input()
+ * ------------
+ * Makes the main thread look for input again, for when it stopped taking 
+ * chunks while input was paused.
+ *
+ * engine: the engine.
+ */
+void wake_input(Engine* engine);
+
+/* run_output_writer()
+ * -------------------
+ * The writer thread, which writes the output chunks of every thread to 
+ * standard output in order, coalescing the chunks that are waiting into as
+ * few writes as possible. It stops at the chunk without data that 
+ * stop_engine() sends once every other thread has finished.
+ *
+ * arg: the engine.
+ *
+ * Returns: NULL once output has ended.
+ */
+void* run_output_writer(void* arg);
+
+/* next_output_chunk()
+ * -------------------
+ * Takes the output chunk, of those waiting, with the lowest seq. The rings
+ * are looked at a second time once a chunk has been seen, as every chunk 
+ * handed over before it in another thread is then sure to be visible.
+ *
+ * engine: the engine.
+ *
+ * chunk: set to the chunk.
+ *
+ * Returns: true if there was a chunk, false otherwise.
+ */
+bool next_output_chunk(Engine* engine, Chunk* chunk);
+
+/* lowest_output_ring()
+ * --------------------
+ * Returns: the ring whose first chunk has the lowest seq, or NULL if every
+ * ring is empty.
+ */
+SpscRing* lowest_output_ring(Engine* engine);
+
+/* hand_off_output()
+ * -----------------
+ * The flush function of writers in threaded mode. The writer's buffer is 
+ * handed to the writer thread through the writer's OutputStream and 
+ * replaced with a new one.
+ *
+ * writer: the writer whose buffer is to be handed over.
+ *
+ * Returns: true.
+ */
+bool hand_off_output(Writer* writer);
+
+/* send_shard_message()
+ * --------------------
+ * Tells the I/O thread of a job about it.
+ *
+ * engine: the engine.
+ *
+ * kind: what is being told.
+ *
+ * index: the index of the job.
+ *
+ * jobNumber: for SHARD_WATCH, the number of the job.
+ *
+ * fd: for SHARD_WATCH, the read end of the job's output pipe, which the
+ * I/O thread then owns and closes.
+ */
+void send_shard_message(Engine* engine, ShardMessageKind kind, int index,
+        int jobNumber, int fd);
+
+/* next_shard_reply()
+ * ------------------
+ * Takes the next reply from any I/O thread. Replies from one thread are 
+ * taken in the order they were sent.
+ *
+ * engine: the engine.
+ *
+ * reply: set to the reply.
+ *
+ * Returns: true if there was a reply, false otherwise.
+ */
+bool next_shard_reply(Engine* engine, ShardReply* reply);
+
+/* run_shard()
+ * -----------
+ * An I/O thread, which relays the output of its jobs until told to stop.
+ *
+ * arg: the I/O thread's shard.
+ *
+ * Returns: NULL once stopped.
+ */
+void* run_shard(void* arg);
+
+/* handle_shard_messages()
+ * -----------------------
+ * Handles every message waiting for an I/O thread.
+ *
+ * shard: the I/O thread.
+ *
+ * Returns: false if the thread has been told to stop, true otherwise.
+ */
+bool handle_shard_messages(Shard* shard);
+
+/* shard_job()
+ * -----------
+ * Returns: an I/O thread's record of the job with the given index.
+ */
+ShardJob* shard_job(Shard* shard, int index);
+
+/* relay_shard_output()
+ * --------------------
+ * Performs one read from a job's output pipe and relays every complete line
+ * read. At end of file, or on a read error, the pipe is closed and the main
+ * thread told.
+ *
+ * shard: the I/O thread.
+ *
+ * job: the job, whose output is open.
+ *
+ * readUs: the time the read was made, if latency is being tracked.
+ *
+ * Returns: true if anything was read, false otherwise.
+ */
+bool relay_shard_output(Shard* shard, ShardJob* job, long long readUs);
+
+/* drain_shard_job()
+ * -----------------
+ * Relays whatever is left of the output of a job whose process has been 
+ * reaped, closes its pipe and then tells the main thread, which reports 
+ * the job's exit. The output is handed to the writer thread first so that
+ * it comes before the report.
+ *
+ * shard: the I/O thread.
+ *
+ * job: the job.
+ */
+void drain_shard_job(Shard* shard, ShardJob* job);
+
+/* close_shard_job()
+ * -----------------
+ * Stops watching and closes a job's output pipe.
+ *
+ * shard: the I/O thread.
+ *
+ * job: the job, whose output is open.
+ */
+void close_shard_job(Shard* shard, ShardJob* job);
+
+/* answer_shard_job()
+ * ------------------
+ * Reports the lines relayed for a job since they were last reported, if 
+ * there are any.
+ *
+ * shard: the I/O thread.
+ *
+ * job: the job.
+ */
+void answer_shard_job(Shard* shard, ShardJob* job);
+
+/* add_shard_reply()
+ * -----------------
+ * Adds a reply about a job to those waiting to be sent.
+ *
+ * shard: the I/O thread.
+ *
+ * kind: what is being told.
+ *
+ * job: the job, whose counts are sent with SHARD_ANSWERED.
+ */
+void add_shard_reply(Shard* shard, ShardReplyKind kind, ShardJob* job);
+
+/* send_shard_replies()
+ * --------------------
+ * Reports the lines relayed this pass and sends as many waiting replies as
+ * the reply ring has room for, waking the main thread if any were sent.
+ *
+ * shard: the I/O thread.
+ */
+void send_shard_replies(Shard* shard);
+
+/* engine_bytes_written()
+ * ----------------------
+ * Returns: the number of bytes the writer thread has written to standard 
+ * output.
+ */
+unsigned long long engine_bytes_written(Engine* engine);
+
+/* engine_num_writes()
+ * -------------------
+ * Returns: the number of write() calls the writer thread has made to 
+ * standard output.
+ */
+unsigned long long engine_num_writes(Engine* engine);
+
+/* stop_engine()
+ * -------------
+ * Stops the I/O threads once they have handed over their output, then 
+ * hands over the main thread's output and waits for the writer thread to 
+ * write everything out. The input reader is left to end with jobthing.
+ *
+ * engine: the engine to be stopped.
+ */
+void stop_engine(Engine* engine);
+
+/* free_shard()
+ * ------------
+ * Frees the memory associated with an I/O thread that has stopped, closing
+ * any output pipes still open.
+ *
+ * shard: the I/O thread to be freed.
+ */
+void free_shard(Shard* shard);
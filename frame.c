@@ -0,0 +1,18 @@
+#include "frame.h"
+
+void put_frame_length(char* header, size_t length) {
+    header[0] = length >> 24;
+    header[1] = length >> 16;
+    header[2] = length >> 8;
+    header[3] = length;
+}
+
+size_t get_frame_length(const char* header) {
+    const unsigned char* bytes = (const unsigned char*) header;
+    return (size_t) bytes[0] << 24 | bytes[1] << 16 | bytes[2] << 8 | 
+            bytes[3];
+}
+
+size_t record_overhead(bool framed) {
+    return framed ? FRAME_HEADER_LENGTH : 1;
+}
@@ -0,0 +1,54 @@
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define FRAME_HEADER_LENGTH 4
+#define RELAY_HEADER_LENGTH (FRAME_HEADER_LENGTH * 2 + 1)
+#define RECORD_ANSWER '>'
+#define RECORD_ECHO '<'
+#define RECORD_MESSAGE '!'
+#define MESSAGE_JOB_NUMBER 0
+#define FRAME_RESERVE_LIMIT (1024 * 1024)
+
+//In framed mode, data is passed as records rather than lines. Each record
+//is its length as a FRAME_HEADER_LENGTH byte big-endian number followed by
+//that many bytes of any value. Records relayed to stdout carry, after their
+//length, the job number in the same form and a kind byte: RECORD_ANSWER 
+//for a job's output, RECORD_ECHO for input sent to it and RECORD_MESSAGE 
+//for a line of jobthing's own messages, which have job number 
+//MESSAGE_JOB_NUMBER. A relayed record's length covers these 
+//RELAY_HEADER_LENGTH - FRAME_HEADER_LENGTH bytes and the data after them.
+
+#endif //FRAME_H
+
+/* put_frame_length()
+ * ------------------
+ * Writes a length as a frame header.
+ *
+ * header: where the FRAME_HEADER_LENGTH bytes of the header are written.
+ *
+ * length: the length to be written, at most UINT32_MAX.
+ */
+void put_frame_length(char* header, size_t length);
+
+/* get_frame_length()
+ * ------------------
+ * Reads the length in a frame header.
+ *
+ * header: the FRAME_HEADER_LENGTH bytes of the header.
+ *
+ * Returns: the length.
+ */
+size_t get_frame_length(const char* header);
+
+/* record_overhead()
+ * -----------------
+ * Returns: the number of bytes a record or line takes beyond its data: its
+ * frame header if framed, otherwise its newline.
+ */
+size_t record_overhead(bool framed);
@@ -0,0 +1,347 @@
+#include "handover.h"
+
+bool handover_ready(Jobs* jobs) {
+    if (jobs->numHeld || jobs->numWaking) {
+        return false;
+    }
+    for (int i = 0; i < jobs->numberJobs; i++) {
+        if (!out_queue_empty(&jobs->tasks[i].inQueue)) {
+            return false;
+        }
+    }
+    for (int i = 0; i < jobs->numPools; i++) {
+        if (jobs->pools[i].nextRelease < jobs->pools[i].nextSeq) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int handover_timeout(Jobs* jobs) {
+    if (!jobs->handoverPending) {
+        return NO_DEADLINE;
+    }
+    long long remaining = jobs->handoverDeadlineMs - now_ms();
+    return remaining > 0 ? remaining : 0;
+}
+
+void check_handover(Jobs* jobs, Params* params, LineBuffer* input) {
+    if (handover_ready(jobs)) {
+        hand_over(jobs, params, input);
+    } else if (now_ms() >= jobs->handoverDeadlineMs) {
+        //A job that stops taking its input would otherwise hold input back
+        //for good
+        jobs->handoverPending = false;
+        writer_printf(&output, "Error: Unable to hand over\n");
+    }
+}
+
+void hand_over(Jobs* jobs, Params* params, LineBuffer* input) {
+    jobs->handoverPending = false;
+    char* path = jobs->handoverPath ? jobs->handoverPath : params->selfPath;
+    int fd = memfd_create(HANDOVER_NAME, 0);
+    if (!path || fd == -1 || !write_handover(fd, jobs, params, input)) {
+        writer_printf(&output, "Error: Unable to hand over\n");
+        if (fd != -1) {
+            close(fd);
+        }
+        return;
+    }
+    if (params->verbose) {
+        writer_printf(&output, "Handing over to %s\n", path);
+    }
+
+    //Jobs stay jobthing's children across the exec, and what they leave
+    //behind is adopted by it rather than by init
+    keep_job_fds(jobs, true);
+    prctl(PR_SET_CHILD_SUBREAPER, 1);
+    char fdString[MAX_FD_STRING];
+    snprintf(fdString, sizeof(fdString), "%d", fd);
+    setenv(HANDOVER_ENV, fdString, 1);
+    flush_writer(&output);
+    execv(path, params->argv);
+
+    //Nothing has changed if the binary could not be run
+    unsetenv(HANDOVER_ENV);
+    keep_job_fds(jobs, false);
+    close(fd);
+    writer_printf(&output, "Error: Unable to hand over\n");
+}
+
+bool write_handover(int fd, Jobs* jobs, Params* params, LineBuffer* input) {
+    FILE* stream = fdopen(dup(fd), "w");
+    if (!stream) {
+        return false;
+    }
+    HandoverHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = HANDOVER_MAGIC;
+    header.version = HANDOVER_VERSION;
+    header.recordSize = sizeof(JobRecord);
+    header.numJobs = jobs->numberJobs;
+    header.totalWorkers = jobs->totalWorkers;
+    header.inputFd = params->inputFile;
+    header.sleepUntilMs = jobs->sleepUntilMs;
+    header.inputLength = input->end - input->start;
+    fwrite(&header, sizeof(header), 1, stream);
+
+    for (int i = 0; i < jobs->numberJobs; i++) {
+        Job* job = &jobs->tasks[i];
+        JobRecord record;
+        make_job_record(jobs, i, &record);
+        fwrite(&record, sizeof(record), 1, stream);
+        fwrite(job->line, 1, record.lineLength, stream);
+        //Released jobs, and jobs never read from, have no buffer
+        if (record.outputLength) {
+            fwrite(job->output.data + job->output.start, 1, 
+                    record.outputLength, stream);
+        }
+    }
+    fwrite(input->data + input->start, 1, header.inputLength, stream);
+
+    bool written = !ferror(stream);
+    return !fclose(stream) && written;
+}
+
+void make_job_record(Jobs* jobs, int index, JobRecord* record) {
+    Job* job = &jobs->tasks[index];
+    //Cleared so that no padding is left uninitialised
+    memset(record, 0, sizeof(*record));
+    record->state = jobs->states[index];
+    record->pid = jobs->pids[index];
+    record->inFd = job->in.fd;
+    record->outFd = job->out.fd;
+    record->inIsPipe = job->in.isPipe;
+    record->outIsPipe = job->out.isPipe;
+    record->numRestarts = job->numRestarts;
+    record->jobNumber = job->jobNumber;
+    record->startCount = job->startCount;
+    record->inputReceived = job->inputReceived;
+    record->inputBytes = job->inputBytes;
+    record->outputLines = job->outputLines;
+    record->outputBytes = job->outputBytes;
+    record->lastStatus = job->lastStatus;
+    record->restart = job->restart;
+    record->startedMs = job->startedMs;
+    record->restartDelayMs = job->restartDelayMs;
+    record->lastActiveMs = job->lastActiveMs;
+    record->parked = job->parked;
+    record->retiring = job->retiring;
+    record->removed = job->removed;
+    record->usage = job->usage;
+    record->entry = job->entry;
+    record->lineLength = job->entry == index ? strlen(job->line) : 0;
+    record->outputLength = job->output.end - job->output.start;
+    record->outputEof = job->output.eof;
+}
+
+void keep_job_fds(Jobs* jobs, bool keep) {
+    for (int i = 0; i < jobs->numberJobs; i++) {
+        Job* job = &jobs->tasks[i];
+        //Jobs that have never run have no descriptors
+        if (!job->startCount) {
+            continue;
+        }
+        if (job->in.fd != -1) {
+            set_close_on_exec(job->in.fd, !keep);
+        }
+        if (job->out.fd != -1) {
+            set_close_on_exec(job->out.fd, !keep);
+        }
+    }
+}
+
+int handover_fd(void) {
+    char* fdString = getenv(HANDOVER_ENV);
+    if (!fdString) {
+        return -1;
+    }
+    int fd = is_non_neg_int(fdString) ? atoi(fdString) : -1;
+    unsetenv(HANDOVER_ENV);
+    return fd;
+}
+
+bool load_handover(Handover* handover, int fd) {
+    struct stat info;
+    handover->data = NULL;
+    if (fstat(fd, &info) == -1 || info.st_size <
+            (off_t) sizeof(HandoverHeader)) {
+        close(fd);
+        return false;
+    }
+    handover->size = info.st_size;
+    handover->data = malloc(handover->size);
+    size_t numRead = 0;
+    while (numRead < handover->size) {
+        ssize_t result = pread(fd, handover->data + numRead,
+                handover->size - numRead, numRead);
+        if (result <= 0) {
+            break;
+        }
+        numRead += result;
+    }
+    close(fd);
+    memcpy(&handover->header, handover->data, sizeof(HandoverHeader));
+    handover->offset = sizeof(HandoverHeader);
+    return numRead == handover->size &&
+            handover->header.magic == HANDOVER_MAGIC &&
+            handover->header.version == HANDOVER_VERSION &&
+            handover->header.recordSize == sizeof(JobRecord);
+}
+
+bool resume_jobs(Handover* handover, Jobs* jobs, Params* params) {
+    long long startMs = now_ms();
+    JobAttrs defaults;
+    init_job_attrs(&defaults);
+    defaults.forkSpawn = params->forkSpawn;
+    //Jobs were registered when they were first made
+    Params quiet = *params;
+    quiet.verbose = false;
+
+    HandoverHeader* header = &handover->header;
+    for (int i = 0; i < header->numJobs; i++) {
+        JobRecord record;
+        if (handover->offset + sizeof(record) > handover->size) {
+            return false;
+        }
+        memcpy(&record, handover->data + handover->offset, sizeof(record));
+        handover->offset += sizeof(record);
+        if (handover->offset + record.lineLength + record.outputLength >
+                handover->size) {
+            return false;
+        }
+
+        //Replicas are made along with the first job of their entry
+        if (record.entry == i) {
+            JobSpec spec;
+            spec.attrs = defaults;
+            parse_job_line(handover->data + handover->offset,
+                    record.lineLength, &spec);
+            if (!spec.valid || jobs->numberJobs != i) {
+                return false;
+            }
+            add_entry(jobs, &spec, &quiet, NO_INDEX, NO_INDEX);
+            handover->offset += record.lineLength;
+        }
+        if (i >= jobs->numberJobs) {
+            return false;
+        }
+        restore_job(jobs, i, &record, handover->data + handover->offset);
+        handover->offset += record.outputLength;
+
+        //Removed entries are removed again once all their jobs are back
+        Job* first = &jobs->tasks[record.entry];
+        if (record.removed && i == record.entry +
+                first->attrs.maxReplicas - 1) {
+            remove_entry(jobs, record.entry, false);
+        }
+    }
+    if (jobs->numberJobs != header->numJobs || handover->offset +
+            header->inputLength > handover->size) {
+        return false;
+    }
+    jobs->totalWorkers = header->totalWorkers;
+    jobs->sleepUntilMs = header->sleepUntilMs;
+
+    //Input carries on from where it was, not from the start of the file
+    params->inputFile = header->inputFd;
+
+    if (params->verbose) {
+        fprintf(stderr, "Resumed %d jobs in %lld ms\n", jobs->numberJobs,
+                now_ms() - startMs);
+    }
+    return true;
+}
+
+void restore_job(Jobs* jobs, int index, JobRecord* record, char* pending) {
+    Job* job = &jobs->tasks[index];
+    job->numRestarts = record->numRestarts;
+    job->jobNumber = record->jobNumber;
+    if (job->jobNumber) {
+        index_job_number(jobs, job->jobNumber, index);
+    }
+    job->startCount = record->startCount;
+    job->inputReceived = record->inputReceived;
+    job->inputBytes = record->inputBytes;
+    job->outputLines = record->outputLines;
+    job->outputBytes = record->outputBytes;
+    job->lastStatus = record->lastStatus;
+    job->restart = record->restart;
+    job->startedMs = record->startedMs;
+    job->restartDelayMs = record->restartDelayMs;
+    job->lastActiveMs = record->lastActiveMs;
+    job->usage = record->usage;
+
+    //The descriptors were kept open for the exec, and go back to being
+    //closed on exec so that new jobs do not inherit them
+    job->in.isPipe = record->inIsPipe;
+    job->out.isPipe = record->outIsPipe;
+    job->in.fd = record->inFd;
+    job->out.fd = record->outFd;
+    if (job->startCount && job->in.fd != -1) {
+        set_close_on_exec(job->in.fd, true);
+    }
+    if (job->startCount && job->out.fd != -1) {
+        set_close_on_exec(job->out.fd, true);
+    }
+
+    unsigned char flags[] = {JOB_RUNNABLE, JOB_RUNNING, JOB_KILLED,
+            JOB_OUTPUT_OPEN};
+    for (size_t i = 0; i < sizeof(flags); i++) {
+        set_job_state(jobs, index, flags[i], record->state & flags[i]);
+    }
+    set_job_pid(jobs, index, record->pid);
+
+    //The entry's line parks the replicas beyond its minimum, which may no
+    //longer be the ones that are parked
+    if (job->pool != NO_POOL) {
+        Pool* pool = &jobs->pools[job->pool];
+        if (job->parked != record->parked) {
+            pool->numParked += record->parked ? 1 : -1;
+            pool->numActive -= record->parked ? 1 : -1;
+            job->parked = record->parked;
+        }
+        if (record->retiring) {
+            job->retiring = true;
+            pool->numActive--;
+        }
+    }
+    append_line_buffer(&job->output, pending, record->outputLength);
+    job->output.eof = record->outputEof;
+}
+
+void watch_resumed_jobs(Jobs* jobs, Reactor* reactor) {
+    for (int i = 0; i < jobs->numberJobs; i++) {
+        Job* job = &jobs->tasks[i];
+        if (!job->startCount) {
+            continue;
+        }
+        if (job_state(jobs, i, JOB_OUTPUT_OPEN) && job->out.isPipe) {
+            reactor_watch(reactor, job->out.fd, WATCH_JOB_OUTPUT, i,
+                    EPOLLIN);
+            //Lines read but not relayed before the exec are relayed first
+            mark_output_ready(jobs, i);
+        }
+        register_job_files(jobs, job);
+    }
+}
+
+void resume_operation(Handover* handover, Params* params, LineBuffer* input,
+        Jobs* jobs, TimerWheel* wheel, Reactor* reactor) {
+    for (int i = 0; i < jobs->numberJobs; i++) {
+        Job* job = &jobs->tasks[i];
+        if (job_state(jobs, i, JOB_RUNNING)) {
+            watch_job_idle(jobs, job, wheel);
+        } else if (job->restart && job_state(jobs, i, JOB_RUNNABLE)) {
+            //Waits out its last delay again, as when it was due is lost
+            schedule_timer(wheel, i, job->restartDelayMs);
+        }
+    }
+
+    append_line_buffer(input, handover->data + handover->offset,
+            handover->header.inputLength);
+    process_input_lines(params, input, jobs);
+    flush_job_inputs(jobs, reactor);
+    free(handover->data);
+    handover->data = NULL;
+}
@@ -0,0 +1,260 @@
+#ifndef HANDOVER_H
+#define HANDOVER_H
+
+#include "job.h"
+#include "reload.h"
+#include "linebuf.h"
+#include "reactor.h"
+#include "timerwheel.h"
+#include "usage.h"
+#include "helper.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/stat.h>
+
+#define HANDOVER_ENV "JOBTHING_HANDOVER"
+#define HANDOVER_NAME "jobthing-handover"
+#define HANDOVER_MAGIC 0x6a746876
+//Bumped whenever the records change, so that binaries that would read each
+//other's records wrongly refuse to resume instead
+#define HANDOVER_VERSION 1
+#define MAX_FD_STRING 16
+
+//The start of the memfd a handover is written to. inputFd is the
+//descriptor input is read from, kept open across the exec, and
+//inputLength the length of the input read but not yet handled, which ends
+//the memfd.
+typedef struct {
+    unsigned magic;
+    unsigned version;
+    size_t recordSize;
+    int numJobs;
+    int totalWorkers;
+    int inputFd;
+    long long sleepUntilMs;
+    size_t inputLength;
+} HandoverHeader;
+
+//What is handed over of each job, in index order, each followed by the
+//lineLength bytes of its entry's line if it is the first job of its entry,
+//and then the outputLength bytes of output read from it but not yet
+//relayed. The job's pipes are kept open across the exec, as inFd and
+//outFd, and its process stays jobthing's child. Everything else is made
+//again from the entry's line.
+typedef struct {
+    unsigned char state;
+    pid_t pid;
+    int inFd;
+    int outFd;
+    bool inIsPipe;
+    bool outIsPipe;
+    int numRestarts;
+    int jobNumber;
+    int startCount;
+    int inputReceived;
+    unsigned long long inputBytes;
+    unsigned long long outputLines;
+    unsigned long long outputBytes;
+    int lastStatus;
+    bool restart;
+    long long startedMs;
+    long long restartDelayMs;
+    long long lastActiveMs;
+    bool parked;
+    bool retiring;
+    bool removed;
+    Usage usage;
+    int entry;
+    size_t lineLength;
+    size_t outputLength;
+    bool outputEof;
+} JobRecord;
+
+//A handover read back by the binary that was exec'd. offset is where the
+//input still to be handled starts in data.
+typedef struct {
+    char* data;
+    size_t size;
+    HandoverHeader header;
+    size_t offset;
+} Handover;
+
+#endif //HANDOVER_H
+
+/* handover_ready()
+ * ----------------
+ * Returns: true if nothing would be lost by handing over now: every job's
+ * input queue is empty, every ordered line has been answered and no
+ * rollout is under way. false otherwise.
+ */
+bool handover_ready(Jobs* jobs);
+
+/* handover_timeout()
+ * ------------------
+ * Returns: the milliseconds until a pending handover is given up on, or 
+ * NO_DEADLINE if none is pending.
+ */
+int handover_timeout(Jobs* jobs);
+
+/* check_handover()
+ * ----------------
+ * Hands over once nothing would be lost by it, or gives up on the handover
+ * if that has not happened within HANDOVER_TIMEOUT_MS, reporting it and
+ * reading input again.
+ *
+ * jobs: pointer to array containing the jobs
+ *
+ * params: the setup parameters specified by command line arguments
+ *
+ * input: input read but not yet handled
+ */
+void check_handover(Jobs* jobs, Params* params, LineBuffer* input);
+
+/* hand_over()
+ * -----------
+ * Writes the jobs to a memfd, keeps their pipes open and execs the binary
+ * the handover was asked for with jobthing's own arguments, naming the
+ * memfd in HANDOVER_ENV. jobthing is made a child subreaper first, so that
+ * it, and the binary after it, reap whatever its jobs leave behind.
+ *
+ * jobs: pointer to array containing the jobs
+ *
+ * params: the setup parameters specified by command line arguments
+ *
+ * input: input read but not yet handled, which is handed over too
+ *
+ * Errors: if the memfd cannot be written or the binary cannot be run,
+ * reports it and returns with nothing changed.
+ */
+void hand_over(Jobs* jobs, Params* params, LineBuffer* input);
+
+/* write_handover()
+ * ----------------
+ * Writes the header, every job's record and the input still to be handled
+ * to a handover's memfd.
+ *
+ * fd: the memfd.
+ *
+ * jobs: pointer to array containing the jobs
+ *
+ * params: the setup parameters specified by command line arguments
+ *
+ * input: input read but not yet handled
+ *
+ * Returns: true if it was all written, false otherwise.
+ */
+bool write_handover(int fd, Jobs* jobs, Params* params, LineBuffer* input);
+
+/* make_job_record()
+ * -----------------
+ * Fills in the record a job is handed over with.
+ *
+ * jobs: pointer to array containing the jobs
+ *
+ * index: the index of the job
+ *
+ * record: the record to be filled in
+ */
+void make_job_record(Jobs* jobs, int index, JobRecord* record);
+
+/* keep_job_fds()
+ * --------------
+ * Keeps every job's open descriptors open across an exec, or goes back to
+ * closing them on exec.
+ *
+ * jobs: pointer to array containing the jobs
+ *
+ * keep: true to keep them open across an exec
+ */
+void keep_job_fds(Jobs* jobs, bool keep);
+
+/* handover_fd()
+ * -------------
+ * Finds the memfd named in HANDOVER_ENV and removes it from the environment,
+ * so that jobs started from now on do not see it.
+ *
+ * Returns: the memfd, or -1 if jobthing was not started by a handover.
+ */
+int handover_fd(void);
+
+/* load_handover()
+ * ---------------
+ * Reads a handover back from its memfd, which is then closed.
+ *
+ * handover: the handover to be filled in.
+ *
+ * fd: the memfd.
+ *
+ * Returns: true if the handover was read and was written by a binary with
+ * the same records, false otherwise.
+ */
+bool load_handover(Handover* handover, int fd);
+
+/* resume_jobs()
+ * -------------
+ * Makes the jobs of a handover again from their entries' lines and takes
+ * over their processes, pipes, counters and stats, in place of loading the
+ * jobfile. The input is read from the descriptor that was handed over.
+ *
+ * handover: the handover that was read.
+ *
+ * jobs: pointer to jobs struct that is to be populated
+ *
+ * params: the setup parameters specified by command line arguments
+ *
+ * Returns: true if every job was resumed, false if the handover does not
+ * make sense to this binary.
+ */
+bool resume_jobs(Handover* handover, Jobs* jobs, Params* params);
+
+/* restore_job()
+ * -------------
+ * Takes over a job's state from its record.
+ *
+ * jobs: pointer to array containing the jobs
+ *
+ * index: the index of the job, which has been made from its entry's line
+ *
+ * record: the job's record
+ *
+ * pending: the output read from the job but not yet relayed
+ */
+void restore_job(Jobs* jobs, int index, JobRecord* record, char* pending);
+
+/* watch_resumed_jobs()
+ * --------------------
+ * Watches the output of every resumed job that still has it open, and has
+ * any output already read relayed.
+ *
+ * jobs: pointer to array containing the jobs
+ *
+ * reactor: the reactor the jobs are watched with
+ */
+void watch_resumed_jobs(Jobs* jobs, Reactor* reactor);
+
+/* resume_operation()
+ * ------------------
+ * Picks up where the handover left off once the event loop is set up:
+ * schedules the restarts that were waiting and the idle checks of running
+ * jobs, and handles the input that was handed over. The handover is then
+ * freed.
+ *
+ * handover: the handover that was read.
+ *
+ * params: the setup parameters specified by command line arguments
+ *
+ * input: the buffer input is read into.
+ *
+ * jobs: pointer to array containing the jobs
+ *
+ * wheel: the timer wheel restarts and idle checks are scheduled on
+ *
+ * reactor: the reactor the jobs are watched with
+ */
+void resume_operation(Handover* handover, Params* params, LineBuffer* input,
+        Jobs* jobs, TimerWheel* wheel, Reactor* reactor);
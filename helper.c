@@ -21,13 +21,95 @@ bool is_non_neg_int(char* line) {
     return true;
 }
 
-int extract_validate_int(char* line, char* name) {
+int extract_validate_int(char* line, char* name, Writer* replies) {
     char* pEnd;
     int value = strtol(line, &pEnd, 10);
     if (value == 0 || *pEnd != '\0') {
-        printf("Error: Invalid %s\n", name);
+        writer_printf(replies, "Error: Invalid %s\n", name);
         return -1;
     }
     return value;
 }
 
+void set_nonblocking(int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+void set_close_on_exec(int fd, bool closeOnExec) {
+    fcntl(fd, F_SETFD, closeOnExec ? FD_CLOEXEC : 0);
+}
+
+long long now_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long) now.tv_sec * MS_PER_SECOND + now.tv_nsec / NS_PER_MS;
+}
+
+long long now_us(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long) now.tv_sec * US_PER_SECOND + now.tv_nsec / NS_PER_US;
+}
+
+bool parse_size(char* line, size_t* size) {
+    char* pEnd;
+    if (!isdigit(line[0])) {
+        return false;
+    }
+    unsigned long long value = strtoull(line, &pEnd, 10);
+    switch (toupper(*pEnd)) {
+        case 'G':
+            value *= KIBIBYTE;
+            //Fall through
+        case 'M':
+            value *= KIBIBYTE;
+            //Fall through
+        case 'K':
+            value *= KIBIBYTE;
+            pEnd++;
+            break;
+    }
+    *size = value;
+    return *pEnd == '\0';
+}
+
+bool parse_duration(char* line, long long* durationMs) {
+    char* pEnd;
+    if (!isdigit(line[0])) {
+        return false;
+    }
+    long long value = strtoll(line, &pEnd, 10);
+    if (!strcmp(pEnd, "s")) {
+        value *= MS_PER_SECOND;
+    } else if (strcmp(pEnd, "ms") && *pEnd != '\0') {
+        return false;
+    }
+    *durationMs = value;
+    return true;
+}
+
+int listen_unix_socket(char* path, int backlog) {
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strcpy(address.sun_path, path);
+
+    //A socket left behind by a run that did not exit cleanly is replaced,
+    //but nothing else is removed
+    struct stat info;
+    if (!lstat(path, &info) && S_ISSOCK(info.st_mode)) {
+        unlink(path);
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd != -1 && (bind(fd, (struct sockaddr*)&address, 
+            sizeof(address)) == -1 || listen(fd, backlog) == -1)) {
+        close(fd);
+        fd = -1;
+    }
+    return fd;
+}
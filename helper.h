@@ -6,6 +6,20 @@
 #include <string.h>
 #include <stdbool.h>
 #include <ctype.h>
+#include <fcntl.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "writer.h"
+
+#define MS_PER_SECOND 1000
+#define NS_PER_MS 1000000
+#define US_PER_SECOND 1000000
+#define NS_PER_US 1000
+#define KIBIBYTE 1024
 
 #endif //HELPER_H
 
@@ -41,7 +55,77 @@ bool is_non_neg_int(char* line);
  *
  * name: the name of the value
  *
+ * replies: where an invalid value is reported
+ *
  * Returns: the value contained in the line or -1 if the line is invalid.
  * Errors: returns -1 on invalid line i.e., not an int
  */
-int extract_validate_int(char* line, char* name);
+int extract_validate_int(char* line, char* name, Writer* replies);
+
+/* set_nonblocking()
+ * -----------------
+ * Puts a file descriptor into non-blocking mode.
+ *
+ * fd: the file descriptor to be changed
+ */
+void set_nonblocking(int fd);
+
+/* set_close_on_exec()
+ * -------------------
+ * Sets or clears a file descriptor's close-on-exec flag.
+ *
+ * fd: the file descriptor to be changed
+ *
+ * closeOnExec: true to close it on exec, false to keep it open
+ */
+void set_close_on_exec(int fd, bool closeOnExec);
+
+/* now_ms()
+ * --------
+ * Returns: the current time of the monotonic clock in milliseconds.
+ */
+long long now_ms(void);
+
+/* now_us()
+ * --------
+ * Returns: the current time of the monotonic clock in microseconds.
+ */
+long long now_us(void);
+
+/* parse_size()
+ * ------------
+ * Parses a non-negative number of bytes with an optional K, M or G suffix,
+ * e.g., "64K".
+ *
+ * line: the line containing the size
+ *
+ * size: set to the number of bytes
+ *
+ * Returns: true if the line is a valid size, false otherwise.
+ */
+bool parse_size(char* line, size_t* size);
+
+/* parse_duration()
+ * ----------------
+ * Parses a non-negative duration in milliseconds with an optional "ms" or 
+ * "s" suffix, e.g., "250ms" or "30s".
+ * line: the line containing the duration
+ * durationMs: set to the duration in milliseconds
+ * Returns: true if the line is a valid duration, false otherwise.
+ */
+bool parse_duration(char* line, long long* durationMs);
+
+/* listen_unix_socket()
+ * --------------------
+ * Creates a non-blocking Unix-domain stream socket at the given path, 
+ * replacing a stale socket left there by an earlier run, and starts 
+ * listening on it.
+ *
+ * path: the path of the socket
+ *
+ * backlog: the most connections left waiting to be accepted
+ *
+ * Returns: the listening socket.
+ * Errors: returns -1 if the socket could not be created.
+ */
+int listen_unix_socket(char* path, int backlog);
@@ -1,182 +1,583 @@
 #include "job.h"
+#include "signals.h"
 
-void populate_jobs(Jobs* jobs, Params*  params) {
-    char* buffer;
-    while ((buffer = read_line(params->jobFile))) { 
-        if (buffer[0] == COMMENT || strlen(buffer) == 0) {
-            free(buffer);
-            continue;
+void populate_jobs(Jobs* jobs, Params* params) {
+    long long startMs = now_ms();
+    JobAttrs defaults;
+    init_job_attrs(&defaults);
+    defaults.forkSpawn = params->forkSpawn;
+    JobFile jobFile;
+    if (!load_jobfile(&jobFile, params->jobFile, &defaults)) {
+        fprintf(stderr, "Error: Unable to read job file\n");
+        exit(INVALID_JOBFILE_EXIT);
+    }
+
+    //Every job's strings are copied into the arena from one allocation
+    size_t stringBytes = 0;
+    for (int i = 0; i < jobFile.numChunks; i++) {
+        JobChunk* chunk = &jobFile.chunks[i];
+        for (int j = 0; j < chunk->numSpecs; j++) {
+            JobSpec* spec = &chunk->specs[j];
+            if (spec->valid) {
+                stringBytes += (ARENA_ROUND(spec->cmd.length + 1) + 
+                        ARENA_ROUND(spec->input.length + 1) + 
+                        ARENA_ROUND(spec->output.length + 1)) * 
+                        spec->attrs.maxReplicas;
+            }
         }
-       
-        //Create duplicate of buffer as split_line() changes the string.
-        char* tempBuffer = strdup(buffer);
-        char** jobTokens = split_line(tempBuffer, ':');
-
-        //Checks for valid format
-        if (char_occurrences(buffer, ':') != 3 || 
-                (!is_non_neg_int(jobTokens[NUMBER_RESTARTS_POSITION]) && 
-                strcmp(jobTokens[NUMBER_RESTARTS_POSITION], "")) ||
-                !correct_cmd_format(jobTokens[COMMAND_POSITION])) {
-            if (params->verbose) {
-                fprintf(stderr, "Error: invalid job specification: %s\n",
-                        buffer);
+    }
+    reserve_arena(&jobs->strings, stringBytes);
+
+    //Chunks are in file order, so jobs are numbered as they appear
+    for (int i = 0; i < jobFile.numChunks; i++) {
+        JobChunk* chunk = &jobFile.chunks[i];
+        for (int j = 0; j < chunk->numSpecs; j++) {
+            JobSpec* spec = &chunk->specs[j];
+            if (!spec->valid) {
+                if (params->verbose) {
+                    fprintf(stderr, "Error: invalid job specification: "
+                            "%.*s\n", (int) spec->line.length, 
+                            spec->line.start);
+                }
+                continue;
             }
-            free(buffer);
-            free(tempBuffer);
-            free(jobTokens);
-            continue;
+            add_entry(jobs, spec, params, NO_INDEX, NO_INDEX);
         }
-        
+    }
+    free_jobfile(&jobFile);
+    fclose(params->jobFile);
+
+    if (params->verbose) {
+        fprintf(stderr, "Loaded %d jobs from the job file in %lld ms\n", 
+                jobs->numberJobs, now_ms() - startMs);
+    }
+}
+
+int add_entry(Jobs* jobs, JobSpec* spec, Params* params, int replaces, 
+        int entry) {
+    //Jobs with cpus=auto are dealt jobthing's CPUs in turn
+    cpu_set_t available;
+    if (spec->attrs.placement.numCpuRanges == SPREAD_CPUS && 
+            sched_getaffinity(0, sizeof(available), &available) == -1) {
+        CPU_ZERO(&available);
+    }
+    if (entry == NO_INDEX) {
+        entry = jobs->numberJobs;
+    }
+    uint64_t specHash = hash_line_key(spec->line.start, spec->line.length, 
+            WHOLE_LINE_KEY);
+    char* line = arena_strndup(&jobs->strings, spec->line.start, 
+            spec->line.length);
+
+    //Each replica is a job of its own, with its own restarts
+    for (int replica = 0; replica < spec->attrs.maxReplicas; replica++) {
+        int index = entry + replica;
         //Checks for space in jobs array
-        if (jobs->numberJobs + 1 >= jobs->size) {
-            jobs->size *= 2;
-            jobs->tasks = realloc(jobs->tasks, sizeof(Job) * jobs->size);
+        if (index == jobs->numberJobs) {
+            if (jobs->numberJobs + 1 >= jobs->size) {
+                grow_jobs(jobs);
+            }
+            jobs->numberJobs++;
         }
 
-        jobs->tasks[jobs->numberJobs] = make_job(jobTokens, params->verbose,
-                jobs->numberJobs);
-        jobs->numberJobs++;
-        free(buffer);
-        free(jobTokens);
-        free(tempBuffer);
+        jobs->states[index] = 0;
+        jobs->pids[index] = NO_PID;
+        Job* job = &jobs->tasks[index];
+        make_job(job, spec, &jobs->strings, params->verbose, index);
+        job->entry = entry;
+        job->specHash = specHash;
+        job->replaces = replaces;
+        job->line = line;
+        if (job->attrs.placement.numCpuRanges == SPREAD_CPUS) {
+            spread_cpus(&job->attrs.placement, &available, 
+                    jobs->numSpread++);
+        }
+        job->output.framed = params->framed;
+        job->inQueue.framed = params->framed;
+        if (job_pooled(&job->attrs)) {
+            join_pool(jobs, job, spec, replica);
+        } else {
+            jobs->numBroadcastJobs++;
+        }
+        //A replacement waits for its turn in the rollout. Parked jobs are 
+        //runnable, so jobthing waits for input to start them.
+        if (replaces != NO_INDEX) {
+            job->held = true;
+            jobs->numHeld++;
+        } else if (job->parked) {
+            set_job_state(jobs, job->index, JOB_RUNNABLE, true);
+        }
     }
-    fclose(params->jobFile);
+    return entry;
 }
 
-void restart_job(Job* job, bool verbose) {
-    job->killed = false;
+void release_removed_job(Jobs* jobs, Job* job) {
+    int index = job->index;
+    //Answers an ordered pool has yet to release are still in its buffer
+    if (!job->removed || job->released || job->outputPending || 
+            job->waking || job_state(jobs, index, JOB_RUNNABLE) || 
+            job_state(jobs, index, JOB_RUNNING) || 
+            job_state(jobs, index, JOB_OUTPUT_OPEN) || 
+            has_buffered_line(&job->output)) {
+        return;
+    }
+    job->released = true;
     job->restart = false;
-    init_in_out(job->out);
-    init_in_out(job->in);
-    start_job(job, NULL, true, verbose);
+    free_line_buffer(&job->output);
+    free_out_queue(&job->inQueue);
+    free_latency(&job->latency);
+    if (job->pool != NO_POOL) {
+        remove_pool_member(&jobs->pools[job->pool], index);
+    }
+    if (job->jobNumber) {
+        index_job_number(jobs, job->jobNumber, NO_INDEX);
+    }
 }
 
-void reap_process_job(Job* job, bool verbose) {
+void schedule_restart(Jobs* jobs, Job* job, TimerWheel* wheel, 
+        Reactor* reactor, bool verbose) {
+    long long delayMs = next_restart_delay(job);
+    if (delayMs) {
+        schedule_timer(wheel, job->index, delayMs);
+    } else {
+        restart_job(jobs, job, reactor, verbose);
+        watch_job_idle(jobs, job, wheel);
+    }
+}
+
+long long next_restart_delay(Job* job) {
+    JobAttrs* attrs = &job->attrs;
+    long long delayMs = attrs->restartDelayMs;
+    if (job->restartDelayMs) {
+        delayMs = job->restartDelayMs * attrs->backoffFactor;
+    }
+    if (delayMs > attrs->maxRestartDelayMs) {
+        delayMs = attrs->maxRestartDelayMs;
+    }
+    job->restartDelayMs = delayMs;
+
+    long long jitterMs = delayMs * attrs->jitterPercent / 100;
+    if (jitterMs) {
+        delayMs += random() % (2 * jitterMs + 1) - jitterMs;
+    }
+    return delayMs;
+}
+
+void restart_job(Jobs* jobs, Job* job, Reactor* reactor, bool verbose) {
+    set_job_state(jobs, job->index, JOB_KILLED, false);
+    job->restart = false;
+    init_in_out(&job->out);
+    init_in_out(&job->in);
+    start_job(jobs, job, true, reactor, verbose);
+}
+
+void reap_process_job(Jobs* jobs, Job* job, Reactor* reactor, 
+        bool verbose) {
+    //A pid of NO_PID would have wait4() reap any child in the process group
+    if (jobs->pids[job->index] == NO_PID) {
+        return;
+    }
     int status;
-    switch (waitpid(job->pid, &status, WNOHANG)) {
+    struct rusage usage;
+    switch (wait4(jobs->pids[job->index], &status, WNOHANG, &usage)) {
         case 0:
             return;
         case -1:
             //Accounts for error
             return;
         default:
-            if (WIFEXITED(status)) {
-                printf("Job %d has terminated with exit code %d\n", 
-                        job->jobNumber, WEXITSTATUS(status));
-            } else if (WIFSIGNALED(status)) {
-                printf("Job %d has terminated due to signal %d\n", 
-                        job->jobNumber, WTERMSIG(status)); 
-            }
-            fflush(stdout); 
-            close_job_fds(job);
+            job_exited(jobs, job, status, &usage, reactor, verbose);
+    }
+}
 
-            //Update variables tracking job state 
-            if (--(job->numRestarts) == 0) {
-                job->runnable = false;
-            } else {
-                job->restart = true; 
-            }
+void job_exited(Jobs* jobs, Job* job, int status, struct rusage* usage, 
+        Reactor* reactor, bool verbose) {
+    set_job_state(jobs, job->index, JOB_RUNNING, false);
+    set_job_pid(jobs, job->index, NO_PID);
+    if (job->pidFd != -1) {
+        reactor_unwatch(reactor, job->pidFd);
+        close(job->pidFd);
+        job->pidFd = -1;
+    }
+    job->lastStatus = status;
+    add_usage(&job->usage, usage);
+    if (job_on_engine(jobs, job)) {
+        send_shard_message(jobs->engine, SHARD_EXITED, job->index, 
+                job->jobNumber, -1);
+        jobs->numDraining++;
+        return;
     }
+    drain_job_output(jobs, job, reactor, verbose);
+    finish_job_exit(jobs, job, reactor);
+}
+
+void finish_job_exit(Jobs* jobs, Job* job, Reactor* reactor) {
+    int status = job->lastStatus;
+    //Lines the process had not answered will not be answered now
+    forget_pending_lines(&job->latency);
+    forget_ordered_lines(jobs, job);
+    job->inFlight = 0;
+    if (WIFEXITED(status)) {
+        writer_printf(&output, "Job %d has terminated with exit code %d\n", 
+                job->jobNumber, WEXITSTATUS(status));
+    } else if (WIFSIGNALED(status)) {
+        writer_printf(&output, "Job %d has terminated due to signal %d\n", 
+                job->jobNumber, WTERMSIG(status)); 
+    }
+    discard_job_input(jobs, job, reactor);
+    close_job_fds(jobs, job);
+
+    //A job that stayed up for a while starts its backoff afresh
+    if (now_ms() - job->startedMs >= BACKOFF_RESET_MS) {
+        job->restartDelayMs = 0;
+    }
+
+    //A job a reload removed is done with once it exits
+    if (job->removed) {
+        job->retiring = false;
+        set_job_state(jobs, job->index, JOB_RUNNABLE, false);
+        if (job->rolling) {
+            job->rolling = false;
+            jobs->numRolling--;
+        }
+        release_removed_job(jobs, job);
+        return;
+    }
+
+    //A retired job waits to be woken rather than restarted
+    if (job->retiring) {
+        job->retiring = false;
+        job->parked = true;
+        jobs->pools[job->pool].numParked++;
+        return;
+    }
+
+    //Update variables tracking job state 
+    if (--(job->numRestarts) == 0) {
+        set_job_state(jobs, job->index, JOB_RUNNABLE, false);
+    } else {
+        job->restart = true; 
+    }
+}
+
+bool job_state(Jobs* jobs, int index, unsigned char flag) {
+    return jobs->states[index] & flag;
+}
+
+void set_job_state(Jobs* jobs, int index, unsigned char flag, bool set) {
+    unsigned char old = jobs->states[index];
+    unsigned char new = set ? old | flag : old & ~flag;
+    jobs->states[index] = new;
+
+    //Killed jobs count as unrunnable
+    bool wasViable = (old & (JOB_RUNNABLE | JOB_KILLED)) == JOB_RUNNABLE;
+    bool isViable = (new & (JOB_RUNNABLE | JOB_KILLED)) == JOB_RUNNABLE;
+    jobs->numRunnable += isViable - wasViable;
+    jobs->numRunning += !!(new & JOB_RUNNING) - !!(old & JOB_RUNNING);
+    jobs->numOutputsOpen += !!(new & JOB_OUTPUT_OPEN) - 
+            !!(old & JOB_OUTPUT_OPEN);
+}
+
+void set_job_pid(Jobs* jobs, int index, pid_t pid) {
+    if (jobs->pids[index] != NO_PID) {
+        pid_map_remove(&jobs->pidIndex, jobs->pids[index]);
+    }
+    jobs->pids[index] = pid;
+    if (pid != NO_PID) {
+        pid_map_put(&jobs->pidIndex, pid, index);
+    }
+}
+
+Job* find_job_by_number(Jobs* jobs, int jobNumber) {
+    if (jobNumber < 1 || jobNumber > jobs->totalWorkers || 
+            jobs->numberIndex[jobNumber - 1] == NO_INDEX) {
+        return NULL;
+    }
+    return &jobs->tasks[jobs->numberIndex[jobNumber - 1]];
 }
 
 void init_job(Job* job) {
+    job->jobNumber = 0;
+    job->outputPending = false;
+    job->inputWatched = false;
+    job->inputClosing = false;
+    job->inputBlocked = false;
+    init_line_buffer(&job->output);
     job->startCount = 0;
     job->inputReceived = 0;
-    job->killed = false;
+    job->inputBytes = 0;
+    job->outputLines = 0;
+    job->outputBytes = 0;
+    job->lastStatus = NO_STATUS;
+    init_latency(&job->latency);
+    job->pool = NO_POOL;
+    job->inFlight = 0;
+    job->parked = false;
+    job->waking = false;
+    job->retiring = false;
+    job->lastActiveMs = 0;
+    job->outputMore = false;
+    job->lateLines = 0;
+    init_usage(&job->usage);
+    job->entry = 0;
+    job->specHash = 0;
+    job->held = false;
+    job->replaces = NO_INDEX;
+    job->removed = false;
+    job->rolling = false;
+    job->released = false;
+    job->line = NULL;
     job->restart = false;
+    job->pidFd = -1;
+    job->startedMs = 0;
+    job->restartDelayMs = 0;
 }
 
 void close_all_runnable_fds(Jobs* jobs) {
     int numberJobs = jobs->numberJobs;
     for (int i = 0; i < numberJobs; i++) {
-        Job* job = jobs->tasks[i];
-        if (job->runnable) {
-            close_job_fds(job);
+        if (job_state(jobs, i, JOB_RUNNABLE)) {
+            close_job_fds(jobs, &jobs->tasks[i]);
         }
     }
 }
 
-void close_job_fds(Job* job) {
-    close(job->in->fd);
-    if (job->out->isPipe) {
-        fclose(job->wrappedOutput);
-    } else {
-        close(job->out->fd);
+void close_job_fds(Jobs* jobs, Job* job) {
+    close(job->in.fd);
+    close(job->out.fd);
+    job->in.fd = -1;
+    job->out.fd = -1;
+    set_job_state(jobs, job->index, JOB_OUTPUT_OPEN, false);
+    register_job_files(jobs, job);
+}
+
+void close_job_input(Jobs* jobs, Job* job) {
+    close(job->in.fd);
+    job->in.fd = -1;
+    register_job_files(jobs, job);
+}
+
+void register_job_files(Jobs* jobs, Job* job) {
+    if (!jobs->uring) {
+        return;
     }
+    //A registered file stays open until it leaves its slot
+    int slot = job->index * FILE_SLOTS_PER_JOB;
+    uring_set_file(jobs->uring, slot + OUTPUT_FILE_SLOT, job->out.fd);
+    uring_set_file(jobs->uring, slot + INPUT_FILE_SLOT, job->in.fd);
 }
 
-bool all_jobs_unrunnable(Jobs* jobs) {
+void close_job_inputs(Jobs* jobs) {
     for (int i = 0; i < jobs->numberJobs; i++) {
-        if (jobs->tasks[i]->runnable && !jobs->tasks[i]->killed) {
-            return false;
+        Job* job = &jobs->tasks[i];
+        if (!job_state(jobs, i, JOB_RUNNABLE) || !job->in.isPipe) {
+            continue;
         }
+        end_job_input(jobs, job);
+    }
+}
+
+void end_job_input(Jobs* jobs, Job* job) {
+    if (out_queue_empty(&job->inQueue)) {
+        close_job_input(jobs, job);
+    } else {
+        job->inputClosing = true;
     }
-    return true;
 }
 
 void spawn_job(Job* job) {
-    InOut* in = job->in;
-    InOut* out = job->out;
+    InOut* in = &job->in;
+    InOut* out = &job->out;
+
+    //jobthing blocks SIGCHLD to receive it through a signalfd, so the mask
+    //inherited through fork is cleared before exec.
+    sigset_t noSignals;
+    sigemptyset(&noSignals);
+    sigprocmask(SIG_SETMASK, &noSignals, NULL);
     
-    //Handles input
+    //Every other descriptor is close-on-exec, so only the dups are needed
     dup2(in->fd, STDIN_FILENO);
-    if (in->isPipe) {
-        close(in->pipe[READ_END]);
-        close(in->pipe[WRITE_END]);
-    }
-    
-    //Handles output
     dup2(out->fd, STDOUT_FILENO);
-    if (out->isPipe) {
-        close(out->pipe[READ_END]);
-        close(out->pipe[WRITE_END]);
+    if (!apply_placement(&job->attrs.placement)) {
+        _exit(FAILED_EXEC_EXIT);
     }
 
-    int numTokens;
-    execvp(strtok(job->cmd, " "), split_space_not_quote(job->cmd, &numTokens));
+    Command* command = &job->command;
+    execve(command->path, command->argv, 
+            command->envp ? command->envp : environ);
     _exit(FAILED_EXEC_EXIT);
 }
 
-void start_job(Job* job, int* totalWorkers, bool isRestart, bool verbose) {
-    InOut* in = job->in;
-    InOut* out = job->out;
+void start_job(Jobs* jobs, Job* job, bool isRestart, Reactor* reactor,
+        bool verbose) {
+    InOut* in = &job->in;
+    InOut* out = &job->out;
         
     //Sets up fds for input and output for each job. If invalid input or ouput
     //configuration specified, job will be set to unrunnable and job is not
     //run.
-    if (!(get_io_fds(true, in->pipe, &(in->fd), job->in->file, 
+    if (!(get_io_fds(true, in->pipe, &(in->fd), job->in.file, 
             &(in->isPipe)) && get_io_fds(false, out->pipe, &(out->fd), 
-            job->out->file, &(out->isPipe)))) {
-        job->runnable = false;
+            job->out.file, &(out->isPipe)))) {
+        set_job_state(jobs, job->index, JOB_RUNNABLE, false);
         return;
     }
-    job->runnable = true;
+    set_job_state(jobs, job->index, JOB_RUNNABLE, true);
     job->startCount++;
+    size_job_pipes(job);
+
+    pid_t pid = launch_job(job);
+    if (pid > 0) {
+        //Jobs without a pidfd are found by the SIGCHLD fallback instead
+        set_job_pid(jobs, job->index, pid);
+        set_job_state(jobs, job->index, JOB_RUNNING, true);
+        job->startedMs = now_ms();
+        job->pidFd = jobs->reapAny ? -1 : open_child_pidfd(pid);
+        if (job->pidFd != -1) {
+            reactor_watch(reactor, job->pidFd, WATCH_JOB_EXIT, job->index,
+                    EPOLLIN);
+        }
 
-    if ((job->pid = fork())) {
         //Sets up input and output for job
         if (in->isPipe) {
             close(in->pipe[READ_END]);
             in->fd = in->pipe[WRITE_END];
+            set_nonblocking(in->fd);
         }
         if (out->isPipe) {  
             close(out->pipe[WRITE_END]);
             out->fd = out->pipe[READ_END];
-            job->wrappedOutput = fdopen(out->fd, "r");
+            set_nonblocking(out->fd);
         } 
         
-        if (!isRestart) {
-            job->jobNumber = ++(*totalWorkers);
+        //Parked jobs were numbered when the others were first started
+        if (!job->jobNumber) {
+            number_job(jobs, job);
         }
 
         if (verbose) {
-            isRestart ? printf("Restarting worker %d\n", job->jobNumber) : 
-                printf("Spawning worker %d\n", *totalWorkers);
+            writer_printf(&output, "%s worker %d\n", 
+                    isRestart ? "Restarting" : "Spawning", job->jobNumber);
+        }
+
+        if (out->isPipe && job_on_engine(jobs, job)) {
+            //The pipe now belongs to an I/O thread, which relays whatever
+            //it reads after what has been written here so far
+            flush_writer(&output);
+            send_shard_message(jobs->engine, SHARD_WATCH, job->index, 
+                    job->jobNumber, out->fd);
+            out->fd = -1;
+            set_job_state(jobs, job->index, JOB_OUTPUT_OPEN, true);
+        } else if (out->isPipe) {
+            //Answers kept from the last process still wait for their turn
+            if (job_ordered(jobs, job)) {
+                job->output.eof = false;
+            } else {
+                reset_line_buffer(&job->output);
+            }
+            set_job_state(jobs, job->index, JOB_OUTPUT_OPEN, 
+                    reactor_watch(reactor, out->fd, WATCH_JOB_OUTPUT, 
+                    job->index, EPOLLIN));
         }
-            
+        register_job_files(jobs, job);
     } else {
-        spawn_job(job); 
+        //Neither end of the job's pipes or files will be used
+        if (in->isPipe) {
+            close(in->pipe[READ_END]);
+            close(in->pipe[WRITE_END]);
+        } else {
+            close(in->fd);
+        }
+        if (out->isPipe) {
+            close(out->pipe[READ_END]);
+            close(out->pipe[WRITE_END]);
+        } else {
+            close(out->fd);
+        }
+        in->fd = -1;
+        out->fd = -1;
+        set_job_state(jobs, job->index, JOB_RUNNABLE, false);
+    }
+}
+
+void size_job_pipes(Job* job) {
+    //Best effort, as the size may be limited by /proc/sys/fs/pipe-max-size
+    size_t size = job->attrs.placement.pipeSize;
+    if (size && job->in.isPipe) {
+        fcntl(job->in.pipe[WRITE_END], F_SETPIPE_SZ, size);
+    }
+    if (size && job->out.isPipe) {
+        fcntl(job->out.pipe[READ_END], F_SETPIPE_SZ, size);
+    }
+}
+
+void number_job(Jobs* jobs, Job* job) {
+    index_job_number(jobs, jobs->totalWorkers + 1, job->index);
+    job->jobNumber = ++(jobs->totalWorkers);
+}
+
+void index_job_number(Jobs* jobs, int jobNumber, int index) {
+    //Released slots are numbered afresh, so there can be more numbers than 
+    //jobs
+    if (jobNumber > jobs->numberIndexSize) {
+        int oldSize = jobs->numberIndexSize;
+        while (jobs->numberIndexSize < jobNumber) {
+            jobs->numberIndexSize = jobs->numberIndexSize ? 
+                    jobs->numberIndexSize * 2 : INITIAL_JOB_LIST;
+        }
+        jobs->numberIndex = realloc(jobs->numberIndex, 
+                sizeof(int) * jobs->numberIndexSize);
+        for (int i = oldSize; i < jobs->numberIndexSize; i++) {
+            jobs->numberIndex[i] = NO_INDEX;
+        }
     }
+    jobs->numberIndex[jobNumber - 1] = index;
+}
+
+pid_t launch_job(Job* job) {
+    //posix_spawn() cannot set affinity, nice or limits, so a placed job is
+    //always forked
+    if (!job->attrs.forkSpawn && !job_placed(&job->attrs.placement)) {
+        pid_t pid = posix_spawn_job(job);
+        if (pid > 0) {
+            return pid;
+        }
+    }
+    pid_t pid = fork();
+    if (!pid) {
+        spawn_job(job);
+    }
+    return pid;
+}
+
+pid_t posix_spawn_job(Job* job) {
+    InOut* in = &job->in;
+    InOut* out = &job->out;
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    
+    //Every other descriptor is close-on-exec, so only the dups are needed
+    posix_spawn_file_actions_adddup2(&actions, in->fd, STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, out->fd, STDOUT_FILENO);
+
+    //The SIGCHLD mask used by the signalfd fallback is not passed on
+    posix_spawnattr_t spawnAttrs;
+    posix_spawnattr_init(&spawnAttrs);
+    sigset_t noSignals;
+    sigemptyset(&noSignals);
+    posix_spawnattr_setsigmask(&spawnAttrs, &noSignals);
+    posix_spawnattr_setflags(&spawnAttrs, POSIX_SPAWN_SETSIGMASK);
+
+    Command* command = &job->command;
+    pid_t pid;
+    if (posix_spawn(&pid, command->path, &actions, &spawnAttrs, 
+            command->argv, command->envp ? command->envp : environ)) {
+        pid = -1;
+    }
+
+    posix_spawnattr_destroy(&spawnAttrs);
+    posix_spawn_file_actions_destroy(&actions);
+    return pid;
 }
 
 void init_in_out(InOut* inOut) {
@@ -187,12 +588,15 @@ bool get_io_fds(bool isInput, int ioPipe[2], int* fd, char* ioFile,
         bool* isPipe) {
     if ((*isPipe = !strcmp(ioFile, ""))) {
         //If the io file is empty direct it to jobthing
-        pipe(ioPipe);
+        //Close-on-exec stops other jobs inheriting this pipe, which would
+        //keep it from ever reaching end of file. dup2() in the child clears
+        //the flag on the copy the job itself uses.
+        pipe2(ioPipe, O_CLOEXEC);
         *fd = isInput ? ioPipe[READ_END] : ioPipe[WRITE_END];
     } else {
         //If an io file is specified and valid, set it up
-        *fd = isInput ? open(ioFile, O_RDONLY) : open(ioFile, O_WRONLY | 
-                O_CREAT | O_TRUNC, S_IWUSR | S_IRUSR);
+        *fd = isInput ? open(ioFile, O_RDONLY | O_CLOEXEC) : open(ioFile, 
+                O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, S_IWUSR | S_IRUSR);
         if (*fd == -1) {
             fprintf(stderr, "Error: unable to open \"%s\" for %s\n", 
                         ioFile, isInput ? "reading" : "writing");
@@ -202,182 +606,1037 @@ bool get_io_fds(bool isInput, int ioPipe[2], int* fd, char* ioFile,
     return true;
 }
 
-Job* make_job(char** jobTokens, bool verbose, int jobCount) {
-    Job* job = malloc(sizeof(Job));
-    if (!strcmp(jobTokens[0], "")) {
-        job->numRestarts = 0;
-    } else {
-        job->numRestarts = atoi(jobTokens[NUMBER_RESTARTS_POSITION]);
+void make_job(Job* job, JobSpec* spec, Arena* strings, bool verbose, 
+        int jobCount) {
+    //An empty restart count is read as 0 (infinite restarts)
+    job->numRestarts = 0;
+    for (size_t i = 0; i < spec->restarts.length; i++) {
+        job->numRestarts = job->numRestarts * 10 + 
+                (spec->restarts.start[i] - '0');
     }
 
-    job->cmd = strdup(jobTokens[COMMAND_POSITION]); 
+    job->cmd = arena_strndup(strings, spec->cmd.start, spec->cmd.length);
+    job->index = jobCount;
+    job->attrs = spec->attrs;
+    compile_job_command(job, spec, strings);
+    init_out_queue(&job->inQueue, job->attrs.queueLimit, 
+            job->attrs.queuePolicy);
     init_job(job);
     
     //Setup job input and output functionality
-    job->in = malloc(sizeof(InOut));
-    job->out = malloc(sizeof(InOut));
-    init_in_out(job->out);
-    init_in_out(job->in);
-    job->in->file = strdup(jobTokens[INPUT_FILE_POSITION]);
-    job->out->file = strdup(jobTokens[OUTPUT_FILE_POSITION]);
+    init_in_out(&job->out);
+    init_in_out(&job->in);
+    job->in.file = arena_strndup(strings, spec->input.start, 
+            spec->input.length);
+    job->out.file = arena_strndup(strings, spec->output.start, 
+            spec->output.length);
 
     if (verbose) {
-        printf("Registering worker %d:", jobCount + 1);
+        writer_printf(&output, "Registering worker %d:", jobCount + 1);
         
         //Prints the command used to generate worker without quotes ""
-        int numWords;
-        char* cmd = strdup(job->cmd);
-        char** cmdTokens = split_space_not_quote(cmd, &numWords);
-        for (int i = 0; i < numWords; i++) {
-            printf(" %s", cmdTokens[i]);
+        for (int i = 0; i < job->command.argc; i++) {
+            writer_printf(&output, " %s", job->command.argv[i]);
         }
+        writer_printf(&output, "\n");
+    }
+}
 
-        free(cmd);
-        free(cmdTokens);
-        printf("\n");
+void join_pool(Jobs* jobs, Job* job, JobSpec* spec, int replica) {
+    char* field = strndup(spec->attrsField.start, spec->attrsField.length);
+    char* name = collect_pool_attr(field);
+    char privateName[MAX_POOL_NAME];
+    if (!job->attrs.pooled && job->attrs.dispatch == DISPATCH_BROADCAST) {
+        //':' cannot be part of a pool attribute, so no pool is named this
+        snprintf(privateName, sizeof(privateName), PRIVATE_POOL_NAME, 
+                job->index - replica);
+        name = privateName;
+    }
+    int pool = 0;
+    while (pool < jobs->numPools && strcmp(jobs->pools[pool].name, name)) {
+        pool++;
+    }
+    if (pool == jobs->numPools) {
+        //A pool named without a dispatch mode shares lines in turn
+        DispatchMode mode = job->attrs.dispatch == DISPATCH_BROADCAST ? 
+                DISPATCH_ROUND_ROBIN : job->attrs.dispatch;
+        jobs->pools = realloc(jobs->pools, 
+                sizeof(Pool) * (jobs->numPools + 1));
+        init_pool(&jobs->pools[jobs->numPools++], name, mode, 
+                job->attrs.keyField);
+    }
+    Pool* joined = &jobs->pools[pool];
+    if (job_scalable(&job->attrs) && !joined->scalable) {
+        set_pool_scaling(joined, job->attrs.scaleAt, job->attrs.idleMs);
+    }
+    if (job->attrs.orderWindow != UNORDERED && 
+            joined->orderWindow == UNORDERED) {
+        set_pool_order(joined, job->attrs.orderWindow, 
+                job->attrs.orderTimeoutMs, job->attrs.dropStragglers);
+        jobs->numOrderedPools++;
     }
-    return job;
+    if (!replica) {
+        joined->minActive += job->attrs.minReplicas;
+    }
+    job->parked = replica >= job->attrs.minReplicas;
+    add_pool_member(joined, job->index, job->parked);
+    job->pool = pool;
+    free(field);
 }
 
-void free_tasks(int numberJobs, Job** jobs) {
-    for (int i = 0; i < numberJobs; i++) {
-        free(jobs[i]->cmd);
-        free(jobs[i]->in->file);
-        free(jobs[i]->out->file);
-        free(jobs[i]->in);
-        free(jobs[i]->out);
-        free(jobs[i]);
+void compile_job_command(Job* job, JobSpec* spec, Arena* strings) {
+    char** env = NULL;
+    char* field = NULL;
+    int numEnv = 0;
+    if (job->attrs.numEnv) {
+        field = strndup(spec->attrsField.start, spec->attrsField.length);
+        env = malloc(sizeof(char*) * job->attrs.numEnv);
+        numEnv = collect_env_attrs(field, env);
     }
-    free(jobs);
+    compile_command(&job->command, job->cmd, env, numEnv, strings);
+    free(env);
+    free(field);
+}
+
+void free_jobs(Jobs* jobs) {
+    for (int i = 0; i < jobs->numberJobs; i++) {
+        Job* job = &jobs->tasks[i];
+        free_line_buffer(&job->output);
+        free_out_queue(&job->inQueue);
+        free_latency(&job->latency);
+    }
+    for (int i = 0; i < jobs->numPools; i++) {
+        free_pool(&jobs->pools[i]);
+    }
+    free(jobs->pools);
+    free(jobs->handoverPath);
+    free(jobs->rollout);
+    free(jobs->tasks);
+    free(jobs->states);
+    free(jobs->pids);
+    free(jobs->numberIndex);
+    free(jobs->readyOutputs);
+    free_pid_map(&jobs->pidIndex);
+    free_arena(&jobs->strings);
 }
 
 void init_jobs(Jobs* jobs) {
     jobs->numberJobs = 0;
-    jobs->size = INITIAL_JOB_LIST;
-    jobs->tasks = malloc(sizeof(Job) * jobs->size);
+    jobs->size = 0;
+    jobs->tasks = NULL;
+    jobs->states = NULL;
+    jobs->pids = NULL;
+    jobs->numberIndex = NULL;
+    jobs->numberIndexSize = 0;
+    jobs->readyOutputs = NULL;
+    grow_jobs(jobs);
+    jobs->numRunnable = 0;
+    jobs->numRunning = 0;
+    jobs->numOutputsOpen = 0;
+    jobs->totalWorkers = 0;
+    init_pid_map(&jobs->pidIndex);
+    init_arena(&jobs->strings);
+    jobs->numReadyOutputs = 0;
+    jobs->numBlockedQueues = 0;
+    jobs->sleepUntilMs = 0;
+    jobs->trackLatency = false;
+    jobs->pools = NULL;
+    jobs->numPools = 0;
+    jobs->numOrderedPools = 0;
+    jobs->numBroadcastJobs = 0;
+    jobs->numWaking = 0;
+    jobs->engine = NULL;
+    jobs->numDraining = 0;
+    jobs->uring = NULL;
+    jobs->reloadPending = false;
+    jobs->numHeld = 0;
+    jobs->rollout = NULL;
+    jobs->rolloutFrom = 0;
+    jobs->surge = DEFAULT_SURGE;
+    jobs->numRolling = 0;
+    jobs->numSpread = 0;
+    jobs->handoverPending = false;
+    jobs->handoverPath = NULL;
+    jobs->handoverDeadlineMs = 0;
+    jobs->reapAny = false;
 }
 
-void process_job_output(Jobs* jobs, bool verbose) {
-    for (int i = 0; i < jobs->numberJobs; i++) {
-        Job* job = jobs->tasks[i];
-        if (!job->runnable || !job->out->isPipe || job->killed) {
-            continue;
+void grow_jobs(Jobs* jobs) {
+    jobs->size = jobs->size ? jobs->size * 2 : INITIAL_JOB_LIST;
+    jobs->tasks = realloc(jobs->tasks, sizeof(Job) * jobs->size);
+    jobs->states = realloc(jobs->states, sizeof(unsigned char) * jobs->size);
+    jobs->pids = realloc(jobs->pids, sizeof(pid_t) * jobs->size);
+    jobs->readyOutputs = realloc(jobs->readyOutputs, 
+            sizeof(int) * jobs->size);
+}
+
+bool process_job_output(Jobs* jobs, Job* job, Reactor* reactor, 
+        int lineBudget, bool verbose) {
+    int numLines = 0;
+    if (job->pool != NO_POOL && jobs->pools[job->pool].scalable) {
+        job->lastActiveMs = now_ms();
+    }
+    bool ordered = job_ordered(jobs, job);
+    while (job_state(jobs, job->index, JOB_OUTPUT_OPEN)) {
+        //Lines already buffered are relayed before reading more
+        char* line;
+        size_t length;
+        long long readUs = jobs->trackLatency ? now_us() : 0;
+        if (ordered) {
+            //The answers are relayed by turn, whichever job they are from
+            relay_late_lines(jobs, job, readUs);
+            release_ordered_output(jobs, &jobs->pools[job->pool], false);
+        }
+        while (!ordered && numLines < lineBudget && 
+                (line = next_line(&job->output, &length))) {
+            relay_job_line(jobs, job, line, length, readUs, true);
+            numLines++;
+        }
+        if (numLines >= lineBudget) {
+            return true;
+        }
+        
+        if (!job->output.eof && jobs->uring && lineBudget != NO_LINE_BUDGET) {
+            //Read again along with the other ready jobs on the next pass
+            return job->outputMore;
+        } else if (!job->output.eof) {
+            ssize_t numRead = fill_line_buffer(&job->output, job->out.fd);
+            if (numRead > 0 || (numRead == -1 && errno == EINTR)) {
+                continue;
+            } else if (numRead == -1 && errno == EAGAIN) {
+                return false;
+            }
         }
-        fflush(job->wrappedOutput); 
 
-        char* output = read_line(job->wrappedOutput);
-        if (output) {
-            printf("%d->'%s'\n", job->jobNumber, output);
-            free(output);
-        } else if (verbose) {
+        //End of file, or a read error which is treated the same
+        if (verbose) {
             fprintf(stderr, "Received EOF from job %d\n", job->jobNumber);
         }
+        reactor_unwatch(reactor, job->out.fd);
+        set_job_state(jobs, job->index, JOB_OUTPUT_OPEN, false);
     }
+    //Events can still arrive for a pipe closed while being reaped
+    return false;
 }
 
-bool read_process_input(Params* params, FILE* inputFile, Jobs* jobs) {
-    char* input = read_line(inputFile);
-    if (input == NULL) {
-        free(input);
-        close_all_runnable_fds(jobs);
-        fclose(inputFile);
-        free_tasks(jobs->numberJobs, jobs->tasks);
-        exit(SUCCESSFUL_EXIT);
-    } else if (input[0] == '*') {
-        handle_command(input, jobs);
-        usleep(1000000);
-        free(input);
-        return false;
-    } else {
-        for (int i = 0; i < jobs->numberJobs; i++) {
-            Job* job = jobs->tasks[i];
-            if (!job->runnable || !job->in->isPipe) {
-                continue;
+void relay_job_line(Jobs* jobs, Job* job, char* line, size_t length, 
+        long long readUs, bool relay) {
+    if (relay && !job_state(jobs, job->index, JOB_KILLED)) {
+        write_relay_line(&output, job->jobNumber, "->", line, length);
+    }
+    job->outputLines++;
+    job->outputBytes += length + record_overhead(job->output.framed);
+    if (job->inFlight) {
+        job->inFlight--;
+    }
+    if (jobs->trackLatency) {
+        latency_answered(&job->latency, readUs);
+    }
+}
+
+bool job_ordered(Jobs* jobs, Job* job) {
+    return job->pool != NO_POOL && 
+            jobs->pools[job->pool].orderWindow != UNORDERED;
+}
+
+bool job_on_engine(Jobs* jobs, Job* job) {
+    return jobs->engine && !job_ordered(jobs, job) && 
+            job->index < jobs->engine->numJobs;
+}
+
+void release_ordered_output(Jobs* jobs, Pool* pool, bool force) {
+    long long nowMs = pool->orderTimeoutMs == NO_ORDER_TIMEOUT ? 0 : 
+            now_ms();
+    long long readUs = jobs->trackLatency ? now_us() : 0;
+    while (pool->nextRelease < pool->nextSeq) {
+        int slot = order_slot(pool, pool->nextRelease);
+        int owner = pool->owners[slot];
+        if (owner != NO_OWNER) {
+            Job* job = &jobs->tasks[owner];
+            char* line;
+            size_t length;
+            relay_late_lines(jobs, job, readUs);
+            if ((line = next_line(&job->output, &length))) {
+                relay_job_line(jobs, job, line, length, readUs, true);
+            } else if (force || (pool->orderTimeoutMs != NO_ORDER_TIMEOUT &&
+                    nowMs - pool->sentMs[slot] >= pool->orderTimeoutMs)) {
+                //The answer, if it comes, is now behind those after it
+                job->lateLines++;
+            } else {
+                break;
             }
-            job->inputReceived++;
-            write(job->in->fd, input, strlen(input));
-            //Write a new line to flush pipe
-            write(job->in->fd, "\n", 1);
-            printf("%d<-'%s'\n", job->jobNumber, input);
-        }
-    }     
-    free(input);
+        }
+        pool->nextRelease++;
+    }
+    update_window_full(jobs, pool);
+}
+
+void relay_late_lines(Jobs* jobs, Job* job, long long readUs) {
+    bool relay = !jobs->pools[job->pool].dropStragglers;
+    char* line;
+    size_t length;
+    while (job->lateLines && (line = next_line(&job->output, &length))) {
+        relay_job_line(jobs, job, line, length, readUs, relay);
+        job->lateLines--;
+    }
+}
+
+void forget_ordered_lines(Jobs* jobs, Job* job) {
+    if (!job_ordered(jobs, job)) {
+        return;
+    }
+    LineBuffer* buffer = &job->output;
+    if (buffer->eof) {
+        end_partial_line(buffer);
+    }
+    //Its buffered answers are to its oldest lines, after any late ones
+    int numAnswered = count_buffered_lines(buffer);
+    if (job->lateLines > numAnswered) {
+        job->lateLines = numAnswered;
+    }
+    numAnswered -= job->lateLines;
+    Pool* pool = &jobs->pools[job->pool];
+    for (unsigned long long seq = pool->nextRelease; seq < pool->nextSeq; 
+            seq++) {
+        int slot = order_slot(pool, seq);
+        if (pool->owners[slot] != job->index) {
+            continue;
+        } else if (numAnswered) {
+            numAnswered--;
+        } else {
+            pool->owners[slot] = NO_OWNER;
+        }
+    }
+    release_ordered_output(jobs, pool, false);
+}
+
+void update_window_full(Jobs* jobs, Pool* pool) {
+    bool full = pool->orderWindow != UNORDERED && 
+            pool->nextSeq - pool->nextRelease >= pool->orderWindow;
+    if (full != pool->windowFull) {
+        jobs->numBlockedQueues += full ? 1 : -1;
+        pool->windowFull = full;
+    }
+}
+
+int order_timeout(Jobs* jobs) {
+    long long timeout = NO_DEADLINE;
+    long long nowMs = 0;
+    for (int i = 0; jobs->numOrderedPools && i < jobs->numPools; i++) {
+        Pool* pool = &jobs->pools[i];
+        if (pool->orderTimeoutMs == NO_ORDER_TIMEOUT || 
+                pool->nextRelease == pool->nextSeq) {
+            continue;
+        }
+        nowMs = nowMs ? nowMs : now_ms();
+        long long remaining = pool->sentMs[order_slot(pool, 
+                pool->nextRelease)] + pool->orderTimeoutMs - nowMs;
+        remaining = remaining > 0 ? remaining : 0;
+        if (timeout == NO_DEADLINE || remaining < timeout) {
+            timeout = remaining;
+        }
+    }
+    return timeout;
+}
+
+void release_ordered_pools(Jobs* jobs, bool force) {
+    for (int i = 0; jobs->numOrderedPools && i < jobs->numPools; i++) {
+        if (jobs->pools[i].orderWindow != UNORDERED) {
+            release_ordered_output(jobs, &jobs->pools[i], force);
+        }
+    }
+}
+
+void mark_output_ready(Jobs* jobs, int index) {
+    Job* job = &jobs->tasks[index];
+    if (!job->outputPending) {
+        job->outputPending = true;
+        jobs->readyOutputs[jobs->numReadyOutputs++] = index;
+    }
+}
+
+bool relay_ready_outputs(Jobs* jobs, Reactor* reactor, bool verbose) {
+    if (jobs->uring) {
+        read_ready_outputs(jobs, reactor);
+    }
+    //Jobs with output left are compacted to the front in their original 
+    //order, so the next pass continues round-robin where this one left off.
+    int numStillReady = 0;
+    for (int i = 0; i < jobs->numReadyOutputs; i++) {
+        int index = jobs->readyOutputs[i];
+        Job* job = &jobs->tasks[index];
+        if (process_job_output(jobs, job, reactor, OUTPUT_LINE_BUDGET, 
+                verbose)) {
+            jobs->readyOutputs[numStillReady++] = index;
+        } else {
+            job->outputPending = false;
+            //A removed job that has exited is released once it is relayed
+            release_removed_job(jobs, job);
+        }
+    }
+    jobs->numReadyOutputs = numStillReady;
+    return numStillReady > 0;
+}
+
+void read_ready_outputs(Jobs* jobs, Reactor* reactor) {
+    //Jobs with a line still to relay are not read until it has been, 
+    //unless the line is waiting for its turn in an ordered pool
+    for (int i = 0; i < jobs->numReadyOutputs; i++) {
+        int index = jobs->readyOutputs[i];
+        Job* job = &jobs->tasks[index];
+        LineBuffer* buffer = &job->output;
+        if (!job_state(jobs, index, JOB_OUTPUT_OPEN) || buffer->eof || 
+                (!job_ordered(jobs, job) && has_buffered_line(buffer))) {
+            continue;
+        }
+        if (uring_full(jobs->uring)) {
+            complete_uring_ops(jobs, reactor);
+        }
+        reserve_next_read(buffer);
+        int slot = index * FILE_SLOTS_PER_JOB + OUTPUT_FILE_SLOT;
+        uring_prep(jobs->uring, IORING_OP_READ, job->out.fd, slot, 
+                buffer->data + buffer->end, 
+                buffer->capacity - buffer->end - 1, slot);
+    }
+    complete_uring_ops(jobs, reactor);
+}
+
+void complete_uring_ops(Jobs* jobs, Reactor* reactor) {
+    uring_submit(jobs->uring);
+
+    //Each operation is known by the slot of the file it was on, which 
+    //says both the job and whether it was a read or a write
+    unsigned long long slot;
+    int result;
+    while (uring_next_result(jobs->uring, &slot, &result)) {
+        int index = slot / FILE_SLOTS_PER_JOB;
+        Job* job = &jobs->tasks[index];
+        if (slot % FILE_SLOTS_PER_JOB == INPUT_FILE_SLOT) {
+            apply_flush_result(jobs, index, 
+                    out_queue_written(&job->inQueue, result), reactor);
+            continue;
+        }
+        job->outputMore = result > 0;
+        if (result > 0) {
+            job->output.end += result;
+        } else if (result != -EAGAIN && result != -EINTR) {
+            //End of file, or a read error which is treated the same
+            job->output.eof = true;
+        }
+    }
+}
+
+void drain_job_output(Jobs* jobs, Job* job, Reactor* reactor, bool verbose) {
+    process_job_output(jobs, job, reactor, NO_LINE_BUDGET, verbose);
+}
+
+bool apply_shard_reply(Jobs* jobs, ShardReply* reply, Reactor* reactor) {
+    Job* job = &jobs->tasks[reply->index];
+    switch (reply->kind) {
+        case SHARD_ANSWERED:
+            job->outputLines += reply->numLines;
+            job->outputBytes += reply->numBytes;
+            job->inFlight = reply->numLines < job->inFlight ? 
+                    job->inFlight - reply->numLines : 0;
+            for (int i = 0; jobs->trackLatency && i < reply->numLines; i++) {
+                latency_answered(&job->latency, reply->readUs);
+            }
+            if (job->pool != NO_POOL && jobs->pools[job->pool].scalable) {
+                job->lastActiveMs = now_ms();
+            }
+            break;
+        case SHARD_OUTPUT_CLOSED:
+            set_job_state(jobs, job->index, JOB_OUTPUT_OPEN, false);
+            break;
+        case SHARD_DRAINED:
+            jobs->numDraining--;
+            finish_job_exit(jobs, job, reactor);
+            return true;
+    }
+    return false;
+}
+
+bool read_process_input(Params* params, LineBuffer* input, Jobs* jobs, 
+        Reactor* reactor) {
+    ssize_t numRead = fill_line_buffer(input, params->inputFile);
+    if (numRead == -1 && (errno == EINTR || errno == EAGAIN)) {
+        //Nothing to read yet, which is not the end of the input
+        return true;
+    }
+
+    process_input_lines(params, input, jobs);
+    flush_job_inputs(jobs, reactor);
+    //Lines held back by a *sleep are still to be sent after EOF
+    return numRead > 0 || jobs->sleepUntilMs;
+}
+
+bool read_input_chunks(Params* params, LineBuffer* input, Jobs* jobs, 
+        Reactor* reactor) {
+    Engine* engine = jobs->engine;
+    clear_wakeups(engine->inputWakeFd);
+    bool inputOpen = true;
+    Chunk chunk;
+    while (inputOpen && !input_blocked(jobs) && 
+            next_input_chunk(engine, &chunk)) {
+        if (chunk.data) {
+            append_line_buffer(input, chunk.data, chunk.length);
+            free(chunk.data);
+        } else {
+            input->eof = true;
+            inputOpen = false;
+        }
+        process_input_lines(params, input, jobs);
+    }
+    if (inputOpen && input_blocked(jobs)) {
+        //Chunks left while a queue is full are taken once it has drained,
+        //which may be before input is paused
+        wake_input(engine);
+    }
+    //Echoed lines go out ahead of the answers to them
+    flush_writer(&output);
+    flush_job_inputs(jobs, reactor);
+    return inputOpen || jobs->sleepUntilMs;
+}
+
+void process_input_lines(Params* params, LineBuffer* input, Jobs* jobs) {
+    char* line;
+    size_t length;
+    //Lines after a *sleep wait in the buffer until it has run its course
+    while (!jobs->sleepUntilMs && (line = next_line(input, &length))) {
+        //Records are all data, as any of them could start with '*'
+        if (!params->framed && line[0] == '*') {
+            handle_command(line, jobs, &output);
+        } else {
+            send_input_line(line, length, jobs, params->echo);
+        }
+    }
+}
+
+bool input_blocked(Jobs* jobs) {
+    //A pending handover lets the input queues drain
+    return jobs->numBlockedQueues || jobs->sleepUntilMs || 
+            jobs->handoverPending;
+}
+
+int sleep_timeout(Jobs* jobs) {
+    if (!jobs->sleepUntilMs) {
+        return NO_DEADLINE;
+    }
+    long long remaining = jobs->sleepUntilMs - now_ms();
+    return remaining > 0 ? remaining : 0;
+}
+
+bool end_input_sleep(Params* params, LineBuffer* input, Jobs* jobs, 
+        Reactor* reactor) {
+    jobs->sleepUntilMs = 0;
+    process_input_lines(params, input, jobs);
+    if (jobs->engine) {
+        //As in read_input_chunks(), echoed lines go out first
+        flush_writer(&output);
+    }
+    flush_job_inputs(jobs, reactor);
+    return !input->eof || jobs->sleepUntilMs;
+}
+
+void send_input_line(char* line, size_t length, Jobs* jobs, bool echo) {
+    long long sentUs = jobs->trackLatency ? now_us() : 0;
+    for (int i = 0; jobs->numBroadcastJobs && i < jobs->numberJobs; i++) {
+        Job* job = &jobs->tasks[i];
+        if (job->pool != NO_POOL || !job_state(jobs, i, JOB_RUNNING) || 
+                !job->in.isPipe || job->removed) {
+            continue;
+        }
+        send_job_line(jobs, job, line, length, sentUs, echo);
+    }
+
+    //Each pool is sent the line once, through one of its jobs
+    for (int i = 0; i < jobs->numPools; i++) {
+        int index = choose_pool_member(jobs, &jobs->pools[i], line, length);
+        if (index != NO_INDEX) {
+            send_job_line(jobs, &jobs->tasks[index], line, length, sentUs, 
+                    echo);
+        }
+    }
+}
+
+void send_job_line(Jobs* jobs, Job* job, char* line, size_t length, 
+        long long sentUs, bool echo) {
+    job->inputReceived++;
+    job->inputBytes += length + record_overhead(job->inQueue.framed);
+    job->inFlight++;
+    enqueue_line(&job->inQueue, line, length);
+    update_input_blocked(jobs, job);
+    if (jobs->trackLatency) {
+        latency_sent(&job->latency, sentUs);
+    }
+    if (job->pool != NO_POOL && jobs->pools[job->pool].scalable) {
+        job->lastActiveMs = now_ms();
+    }
+    if (job_ordered(jobs, job)) {
+        Pool* pool = &jobs->pools[job->pool];
+        number_pool_line(pool, job->index, 
+                pool->orderTimeoutMs == NO_ORDER_TIMEOUT ? 0 : now_ms());
+        update_window_full(jobs, pool);
+    }
+    if (echo) {
+        write_relay_line(&output, job->jobNumber, "<-", line, length);
+    }
+}
+
+int choose_pool_member(Jobs* jobs, Pool* pool, char* line, size_t length) {
+    if (pool->numParked && pool_saturated(jobs, pool)) {
+        wake_pool_member(jobs, pool);
+    }
+    uint64_t keyHash = pool->mode == DISPATCH_HASH ? 
+            hash_line_key(line, length, pool->keyField) : 0;
+    uint64_t bestWeight = 0;
+    int chosen = NO_INDEX;
+    int chosenAt = 0;
+    //Members are visited in turn from pool->next, so that ties go to the 
+    //job that has waited longest
+    for (int i = 0; i < pool->numMembers; i++) {
+        int at = (pool->next + i) % pool->numMembers;
+        int index = pool->members[at];
+        Job* job = &jobs->tasks[index];
+        if (!pool_member_ready(jobs, job)) {
+            continue;
+        }
+        bool better = chosen == NO_INDEX;
+        if (pool->mode == DISPATCH_HASH) {
+            uint64_t weight = member_weight(keyHash, job->jobNumber);
+            better = better || weight > bestWeight;
+            bestWeight = better ? weight : bestWeight;
+        } else if (pool->mode == DISPATCH_LEAST_LOADED) {
+            better = better || job->inFlight < jobs->tasks[chosen].inFlight;
+        } else {
+            better = better || (jobs->tasks[chosen].inputBlocked && 
+                    !job->inputBlocked);
+        }
+        if (better) {
+            chosen = index;
+            chosenAt = at;
+        }
+        if (pool->mode == DISPATCH_ROUND_ROBIN && !job->inputBlocked && 
+                chosen == index) {
+            break;
+        }
+    }
+    if (chosen != NO_INDEX) {
+        pool->next = (chosenAt + 1) % pool->numMembers;
+    }
+    return chosen;
+}
+
+bool pool_member_ready(Jobs* jobs, Job* job) {
+    return job->waking || (job_state(jobs, job->index, JOB_RUNNING) && 
+            job->in.isPipe && !job->retiring && !job->removed);
+}
+
+bool pool_saturated(Jobs* jobs, Pool* pool) {
+    for (int i = 0; i < pool->numMembers; i++) {
+        Job* job = &jobs->tasks[pool->members[i]];
+        if (pool_member_ready(jobs, job) && job->inFlight < pool->scaleAt &&
+                !job->inputBlocked) {
+            return false;
+        }
+    }
     return true;
 }
 
-void handle_command(char* input, Jobs* jobs) {
+void wake_pool_member(Jobs* jobs, Pool* pool) {
+    for (int i = 0; i < pool->numMembers; i++) {
+        Job* job = &jobs->tasks[pool->members[i]];
+        //Held replicas are started by the rollout instead
+        if (job->parked && !job->held) {
+            job->parked = false;
+            job->waking = true;
+            pool->numParked--;
+            pool->numActive++;
+            jobs->numWaking++;
+            return;
+        }
+    }
+}
+
+void start_woken_jobs(Jobs* jobs, TimerWheel* wheel, Reactor* reactor, 
+        bool verbose) {
+    for (int i = 0; jobs->numWaking && i < jobs->numberJobs; i++) {
+        Job* job = &jobs->tasks[i];
+        if (!job->waking) {
+            continue;
+        }
+        job->waking = false;
+        jobs->numWaking--;
+        set_job_state(jobs, i, JOB_KILLED, false);
+        init_in_out(&job->out);
+        init_in_out(&job->in);
+        start_job(jobs, job, job->startCount > 0, reactor, false);
+        if (!job_state(jobs, i, JOB_RUNNING)) {
+            discard_job_input(jobs, job, reactor);
+            continue;
+        }
+        if (verbose) {
+            writer_printf(&output, "Scaling up worker %d\n", job->jobNumber);
+        }
+        watch_job_idle(jobs, job, wheel);
+        flush_job_input(jobs, i, reactor);
+    }
+}
+
+bool job_retirable(Jobs* jobs, Job* job) {
+    return job->pool != NO_POOL && jobs->pools[job->pool].scalable && 
+            !job->retiring && !job->removed;
+}
+
+void watch_job_idle(Jobs* jobs, Job* job, TimerWheel* wheel) {
+    if (job_retirable(jobs, job) && job_state(jobs, job->index, 
+            JOB_RUNNING)) {
+        job->lastActiveMs = now_ms();
+        schedule_timer(wheel, job->index, jobs->pools[job->pool].idleMs);
+    }
+}
+
+void check_idle_job(Jobs* jobs, Job* job, TimerWheel* wheel, bool verbose) {
+    Pool* pool = &jobs->pools[job->pool];
+    long long remainingMs = job->lastActiveMs + pool->idleMs - now_ms();
+    if (remainingMs > 0 || !out_queue_empty(&job->inQueue) || 
+            pool->numActive <= pool->minActive) {
+        schedule_timer(wheel, job->index, remainingMs > 0 ? remainingMs : 
+                pool->idleMs);
+        return;
+    }
+    retire_job(jobs, job, verbose);
+}
+
+void retire_job(Jobs* jobs, Job* job, bool verbose) {
+    job->retiring = true;
+    jobs->pools[job->pool].numActive--;
+    if (verbose) {
+        writer_printf(&output, "Retiring idle worker %d\n", job->jobNumber);
+    }
+    close_job_input(jobs, job);
+}
+
+void flush_job_inputs(Jobs* jobs, Reactor* reactor) {
+    if (jobs->uring) {
+        write_job_inputs(jobs, reactor);
+        return;
+    }
+    for (int i = 0; i < jobs->numberJobs; i++) {
+        Job* job = &jobs->tasks[i];
+        if (job_state(jobs, i, JOB_RUNNABLE) && job->in.isPipe && 
+                !job->inputWatched && 
+                !out_queue_empty(&job->inQueue)) {
+            flush_job_input(jobs, i, reactor);
+        }
+    }
+}
+
+void write_job_inputs(Jobs* jobs, Reactor* reactor) {
+    //Every job's queue goes in one submission, as one writev() each
+    for (int i = 0; i < jobs->numberJobs; i++) {
+        Job* job = &jobs->tasks[i];
+        if (!job_state(jobs, i, JOB_RUNNABLE) || !job->in.isPipe || 
+                job->inputWatched || job->in.fd == -1 || 
+                out_queue_empty(&job->inQueue)) {
+            continue;
+        }
+        int numVectors = out_queue_vectors(&job->inQueue, job->inputVectors);
+        if (!numVectors) {
+            apply_flush_result(jobs, i, FLUSH_EMPTY, reactor);
+            continue;
+        }
+        if (uring_full(jobs->uring)) {
+            complete_uring_ops(jobs, reactor);
+        }
+        int slot = i * FILE_SLOTS_PER_JOB + INPUT_FILE_SLOT;
+        uring_prep(jobs->uring, IORING_OP_WRITEV, job->in.fd, slot, 
+                job->inputVectors, numVectors, slot);
+    }
+    complete_uring_ops(jobs, reactor);
+}
+
+void flush_job_input(Jobs* jobs, int index, Reactor* reactor) {
+    Job* job = &jobs->tasks[index];
+    if (job->in.fd == -1) {
+        //Events can still arrive for a pipe closed while being reaped
+        return;
+    }
+    apply_flush_result(jobs, index, flush_out_queue(&job->inQueue, 
+            job->in.fd), reactor);
+}
+
+void apply_flush_result(Jobs* jobs, int index, FlushResult result, 
+        Reactor* reactor) {
+    Job* job = &jobs->tasks[index];
+    switch (result) {
+        case FLUSH_PENDING:
+            if (!job->inputWatched) {
+                job->inputWatched = reactor_watch(reactor, job->in.fd, 
+                        WATCH_JOB_INPUT, index, EPOLLOUT);
+            }
+            break;
+        case FLUSH_BROKEN:
+            set_job_state(jobs, index, JOB_KILLED, true);
+            if (job_on_engine(jobs, job)) {
+                send_shard_message(jobs->engine, SHARD_KILLED, index, 
+                        job->jobNumber, -1);
+            }
+            //Fall through
+        case FLUSH_EMPTY:
+            if (job->inputWatched) {
+                reactor_unwatch(reactor, job->in.fd);
+                job->inputWatched = false;
+            }
+            if (job->inputClosing) {
+                close_job_input(jobs, job);
+                job->inputClosing = false;
+            }
+            break;
+    }
+    update_input_blocked(jobs, job);
+}
+
+void update_input_blocked(Jobs* jobs, Job* job) {
+    bool blocked = job->inQueue.policy == QUEUE_BLOCK && 
+            out_queue_full(&job->inQueue);
+    if (blocked != job->inputBlocked) {
+        jobs->numBlockedQueues += blocked ? 1 : -1;
+        job->inputBlocked = blocked;
+    }
+}
+
+void discard_job_input(Jobs* jobs, Job* job, Reactor* reactor) {
+    if (job->inputWatched) {
+        reactor_unwatch(reactor, job->in.fd);
+        job->inputWatched = false;
+    }
+    job->inputClosing = false;
+    clear_out_queue(&job->inQueue);
+    update_input_blocked(jobs, job);
+}
+
+bool handle_command(char* input, Jobs* jobs, Writer* replies) {
     char* cmd = strdup(input);
     cmd = strtok(cmd, " ");
+    bool done = false;
     if (!strcmp(cmd, "*signal")) {
-        handle_signal(input, jobs);
+        done = handle_signal(input, jobs, replies);
     } else if (!strcmp(cmd, "*sleep")) {
-        handle_sleep(input);
+        done = handle_sleep(input, jobs, replies);
+    } else if (!strcmp(cmd, "*latency")) {
+        done = handle_latency(input, jobs, replies);
+    } else if (!strcmp(cmd, "*usage")) {
+        done = handle_usage(input, jobs, replies);
+    } else if (!strcmp(cmd, "*reload")) {
+        done = handle_reload(input, jobs, replies);
+    } else if (!strcmp(cmd, "*handover")) {
+        done = handle_handover(input, jobs, replies);
     } else {
-        printf("Error: Bad command '%s'\n", input);
+        writer_printf(replies, "Error: Bad command '%s'\n", input);
     }
     free(cmd);
+    return done;
 }
 
-void handle_sleep(char* input) {
+bool handle_sleep(char* input, Jobs* jobs, Writer* replies) {
     char* inputDup = strdup(input);
     int numArgs;
     char** cmdTokens = split_space_not_quote(inputDup, &numArgs);   
     
+    //Invalid values have already been reported as -1
+    int time = -1;
     if (numArgs != 2) {
-        printf("Error: Incorrect number of arguments\n");
-        return;
+        writer_printf(replies, "Error: Incorrect number of arguments\n");
+    } else if ((time = extract_validate_int(cmdTokens[1], "duration", 
+            replies)) != -1) {
+        //Only input is held back, while output, exits and restarts carry on
+        jobs->sleepUntilMs = now_ms() + time;
     }
+    free(cmdTokens);
+    free(inputDup);
+    return time != -1;
+}
 
-    int time = extract_validate_int(cmdTokens[1], "duration");
-    
-    //Ignore invalid values
-    if (time == -1) {
-        return;
+bool handle_reload(char* input, Jobs* jobs, Writer* replies) {
+    char* inputDup = strdup(input);
+    int numArgs;
+    char** cmdTokens = split_space_not_quote(inputDup, &numArgs);
+
+    //Invalid values have already been reported as -1
+    int surge = DEFAULT_SURGE;
+    if (numArgs > 2) {
+        writer_printf(replies, "Error: Incorrect number of arguments\n");
+        surge = -1;
+    } else if (numArgs == 2 && (surge = extract_validate_int(cmdTokens[1], 
+            "surge", replies)) == 0) {
+        writer_printf(replies, "Error: Invalid surge\n");
+        surge = -1;
+    } else if (surge != -1 && jobs->numHeld) {
+        writer_printf(replies, "Error: Rollout in progress\n");
+        surge = -1;
+    } else if (surge != -1) {
+        //The jobfile is read at the end of the pass, between dispatching 
+        //lines
+        jobs->reloadPending = true;
+        jobs->surge = surge;
     }
     free(cmdTokens);
     free(inputDup);
-    usleep(time * 1000);
+    return surge != -1;
 }
 
-void handle_signal(char* input, Jobs* jobs) {
+bool handle_handover(char* input, Jobs* jobs, Writer* replies) {
     char* inputDup = strdup(input);
     int numArgs;
     char** cmdTokens = split_space_not_quote(inputDup, &numArgs);
 
-    if (numArgs != 3) {
-        printf("Error: Incorrect number of arguments\n");
-        return;
+    bool done = false;
+    if (numArgs > 2) {
+        writer_printf(replies, "Error: Incorrect number of arguments\n");
+    } else if (numArgs == 2 && !strcmp(cmdTokens[1], "cancel")) {
+        //Input is held back meanwhile, so this comes from the control socket
+        if (jobs->handoverPending) {
+            jobs->handoverPending = false;
+            done = true;
+        } else {
+            writer_printf(replies, "Error: No handover pending\n");
+        }
+    } else if (jobs->engine) {
+        //The I/O threads own the output pipes
+        writer_printf(replies, "Error: Handover is not supported in "
+                "threaded mode\n");
+    } else if (jobs->numHeld) {
+        writer_printf(replies, "Error: Rollout in progress\n");
+    } else {
+        free(jobs->handoverPath);
+        jobs->handoverPath = numArgs == 2 ? strdup(cmdTokens[1]) : NULL;
+        jobs->handoverPending = true;
+        jobs->handoverDeadlineMs = now_ms() + HANDOVER_TIMEOUT_MS;
+        done = true;
     }
+    free(cmdTokens);
+    free(inputDup);
+    return done;
+}
 
-    int jobNum, signal;
-    //Ignore invalid values assigned as -1.
-    //jobNum and signal are 2nd and 3rd arguments in cmdTokens by assign spec.
-    if (((jobNum = extract_validate_int(cmdTokens[1], "job")) == -1)) {
-        return;
-    }
-    if (((signal = extract_validate_int(cmdTokens[2], "signal")) == -1)) {
-        return;
-    }
+bool handle_latency(char* input, Jobs* jobs, Writer* replies) {
+    char* inputDup = strdup(input);
+    int numArgs;
+    char** cmdTokens = split_space_not_quote(inputDup, &numArgs);
 
-    int jobPid;
-    bool isValidJob = false;
-    for (int i = 0; i < jobs->numberJobs; i++) {
-        Job* job = jobs->tasks[i];
-        if (job->runnable && job->jobNumber == jobNum) {
-            isValidJob = true;
-            jobPid = job->pid;
-            break;
+    bool done = false;
+    if (numArgs > 2) {
+        writer_printf(replies, "Error: Incorrect number of arguments\n");
+    } else if (!jobs->trackLatency) {
+        writer_printf(replies, "Error: Latency tracking is not enabled\n");
+    } else if (numArgs == 1) {
+        for (int i = 0; i < jobs->numberJobs; i++) {
+            Job* job = &jobs->tasks[i];
+            //Freed slots and replicas that were never started have no number
+            if (!job->released && job->jobNumber) {
+                report_latency(job, replies);
+            }
+        }
+        done = true;
+    } else {
+        //Invalid values have already been reported as -1
+        int jobNum = extract_validate_int(cmdTokens[1], "job", replies);
+        Job* job = find_job_by_number(jobs, jobNum);
+        if (jobNum != -1 && !job) {
+            writer_printf(replies, "Error: Invalid job\n");
+        } else if (job) {
+            report_latency(job, replies);
+            done = true;
         }
     }
+    free(cmdTokens);
+    free(inputDup);
+    return done;
+}
 
-    if (!isValidJob) {
-        printf("Error: Invalid job\n");
-        return;
+void report_latency(Job* job, Writer* replies) {
+    Latency* latency = &job->latency;
+    writer_printf(replies, "Job %d latency: %llu responses, p50 %lluus, "
+            "p99 %lluus, p99.9 %lluus, max %lluus\n", job->jobNumber, 
+            latency->numSamples, latency_percentile(latency, 0.5), 
+            latency_percentile(latency, 0.99), 
+            latency_percentile(latency, 0.999), latency->maxUs);
+}
+
+bool handle_usage(char* input, Jobs* jobs, Writer* replies) {
+    char* inputDup = strdup(input);
+    int numArgs;
+    char** cmdTokens = split_space_not_quote(inputDup, &numArgs);
+
+    bool done = false;
+    if (numArgs > 2) {
+        writer_printf(replies, "Error: Incorrect number of arguments\n");
+    } else if (numArgs == 1) {
+        for (int i = 0; i < jobs->numberJobs; i++) {
+            Job* job = &jobs->tasks[i];
+            if (!job->released && job->jobNumber) {
+                report_usage(job, replies);
+            }
+        }
+        done = true;
+    } else {
+        //Invalid values have already been reported as -1
+        int jobNum = extract_validate_int(cmdTokens[1], "job", replies);
+        Job* job = find_job_by_number(jobs, jobNum);
+        if (jobNum != -1 && !job) {
+            writer_printf(replies, "Error: Invalid job\n");
+        } else if (job) {
+            report_usage(job, replies);
+            done = true;
+        }
     }
+    free(cmdTokens);
+    free(inputDup);
+    return done;
+}
 
-    if (signal < 1 || signal > 31) {
-        printf("Error: Invalid signal\n");
-        return;
+void report_usage(Job* job, Writer* replies) {
+    Usage* usage = &job->usage;
+    writer_printf(replies, "Job %d usage: user %llu.%06llus, system "
+            "%llu.%06llus, maxrss %ldkB, %llu voluntary and %llu "
+            "involuntary switches, %llu blocks in, %llu blocks out\n", 
+            job->jobNumber, usage->userUs / US_PER_SECOND, 
+            usage->userUs % US_PER_SECOND, usage->systemUs / US_PER_SECOND,
+            usage->systemUs % US_PER_SECOND, usage->maxRssKb, 
+            usage->voluntarySwitches, usage->involuntarySwitches, 
+            usage->inBlocks, usage->outBlocks);
+}
+
+bool handle_signal(char* input, Jobs* jobs, Writer* replies) {
+    char* inputDup = strdup(input);
+    int numArgs;
+    char** cmdTokens = split_space_not_quote(inputDup, &numArgs);
+
+    int jobNum = -1, signal = -1;
+    Job* job = NULL;
+    bool done = false;
+    //Ignore invalid values assigned as -1.
+    //jobNum and signal are 2nd and 3rd arguments in cmdTokens by assign spec.
+    if (numArgs != 3) {
+        writer_printf(replies, "Error: Incorrect number of arguments\n");
+    } else if ((jobNum = extract_validate_int(cmdTokens[1], "job", 
+            replies)) == -1 || (signal = extract_validate_int(cmdTokens[2], 
+            "signal", replies)) == -1) {
+        //Already reported
+    } else if (!(job = find_job_by_number(jobs, jobNum)) || 
+            !job_state(jobs, job->index, JOB_RUNNABLE)) {
+        writer_printf(replies, "Error: Invalid job\n");
+    } else if (signal < 1 || signal > 31) {
+        writer_printf(replies, "Error: Invalid signal\n");
+    } else {
+        //A job waiting to be restarted has no process to signal
+        if (jobs->pids[job->index] != NO_PID) {
+            kill(jobs->pids[job->index], signal);
+        }
+        done = true;
     }
-    kill(jobPid, signal);
+    free(cmdTokens);
+    free(inputDup);
+    return done;
 }
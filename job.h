@@ -3,6 +3,20 @@
 
 #include "helper.h"
 #include "parsing.h"
+#include "linebuf.h"
+#include "reactor.h"
+#include "outq.h"
+#include "attrs.h"
+#include "timerwheel.h"
+#include "pidmap.h"
+#include "arena.h"
+#include "jobfile.h"
+#include "command.h"
+#include "latency.h"
+#include "usage.h"
+#include "pool.h"
+#include "engine.h"
+#include "uring.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -13,17 +27,31 @@
 #include <ctype.h>
 #include <sys/wait.h>
 #include <signal.h>
+#include <errno.h>
+#include <spawn.h>
+#include <limits.h>
 
 #define INITIAL_JOB_LIST 8
 #define READ_END 0
 #define WRITE_END 1
 #define SUCCESSFUL_EXIT 0
 #define FAILED_EXEC_EXIT 99
-#define COMMENT '#'
-#define NUMBER_RESTARTS_POSITION 0
-#define INPUT_FILE_POSITION 1 
-#define OUTPUT_FILE_POSITION 2
-#define COMMAND_POSITION 3
+#define DRAIN_TIMEOUT_MS 1000
+#define OUTPUT_LINE_BUDGET 64
+#define NO_LINE_BUDGET INT_MAX
+#define BACKOFF_RESET_MS 10000
+#define HANDOVER_TIMEOUT_MS 10000
+#define JOB_RUNNABLE 0x1
+#define JOB_RUNNING 0x2
+#define JOB_KILLED 0x4
+#define JOB_OUTPUT_OPEN 0x8
+#define NO_STATUS -1
+#define PRIVATE_POOL_NAME ":%d"
+#define MAX_POOL_NAME 16
+#define FILE_SLOTS_PER_JOB 2
+#define OUTPUT_FILE_SLOT 0
+#define INPUT_FILE_SLOT 1
+#define DEFAULT_SURGE 1
 
 //Represents and holds all the information regarding a job's input or output.
 //This includes pipes to jobThing and other files the job needs to access.
@@ -34,55 +62,232 @@ typedef struct {
     char* file;
 } InOut;
 
-//Represents a job (or task) that jobthing runs
+//Represents a job (or task) that jobthing runs. Whether it is runnable, 
+//running, killed or has its output open, and its pid, are kept in Jobs.
 typedef struct {
     int numRestarts;
     char* cmd;
-    int pid;
-    bool runnable;
+    Command command;
     int jobNumber;
-    InOut* in;
-    InOut* out;
-    FILE* wrappedOutput;
+    int index;
+    InOut in;
+    InOut out;
+    LineBuffer output;
+    bool outputPending;
+    JobAttrs attrs;
+    OutQueue inQueue;
+    bool inputWatched;
+    bool inputClosing;
+    bool inputBlocked;
+    //Counters served on the metrics socket
     int startCount;
     int inputReceived;
-    bool killed;
+    unsigned long long inputBytes;
+    unsigned long long outputLines;
+    unsigned long long outputBytes;
+    //Wait status of the last process, or NO_STATUS
+    int lastStatus;
+    //Only recorded when latency tracking is on
+    Latency latency;
     bool restart;
+    int pidFd;
+    long long startedMs;
+    long long restartDelayMs;
+    //Index of the job's pool, or NO_POOL, and lines sent but not answered
+    int pool;
+    int inFlight;
+    //Scaling of a replica, and when a line last went to or came from it
+    bool parked;
+    bool waking;
+    bool retiring;
+    long long lastActiveMs;
+    //io_uring: whether the last read found output, and the queued input of
+    //a submitted write
+    bool outputMore;
+    struct iovec inputVectors[2];
+    //Answers to lines an ordered pool skipped for taking too long
+    int lateLines;
+    //Totals of the job's processes that have exited
+    Usage usage;
+    //First replica and line hash of the entry, matched by *reload
+    int entry;
+    uint64_t specHash;
+    //Made by a reload and waiting for the rollout to replace this entry
+    bool held;
+    int replaces;
+    //Dropped by a reload, winding down, and freed once its output is relayed
+    bool removed;
+    bool rolling;
+    bool released;
+    //The entry's jobfile line, from which a handover makes the job again
+    char* line;
 } Job;
 
-//Represents the total of all the jobs jobthing is to run
+//Represents the total of all the jobs jobthing is to run. Jobs are stored
+//contiguously and referred to by index.
 typedef struct {
-    Job** tasks;
+    Job* tasks;
     int numberJobs;
     int size;
+    //JOB_ flags and pid of each job, with running counts of the flags
+    unsigned char* states;
+    pid_t* pids;
+    int numRunnable;
+    int numRunning;
+    int numOutputsOpen;
+    //Find a job's index by pid or by job number
+    PidMap pidIndex;
+    int* numberIndex;
+    int numberIndexSize;
+    int totalWorkers;
+    //Holds the strings of every job
+    Arena strings;
+    //Jobs whose output is ready to be relayed
+    int* readyOutputs;
+    int numReadyOutputs;
+    //Input is not read while any queue or order window is full, or until a
+    //*sleep ends
+    int numBlockedQueues;
+    long long sleepUntilMs;
+    bool trackLatency;
+    //Pools, and the jobs outside them that are sent every line
+    Pool* pools;
+    int numPools;
+    int numOrderedPools;
+    int numBroadcastJobs;
+    int numWaking;
+    //Threaded mode's I/O threads, or NULL, and reaped jobs they still relay
+    Engine* engine;
+    int numDraining;
+    //Batches pipe reads and writes, or NULL, with FILE_SLOTS_PER_JOB 
+    //registered files per job
+    Uring* uring;
+    //*reload, carried out at the end of the pass, and its rollout of 
+    //changed entries, surge of them at a time
+    bool reloadPending;
+    int numHeld;
+    int* rollout;
+    int rolloutFrom;
+    int surge;
+    int numRolling;
+    //Jobs dealt a CPU by cpus=auto
+    int numSpread;
+    //*handover, which execs handoverPath (NULL for jobthing itself) once
+    //job input is written, or gives up at the deadline
+    bool handoverPending;
+    char* handoverPath;
+    long long handoverDeadlineMs;
+    //Exits are reaped with wait4() on any child, so jobs have no pidfds
+    bool reapAny;
 } Jobs;
 
 #endif //JOB_H
 
 /* make_job()
  * ----------
- * Makes a job using the given parameters.
+ * Makes a job in place using the given parameters.
  *
- * jobTokens: the array of strings defining the job from the jobfile
+ * job: the slot in the jobs array to make the job in
+ *
+ * spec: the parsed jobfile line defining the job, including its attributes
+ *
+ * strings: the arena the job's strings are copied into
  *
  * verbose: whether jobthing is in verbose mode
  *
  * jobCount: the number of current jobs
+ */
+void make_job(Job* job, JobSpec* spec, Arena* strings, bool verbose, 
+        int jobCount);
+
+/* join_pool()
+ * -----------
+ * Adds a job to the pool named in its attributes, creating the pool with 
+ * the job's dispatch mode and key field if it is the first job in it. The 
+ * replicas of an entry that names no pool share a pool of their own. 
+ * Replicas beyond the entry's minimum are parked.
+ *
+ * jobs: pointer to array containing the jobs
  *
- * Returns: a pointer to the made job struct using the paramters.
+ * job: the job, which has been made and is in a pool
+ *
+ * spec: the parsed jobfile line defining the job
+ *
+ * replica: which of the entry's replicas the job is, counted from 0
  */
-Job* make_job(char** jobTokens, bool verbose, int jobCount);
+void join_pool(Jobs* jobs, Job* job, JobSpec* spec, int replica);
 
-/* free_tasks()
- * ------------
- * frees the memory associated with an array of jobs
+/* compile_job_command()
+ * ---------------------
+ * Parses a job's command line into its argv and envp vectors and resolves
+ * its executable, so that nothing is parsed when the job is spawned.
+ *
+ * job: the job whose command is to be compiled, with cmd and attrs set.
  *
- * numberJobs: the number of jobs to be freed
+ * spec: the parsed jobfile line, whose attribute field holds any env 
+ * attributes.
  *
- * jobs: a pointer to an array of pointers to job structs.
+ * strings: the arena the vectors are allocated in.
  */
-void free_tasks(int numberJobs, Job** jobs);
+void compile_job_command(Job* job, JobSpec* spec, Arena* strings);
 
+/* free_jobs()
+ * -----------
+ * frees the memory associated with the jobs, their indexes and, all at 
+ * once, their strings
+ *
+ * jobs: a pointer to the jobs struct to be freed.
+ */
+void free_jobs(Jobs* jobs);
+
+/* grow_jobs()
+ * -----------
+ * Doubles the capacity of the jobs array and every array indexed like it.
+ *
+ * jobs: a pointer to the jobs struct to be grown.
+ */
+void grow_jobs(Jobs* jobs);
+
+/* job_state()
+ * -----------
+ * Returns: true if the job at the given index has the given JOB_ flag set, 
+ * false otherwise.
+ */
+bool job_state(Jobs* jobs, int index, unsigned char flag);
+
+/* set_job_state()
+ * ---------------
+ * Sets or clears one of a job's JOB_ flags, keeping the counts of runnable,
+ * running and output open jobs up to date.
+ *
+ * jobs: pointer to array containing the jobs
+ *
+ * index: the index of the job
+ *
+ * flag: the JOB_ flag to change
+ *
+ * set: true to set the flag, false to clear it
+ */
+void set_job_state(Jobs* jobs, int index, unsigned char flag, bool set);
+
+/* set_job_pid()
+ * -------------
+ * Records the pid of a job's process, or NO_PID once it has been reaped, in
+ * the pids array and the pid index.
+ *
+ * jobs: pointer to array containing the jobs
+ *
+ * index: the index of the job
+ *
+ * pid: the pid of the job's process
+ */
+void set_job_pid(Jobs* jobs, int index, pid_t pid);
+
+/* find_job_by_number()
+ * --------------------
+ * Returns: the job with the given job number, or NULL if there is none.
+ */
+Job* find_job_by_number(Jobs* jobs, int jobNumber);
 /* init_jobs()
  * -----------
  * Initialises a jobs struct. This includes, allocating size and setting up
@@ -122,55 +327,153 @@ bool get_io_fds(bool isInput, int ioPipe[2], int* fd, char* ioFile,
  */
 void init_in_out(InOut* inOut);
 
+/* size_job_pipes()
+ * ----------------
+ * Asks for the capacity given by the job's pipe attribute for its newly
+ * made pipes, if it has one.
+ *
+ * job: the job whose pipes are sized
+ */
+void size_job_pipes(Job* job);
+
+/* number_job()
+ * ------------
+ * Gives a job the next job number.
+ *
+ * jobs: pointer to array containing the jobs, which counts the workers
+ * numbered so far
+ *
+ * job: the job to be numbered
+ */
+void number_job(Jobs* jobs, Job* job);
+
+/* index_job_number()
+ * ------------------
+ * Records the index of the job with a job number, making room for it if 
+ * need be.
+ *
+ * jobs: pointer to array containing the jobs
+ *
+ * jobNumber: the job number
+ *
+ * index: the index of the job, or NO_INDEX if no job has the number now
+ */
+void index_job_number(Jobs* jobs, int jobNumber, int index);
+
 /* start_job()
  * -----------
  * Starts the specified job. This includes handling the piping and dup2 use
  * if necessary. Handles whether this call is a restart of a job or the first
- * time a job is being made.
+ * time a job is being made. A piped output is watched by the reactor.
  *
- * job: the job to be started
+ * jobs: pointer to array containing the jobs, which counts the workers
+ * started so far
  *
- * totalWorkers: pointer to integer containing the value of the number of
- * total workers.
+ * job: the job to be started
  *
  * isRestart: true if the function is being called for a restart of the job.
  * false if it is being called to start the job for the first time.
  *
+ * reactor: the reactor that watches the job's output.
+ *
  * verbose: whether jobthing is in verbose mode.
  *
  * Errors: function will return without spawning job if the job input or output
  * configuration specified is invalid. Will set job as unrunnable and return.
  */
-void start_job(Job* job, int* totalWorkers, bool isRestart, bool verbose);
+void start_job(Jobs* jobs, Job* job, bool isRestart, Reactor* reactor,
+        bool verbose);
+
+/* launch_job()
+ * ------------
+ * Creates the process for a job whose file descriptors have been set up. 
+ * posix_spawn() is used unless the job asks to be forked, as it avoids 
+ * copying jobthing's page tables. If posix_spawn() fails, e.g., because the
+ * command cannot be executed, the job is forked instead so the failure is 
+ * reported through its exit status as before.
+ *
+ * job: the job to launch.
+ *
+ * Returns: the process id of the job, or -1 if no process could be created.
+ */
+pid_t launch_job(Job* job);
+
+/* posix_spawn_job()
+ * -----------------
+ * Spawns a job's pre-compiled command with posix_spawn(), using file 
+ * actions for the io dups that spawn_job() performs after fork().
+ *
+ * job: the job to spawn.
+ *
+ * Returns: the process id of the job, or -1 if it could not be spawned.
+ */
+pid_t posix_spawn_job(Job* job);
 
 /* spawn_job()
  * -----------
- * Spawns a job. It handles the io dups and closing pipes if relevant.
+ * Spawns a job in a forked child. Only the io dups, the job's placement 
+ * and exec of the job's pre-compiled command are done, as everything else 
+ * was prepared when the job was made.
  *
  * job: the job to spawn.
  *
- * Errors: will error with FAILED_EXEC_EXIT (99) if the exec fails and the 
- * child is not spawned
+ * Errors: will error with FAILED_EXEC_EXIT (99) if the placement cannot be
+ * applied or the exec fails and the child is not spawned
  */
 void spawn_job(Job* job);
 
-/* all_jobs_unrunnable()
+/* close_job_fds()
+ * ---------------
+ * Closes the specified job's file descriptors for its pipes or io files.
+ *
+ * jobs: pointer to array containing the jobs
+ *
+ * job: the job to have its fds closed
+ */
+void close_job_fds(Jobs* jobs, Job* job);
+
+/* close_job_input()
+ * -----------------
+ * Closes the job's input, so that a job reading a pipe sees EOF.
+ *
+ * jobs: pointer to array containing the jobs
+ *
+ * job: the job to have its input closed
+ */
+void close_job_input(Jobs* jobs, Job* job);
+
+/* register_job_files()
  * --------------------
- * Determines whether all jobs are unrunnable.
+ * Registers the job's input and output in its io_uring file slots, or 
+ * empties the slots of those that are closed. Does nothing without 
+ * io_uring.
  *
- * jobs: pointer to array containing jobs
+ * jobs: pointer to array containing the jobs
  *
- * Returns: true if all jobs are unrunnable, false otherwise.
+ * job: the job whose files are registered
  */
-bool all_jobs_unrunnable(Jobs* jobs);
+void register_job_files(Jobs* jobs, Job* job);
 
-/* close_job_fds()
+/* close_job_inputs()
+ * ------------------
+ * Closes the write end of every runnable job's input pipe so that jobs 
+ * reading from jobthing see end of file. Pipes with queued input are closed
+ * once their queue has been written.
+ *
+ * jobs: pointer to array containing the jobs
+ */
+void close_job_inputs(Jobs* jobs);
+
+/* end_job_input()
  * ---------------
- * Closes the specified job's file descriptors for its pipes or io files.
+ * Closes a job's input pipe so that it sees end of file, or marks it to be
+ * closed once its queued input has been written.
  *
- * job: the job to have its fds closed
+ * jobs: pointer to array containing the jobs
+ *
+ * job: the job, whose input is a pipe
  */
-void close_job_fds(Job* job);
+void end_job_input(Jobs* jobs, Job* job);
 
 /* close_all_runnable_fds()
  * ------------------------
@@ -188,66 +491,678 @@ void close_all_runnable_fds(Jobs* jobs);
  */
 void init_job(Job* job);
 
-/* reap_process_job(Job* job, bool verbose)
- * ----------------------------------------
- * Attempts to reap the specified job and if successful will update that
- * job's stats in its struct. If the job does not need to be reaped, does 
- * nothing.
+/* reap_process_job()
+ * ------------------
+ * Attempts to reap the specified job and if successful handles its exit 
+ * with job_exited(). If the job does not need to be reaped, or has already
+ * been reaped, does nothing. 
+ * Only the job's own process is waited for, so the exit status of every 
+ * other job is left to be reported by its own reap.
+ *
+ * jobs: pointer to array containing the jobs
  *
  * job: the job to attempt to be reaped.
  *
+ * reactor: the reactor watching the job's output.
+ *
+ * verbose: whether the verbose mode is set
+ */
+void reap_process_job(Jobs* jobs, Job* job, Reactor* reactor, 
+        bool verbose);
+
+/* job_exited()
+ * ------------
+ * Updates a job's stats after its process has been reaped. Output the job 
+ * wrote before exiting is relayed before its termination is reported. Input
+ * still queued for the job is discarded. In threaded mode the job's I/O 
+ * thread is told to drain its output, and the rest is left to 
+ * finish_job_exit() once it has.
+ *
+ * jobs: pointer to array containing the jobs
+ *
+ * job: the job that was reaped.
+ *
+ * status: the wait status of the job's process.
+ *
+ * usage: the resources the job's process used, as it was reaped with.
+ *
+ * reactor: the reactor watching the job's output.
+ *
  * verbose: whether the verbose mode is set
  */
-void reap_process_job(Job* job, bool verbose);
+void job_exited(Jobs* jobs, Job* job, int status, struct rusage* usage, 
+        Reactor* reactor, bool verbose);
+
+/* schedule_restart()
+ * ------------------
+ * Restarts a job that has exited once its backoff delay has passed. A job 
+ * that keeps exiting soon after starting waits longer each time, up to its
+ * maximum delay. A job with no restart delay is restarted straight away.
+ *
+ * jobs: pointer to array containing the jobs.
+ *
+ * job: the job to be restarted.
+ *
+ * wheel: the timer wheel that restarts are scheduled on.
+ *
+ * reactor: the reactor watching the jobs' pipes.
+ *
+ * verbose: whether jobthing is in verbose mode.
+ */
+void schedule_restart(Jobs* jobs, Job* job, TimerWheel* wheel, 
+        Reactor* reactor, bool verbose);
+
+/* next_restart_delay()
+ * --------------------
+ * Works out how long to wait before restarting a job and grows the job's 
+ * backoff for the next restart. Jitter spreads out the restarts of jobs 
+ * that failed together.
+ *
+ * job: the job to be restarted.
+ *
+ * Returns: the restart delay in milliseconds.
+ */
+long long next_restart_delay(Job* job);
 
 /* restart_job()
  * -------------
  * Configures and restarts the specified job
  * 
+ * jobs: pointer to array containing the jobs.
+ *
  * job: the job to be restarted.
  *
+ * reactor: the reactor that watches the job's output.
+ *
  * verbose: whether the verbose mode is set
  *
  */
-void restart_job(Job* job, bool verbose);
+void restart_job(Jobs* jobs, Job* job, Reactor* reactor, bool verbose);
 
 /* populate_jobs()
  * ---------------
- * Uses the jobfile specified in params to validate listed jobs, make them,
- * and then use them to populate.
+ * Loads the jobfile specified in params, validating its lines in parallel,
+ * and makes a job for each valid line in the order they appear. The load 
+ * time is reported in verbose mode.
  *
  * jobs: pointer to jobs struct that is to be populated
  *
  * params: pointer to struct containing command line parameters specified
+ *
+ * Errors: exits with INVALID_JOBFILE_EXIT (2) if the jobfile cannot be read.
  */
 void populate_jobs(Jobs* jobs, Params* params);
 
+/* add_entry()
+ * -----------
+ * Makes a job for each replica of a jobfile entry, at the end of the jobs 
+ * or in the slots of a released entry, and adds it to its pool or to the 
+ * jobs sent every line.
+ *
+ * jobs: pointer to jobs struct the jobs are added to
+ *
+ * spec: the parsed jobfile line defining the entry
+ *
+ * params: pointer to struct containing command line parameters specified
+ *
+ * replaces: the entry the new jobs replace, in which case they are held 
+ * until the rollout reaches them, or NO_INDEX
+ *
+ * entry: the first of the released slots to make the jobs in, which must 
+ * number as many as the replicas, or NO_INDEX to add them at the end
+ *
+ * Returns: the index of the entry's first job.
+ */
+int add_entry(Jobs* jobs, JobSpec* spec, Params* params, int replaces, 
+        int entry);
+
+/* release_removed_job()
+ * ---------------------
+ * Releases a removed job if it has exited and nothing of it is left to 
+ * relay, freeing its buffers and taking it out of its pool and the job 
+ * numbers, so that its slot can be made into a new job.
+ *
+ * jobs: pointer to array containing the jobs
+ *
+ * job: the removed job
+ */
+void release_removed_job(Jobs* jobs, Job* job);
+
+/* finish_job_exit()
+ * -----------------
+ * Reports the termination of a job whose output has been drained, discards
+ * its queued input and closes its files, then decides whether it is to be
+ * restarted, parked or left unrunnable.
+ *
+ * jobs: pointer to array containing the jobs
+ *
+ * job: the job that exited.
+ *
+ * reactor: the reactor watching the job's input.
+ */
+void finish_job_exit(Jobs* jobs, Job* job, Reactor* reactor);
+
+/* apply_shard_reply()
+ * -------------------
+ * Applies what an I/O thread reports about a job's output to the job's 
+ * stats and state.
+ *
+ * jobs: pointer to array containing the jobs
+ *
+ * reply: the reply from the I/O thread.
+ *
+ * reactor: the reactor watching the job's input.
+ *
+ * Returns: true if the reply finished the exit of the job, false otherwise.
+ */
+bool apply_shard_reply(Jobs* jobs, ShardReply* reply, Reactor* reactor);
+
 /* read_process_input()
  * --------------------
- * Reads input from inputfile and then ignores it, handles it as a command,
- * or sends it to all jobs, depending on what it is.
+ * Performs one read from the input file and then, for every complete line
+ * read, handles it as a command or queues it for all jobs, depending on what
+ * it is. The jobs' queues are then written, so every line read in one go is
+ * written to a job with a single call.
+ *
+ * params: the parameters specified by the command line.
+ *
+ * input: the line buffer holding partially read input
+ *
+ * jobs: the jobs to iterate over and send input
+ *
+ * reactor: the reactor that watches job input pipes that are full
+ *
+ * Returns: false if EOF (or a read error) was reached on the input file, 
+ * and no lines are held back by a *sleep, true otherwise, including when 
+ * there was nothing to read yet.
+ */
+bool read_process_input(Params* params, LineBuffer* input, Jobs* jobs, 
+        Reactor* reactor);
+
+/* read_input_chunks()
+ * -------------------
+ * The threaded mode read_process_input(). Takes the chunks of input the 
+ * reader thread has read, until a job's queue is full, and processes their
+ * complete lines.
  *
  * params: the parameters specified by the command line.
  *
- * inputFile: the file that the information needs to be read
+ * input: the line buffer holding partially read input
  *
  * jobs: the jobs to iterate over and send input
  *
- * Returns: false if a command is read from the input file, true otherwise.
- * Errors: exits with SUCCESSFUL_EXIT (0) if EOF is read from input file.
+ * reactor: the reactor that watches job input pipes that are full
+ *
+ * Returns: false if the end of the input was reached, and no lines are held
+ * back by a *sleep, true otherwise.
+ */
+bool read_input_chunks(Params* params, LineBuffer* input, Jobs* jobs, 
+        Reactor* reactor);
+
+/* process_input_lines()
+ * ---------------------
+ * Handles every complete line in the input buffer as a command or queues it
+ * for the jobs, depending on what it is.
+ *
+ * params: the parameters specified by the command line.
+ *
+ * input: the line buffer holding partially read input
+ *
+ * jobs: the jobs to send input to
+ */
+void process_input_lines(Params* params, LineBuffer* input, Jobs* jobs);
+
+/* input_blocked()
+ * ---------------
+ * Returns: true if no more input is to be read, because a job's input 
+ * queue or an ordered pool's window is full or a *sleep is running, false
+ * otherwise.
+ */
+bool input_blocked(Jobs* jobs);
+
+/* sleep_timeout()
+ * ---------------
+ * Returns: the milliseconds until a running *sleep ends, or NO_DEADLINE if
+ * input is not asleep.
+ */
+int sleep_timeout(Jobs* jobs);
+
+/* end_input_sleep()
+ * -----------------
+ * Ends a *sleep, handling the lines of input it held back.
+ *
+ * params: the parameters specified by the command line.
+ *
+ * input: the line buffer holding the held back input
+ *
+ * jobs: the jobs to send input to
+ *
+ * reactor: the reactor that watches job input pipes that are full
+ *
+ * Returns: false if the end of the input has been reached and every line of
+ * it handled, true otherwise.
+ */
+bool end_input_sleep(Params* params, LineBuffer* input, Jobs* jobs, 
+        Reactor* reactor);
+
+/* send_input_line()
+ * -----------------
+ * Queues a line of input for every running job with a piped input that is
+ * not in a pool, and for one such job chosen by each pool.
+ *
+ * line: the line to be sent, without its newline.
+ *
+ * length: the length of the line.
+ *
+ * jobs: the jobs to iterate over and send input
+ *
+ * echo: whether the line is printed for each job it is sent to
+ */
+void send_input_line(char* line, size_t length, Jobs* jobs, bool echo);
+
+/* send_job_line()
+ * ---------------
+ * Queues a line of input for a job.
+ *
+ * jobs: pointer to array containing the jobs
+ *
+ * job: the job the line is for, which is running with a piped input
+ *
+ * line: the line to be sent, without its newline.
+ *
+ * length: the length of the line.
+ *
+ * sentUs: the time the line was read, if latency is being tracked
+ *
+ * echo: whether the line is printed
+ */
+void send_job_line(Jobs* jobs, Job* job, char* line, size_t length, 
+        long long sentUs, bool echo);
+
+/* choose_pool_member()
+ * --------------------
+ * Chooses the job of a pool that a line is sent to. Only running jobs with
+ * a piped input are chosen from. Round robin skips jobs whose input queue
+ * is full while any other job's is not.
+ *
+ * jobs: pointer to array containing the jobs
+ *
+ * pool: the pool
+ *
+ * line: the line to be sent, without its newline.
+ *
+ * length: the length of the line.
+ *
+ * Returns: the index of the chosen job, or NO_INDEX if no job in the pool
+ * can be sent the line.
+ */
+int choose_pool_member(Jobs* jobs, Pool* pool, char* line, size_t length);
+
+/* pool_member_ready()
+ * -------------------
+ * Returns: true if a job of a pool can be sent lines: it is running with a
+ * piped input and is not retiring, or it is waking.
+ */
+bool pool_member_ready(Jobs* jobs, Job* job);
+
+/* pool_saturated()
+ * ----------------
+ * Returns: true if every job of a pool that can be sent lines has at least
+ * the pool's scaleAt lines in flight or a full input queue, or no job can 
+ * be sent lines at all.
+ */
+bool pool_saturated(Jobs* jobs, Pool* pool);
+
+/* wake_pool_member()
+ * ------------------
+ * Chooses a parked job of a pool to be started at the end of the pass. It 
+ * can be sent lines straight away, which are queued until it starts.
+ *
+ * jobs: pointer to array containing the jobs
+ *
+ * pool: the pool, which has a parked job
+ */
+void wake_pool_member(Jobs* jobs, Pool* pool);
+
+/* start_woken_jobs()
+ * ------------------
+ * Starts every waking job, writes the lines queued for it and watches it 
+ * for going idle. Lines queued for a job that fails to start are dropped.
+ *
+ * jobs: pointer to array containing the jobs
+ *
+ * wheel: the timer wheel that idle checks are scheduled on
+ *
+ * reactor: the reactor watching the jobs' pipes
+ *
+ * verbose: whether jobthing is in verbose mode
+ */
+void start_woken_jobs(Jobs* jobs, TimerWheel* wheel, Reactor* reactor, 
+        bool verbose);
+
+/* job_retirable()
+ * ---------------
+ * Returns: true if a job is in a scalable pool and not already retiring, so
+ * that it is retired if it goes idle.
+ */
+bool job_retirable(Jobs* jobs, Job* job);
+
+/* watch_job_idle()
+ * ----------------
+ * Schedules the check for a job that has just started going idle, if it is
+ * retirable. The job's restart timer is used, as a running job has no 
+ * restart pending.
+ *
+ * jobs: pointer to array containing the jobs
+ *
+ * job: the job that has just started
+ *
+ * wheel: the timer wheel that idle checks are scheduled on
+ */
+void watch_job_idle(Jobs* jobs, Job* job, TimerWheel* wheel);
+
+/* check_idle_job()
+ * ----------------
+ * Retires a running, retirable job that has had no line in or out for its
+ * pool's idle time, unless that would leave the pool with fewer active jobs
+ * than its minimum. Otherwise checks again later.
+ *
+ * jobs: pointer to array containing the jobs
+ *
+ * job: the job whose idle check has come due
+ *
+ * wheel: the timer wheel that idle checks are scheduled on
+ *
+ * verbose: whether jobthing is in verbose mode
+ */
+void check_idle_job(Jobs* jobs, Job* job, TimerWheel* wheel, bool verbose);
+
+/* retire_job()
+ * ------------
+ * Closes the input of an idle job, whose queue is empty, so that it exits
+ * at end of file. Once reaped, it is parked instead of being restarted, and
+ * its exit does not count against its restarts.
+ *
+ * jobs: pointer to array containing the jobs
+ *
+ * job: the job to be retired
+ *
+ * verbose: whether jobthing is in verbose mode
+ */
+void retire_job(Jobs* jobs, Job* job, bool verbose);
+
+/* flush_job_input()
+ * -----------------
+ * Writes as much of a job's input queue as its pipe accepts. A pipe that is
+ * full is watched until it becomes writable again. A pipe whose reader has 
+ * gone away marks the job as killed.
+ *
+ * jobs: pointer to array containing the jobs
+ *
+ * index: the index of the job whose queue is to be written
+ *
+ * reactor: the reactor that watches job input pipes that are full
+ */
+void flush_job_input(Jobs* jobs, int index, Reactor* reactor);
+
+/* apply_flush_result()
+ * --------------------
+ * Acts on the result of writing a job's input queue: a pipe that is full 
+ * is watched until it becomes writable again, a pipe whose reader has gone
+ * away marks the job as killed, and a job whose input is closing has it 
+ * closed once its queue is empty.
+ *
+ * jobs: pointer to array containing the jobs
+ *
+ * index: the index of the job whose queue was written
+ *
+ * result: the result of the write.
+ *
+ * reactor: the reactor that watches job input pipes that are full
+ */
+void apply_flush_result(Jobs* jobs, int index, FlushResult result, 
+        Reactor* reactor);
+
+/* flush_job_inputs()
+ * ------------------
+ * Writes the input queue of every job that has queued input and is not 
+ * already waiting for its pipe to become writable.
+ *
+ * jobs: pointer to array containing the jobs
+ *
+ * reactor: the reactor that watches job input pipes that are full
  */
-bool read_process_input(Params* params, FILE* inputFile, Jobs* jobs);
+void flush_job_inputs(Jobs* jobs, Reactor* reactor);
+
+/* write_job_inputs()
+ * ------------------
+ * The io_uring flush_job_inputs(). The queues of every job are written by
+ * one io_uring_enter(), or in batches of as many as the ring holds, one 
+ * writev() each, rather than one system call per job.
+ *
+ * jobs: pointer to array containing the jobs
+ *
+ * reactor: the reactor that watches job input pipes that are full
+ */
+void write_job_inputs(Jobs* jobs, Reactor* reactor);
+
+/* update_input_blocked()
+ * ----------------------
+ * Updates whether a job's full QUEUE_BLOCK input queue is holding back
+ * input, keeping the count of blocked queues up to date.
+ *
+ * jobs: pointer to array containing the jobs
+ *
+ * job: the job whose queue has changed
+ */
+void update_input_blocked(Jobs* jobs, Job* job);
+
+/* discard_job_input()
+ * -------------------
+ * Drops everything queued for an exited job and stops watching its pipe.
+ *
+ * jobs: pointer to array containing the jobs
+ *
+ * job: the job that has exited
+ *
+ * reactor: the reactor that watches job input pipes that are full
+ */
+void discard_job_input(Jobs* jobs, Job* job, Reactor* reactor);
 
 /* process_job_output()
  * --------------------
- * Reads one line of output from each runnable, piped and not-killed job and 
- * then prints it to standard out.
+ * Reads the job's non-blocking output pipe and prints complete lines to 
+ * standard out until the pipe is empty or lineBudget lines have been 
+ * printed. Partial lines are kept in the job's buffer until completed. The
+ * lines of a job in an ordered pool are kept until it is their turn, and 
+ * are not limited by lineBudget. On end of file the output stops being 
+ * watched.
+ *
+ * jobs: pointer to array containing the jobs
+ *
+ * job: the job whose output is ready to be read
+ *
+ * reactor: the reactor watching the job's output
+ *
+ * lineBudget: the maximum number of lines to print, or NO_LINE_BUDGET.
+ *
+ * verbose: whether verbose mode is set
+ *
+ * Returns: true if the budget ran out with output possibly left to relay,
+ * false if the pipe is empty or closed.
+ */
+bool process_job_output(Jobs* jobs, Job* job, Reactor* reactor, 
+        int lineBudget, bool verbose);
+
+/* relay_job_line()
+ * ----------------
+ * Relays a line of a job's output to standard out and counts it as the 
+ * answer to the oldest line the job has in flight.
+ *
+ * jobs: pointer to array containing the jobs
+ *
+ * job: the job the line came from
+ *
+ * line: the line, without its newline.
+ *
+ * length: the length of the line.
+ *
+ * readUs: when the line was read, if latency is being tracked
+ *
+ * relay: false if the line is only counted and not printed.
+ */
+void relay_job_line(Jobs* jobs, Job* job, char* line, size_t length, 
+        long long readUs, bool relay);
+
+/* job_ordered()
+ * -------------
+ * Returns: true if the job is in a pool that relays answers in input order.
+ */
+bool job_ordered(Jobs* jobs, Job* job);
+
+/* job_on_engine()
+ * ---------------
+ * Returns: true if the job's output is relayed by an I/O thread. Jobs of 
+ * ordered pools are relayed by the main thread even in threaded mode, as 
+ * their answers wait on each other.
+ */
+bool job_on_engine(Jobs* jobs, Job* job);
+
+/* release_ordered_output()
+ * ------------------------
+ * Relays the answers of an ordered pool that are next in input order, 
+ * from whichever jobs have them buffered, until one has yet to come. A line
+ * unanswered for longer than the pool's timeout is skipped.
+ *
+ * jobs: pointer to array containing the jobs
+ *
+ * pool: the ordered pool
+ *
+ * force: whether every unanswered line is skipped, so that all buffered 
+ * answers are relayed.
+ */
+void release_ordered_output(Jobs* jobs, Pool* pool, bool force);
+
+/* relay_late_lines()
+ * ------------------
+ * Relays, or drops if the job's pool drops stragglers, the buffered 
+ * answers of a job to lines that were skipped for taking too long.
+ *
+ * jobs: pointer to array containing the jobs
+ *
+ * job: the job in an ordered pool
+ *
+ * readUs: when the lines were read, if latency is being tracked
+ */
+void relay_late_lines(Jobs* jobs, Job* job, long long readUs);
+
+/* forget_ordered_lines()
+ * ----------------------
+ * Skips the lines an exited job of an ordered pool left unanswered, and 
+ * ends or discards an unfinished last answer so that its buffer can go on
+ * to be filled if the job is restarted.
+ *
+ * jobs: pointer to array containing the jobs
+ *
+ * job: the job that exited
+ */
+void forget_ordered_lines(Jobs* jobs, Job* job);
+
+/* update_window_full()
+ * --------------------
+ * Counts an ordered pool as a blocked queue while orderWindow of its lines
+ * are waiting to be answered, and uncounts it once they are not.
+ *
+ * jobs: pointer to array containing the jobs
+ *
+ * pool: the ordered pool
+ */
+void update_window_full(Jobs* jobs, Pool* pool);
+
+/* order_timeout()
+ * ---------------
+ * Returns: the milliseconds until the oldest unanswered line of an ordered
+ * pool with a timeout is to be skipped, or NO_DEADLINE if there is none.
+ */
+int order_timeout(Jobs* jobs);
+
+/* release_ordered_pools()
+ * -----------------------
+ * Releases the output of every ordered pool, skipping lines that have timed
+ * out.
+ *
+ * jobs: pointer to array containing the jobs
+ *
+ * force: whether every unanswered line is skipped.
+ */
+void release_ordered_pools(Jobs* jobs, bool force);
+
+/* mark_output_ready()
+ * -------------------
+ * Queues a job whose output pipe is readable to be relayed.
+ *
+ * jobs: pointer to array containing the jobs
+ *
+ * index: the index of the job whose output is ready
+ */
+void mark_output_ready(Jobs* jobs, int index);
+
+/* relay_ready_outputs()
+ * ---------------------
+ * Relays up to OUTPUT_LINE_BUDGET lines from each queued job in turn. Jobs
+ * that used their whole budget stay queued, behind the jobs queued after 
+ * them, so a chatty job cannot starve the others.
+ *
+ * jobs: pointer to array containing the jobs
+ *
+ * reactor: the reactor watching the jobs' outputs
+ *
+ * verbose: whether verbose mode is set
+ *
+ * Returns: true if output is still queued and should be relayed without
+ * waiting for new events, false otherwise.
+ */
+bool relay_ready_outputs(Jobs* jobs, Reactor* reactor, bool verbose);
+
+/* read_ready_outputs()
+ * --------------------
+ * With io_uring, reads the output of every queued job that has no complete
+ * line left to relay, or is in an ordered pool, all in one 
+ * io_uring_enter(), or in batches of as many as the ring holds, ahead of
+ * relaying it. Each job's outputMore is set to whether its read found 
+ * output.
+ *
+ * jobs: pointer to array containing the jobs
+ *
+ * reactor: the reactor that watches job input pipes that are full
+ */
+void read_ready_outputs(Jobs* jobs, Reactor* reactor);
+
+/* complete_uring_ops()
+ * --------------------
+ * Submits the job pipe reads and writes queued on the io_uring and applies
+ * each result to the job it was for, as a read of its output or a write of
+ * its input queue.
+ *
+ * jobs: pointer to array containing the jobs
+ *
+ * reactor: the reactor that watches job input pipes that are full
+ */
+void complete_uring_ops(Jobs* jobs, Reactor* reactor);
+
+/* drain_job_output()
+ * ------------------
+ * Relays whatever output is left in an exited job's pipe without blocking.
+ *
+ * jobs: pointer to array containing the jobs
+ *
+ * job: the job whose output is to be drained
  *
- * jobs: pointer to array containing jobs to be read
+ * reactor: the reactor watching the job's output
  *
  * verbose: whether verbose mode is set
  */
-void process_job_output(Jobs* jobs, bool verbose);
+void drain_job_output(Jobs* jobs, Job* job, Reactor* reactor, bool verbose);
 
 /* handle_command()
  * ----------------
@@ -257,16 +1172,114 @@ void process_job_output(Jobs* jobs, bool verbose);
  * input: the potential command
  *
  * jobs: pointer to array containing the jobs
+ *
+ * replies: where the command's output and errors are written, standard 
+ * output for commands in the input
+ *
+ * Returns: true if the command was carried out, false if it was reported 
+ * as an error.
  */
-void handle_command(char* input, Jobs* jobs);
+bool handle_command(char* input, Jobs* jobs, Writer* replies);
 
 /* handle_sleep()
  * --------------
- * Causes jobthing to sleep if the input is in a valid format
+ * Stops lines of input from being sent or handled for the given number of
+ * milliseconds, if the input is in a valid format. Everything else carries
+ * on while input sleeps.
  *
  * input: the sleep command
+ *
+ * jobs: pointer to array containing jobs
+ *
+ * replies: where errors are written
+ *
+ * Returns: true if input is now asleep, false otherwise.
  */
-void handle_sleep(char* input);
+bool handle_sleep(char* input, Jobs* jobs, Writer* replies);
+
+/* handle_reload()
+ * ---------------
+ * Has the jobfile read again at the end of the pass, with changed entries 
+ * replaced surge jobs at a time, surge being the input argument if given.
+ *
+ * input: the reload command
+ *
+ * jobs: pointer to array containing jobs
+ *
+ * replies: where errors are written
+ *
+ * Returns: true if the reload was arranged, false otherwise.
+ */
+bool handle_reload(char* input, Jobs* jobs, Writer* replies);
+
+/* handle_handover()
+ * -----------------
+ * Has jobthing exec the binary given in the input argument, or its own 
+ * binary again, handing its running jobs over to it, once every job's 
+ * queued input has been written. An argument of cancel calls off a pending
+ * handover instead.
+ *
+ * input: the handover command
+ *
+ * jobs: pointer to array containing jobs
+ *
+ * replies: where errors are written
+ *
+ * Returns: true if the handover was arranged or called off, false otherwise.
+ */
+bool handle_handover(char* input, Jobs* jobs, Writer* replies);
+
+/* handle_latency()
+ * ----------------
+ * Reports the response latency percentiles of every job, or of the job 
+ * given in the input argument, if latency tracking is on.
+ *
+ * input: the latency command
+ *
+ * jobs: pointer to array containing jobs
+ *
+ * replies: where the report and errors are written
+ *
+ * Returns: true if latency was reported, false otherwise.
+ */
+bool handle_latency(char* input, Jobs* jobs, Writer* replies);
+
+/* report_latency()
+ * ----------------
+ * Prints the number of responses and the 50th, 99th and 99.9th percentile
+ * and highest response latency of a job.
+ *
+ * job: the job to report on
+ *
+ * replies: where the report is written
+ */
+void report_latency(Job* job, Writer* replies);
+
+/* handle_usage()
+ * --------------
+ * Reports the resources used by the exited processes of every job, or of 
+ * the job given in the input argument.
+ *
+ * input: the usage command
+ *
+ * jobs: pointer to array containing jobs
+ *
+ * replies: where the report and errors are written
+ *
+ * Returns: true if usage was reported, false otherwise.
+ */
+bool handle_usage(char* input, Jobs* jobs, Writer* replies);
+
+/* report_usage()
+ * --------------
+ * Prints the CPU time, peak resident set size, context switches and block
+ * reads and writes totalled over a job's processes that have exited.
+ *
+ * job: the job to report on
+ *
+ * replies: where the report is written
+ */
+void report_usage(Job* job, Writer* replies);
 
 /* handle_signal()
  * ---------------
@@ -276,5 +1289,9 @@ void handle_sleep(char* input);
  * input: the signal command
  *
  * jobs: pointer to array containing jobs
+ *
+ * replies: where errors are written
+ *
+ * Returns: true if the job was signalled, false otherwise.
  */
-void handle_signal(char* input, Jobs* jobs);
+bool handle_signal(char* input, Jobs* jobs, Writer* replies);
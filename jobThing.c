@@ -14,133 +14,609 @@
 #include "job.h"
 #include "helper.h"
 #include "parsing.h"
+#include "reactor.h"
+#include "linebuf.h"
+#include "broadcast.h"
+#include "timerwheel.h"
+#include "metrics.h"
+#include "control.h"
+#include "reload.h"
+#include "handover.h"
 #define SUCCESSFUL_EXIT 0
 #endif //JOBTHING_H
 
 /* operation()
  * -----------
  * Handles the main operation of jobthing after jobs have been spawned and 
- * need to be tracked and interacted with.
+ * need to be tracked and interacted with. Sleeps in the reactor until input,
+ * job output, a child exit or a restart timer is ready and handles only what
+ * is ready.
  *
  * jobs: pointer to array containing information on jobs and the jobs 
  * themselves
  *
  * params: the setup paramters specified by command line arguments
  *
+ * reactor: the reactor watching the jobs' outputs
+ *
+ * childExitFd: the signalfd that is readable when a child has exited
+ *
+ * reportFd: the signalfd that is readable when SIGHUP has been received
+ *
+ * handover: the handover jobthing was started by, or NULL
+ *
  * Errors: exits with SUCCESSFUL_EXIT (0) if there are no more viable workers
+ * or once job output has been drained after EOF on the input file.
  */
-void operation(Jobs* jobs, Params* params);
+void operation(Jobs* jobs, Params* params, Reactor* reactor, int childExitFd,
+        int reportFd, Handover* handover);
 
-/* dead_pipe_handler()
+/* reap_restart_job()
+ * ------------------
+ * Reaps a job whose pidfd reported it has exited and schedules its restart
+ * if it is allowed to be restarted.
+ *
+ * jobs: pointer to array containing the jobs
+ *
+ * job: the job that has exited
+ *
+ * wheel: the timer wheel that restarts are scheduled on
+ *
+ * reactor: the reactor watching the jobs' outputs
+ *
+ * allowRestart: false once input has ended, as a restarted job would have no
+ * input to process.
+ *
+ * verbose: whether verbose mode is set
+ */
+void reap_restart_job(Jobs* jobs, Job* job, TimerWheel* wheel, 
+        Reactor* reactor, bool allowRestart, bool verbose);
+
+/* reap_restart_jobs()
  * -------------------
- * Is called when jobthing tries to write to a pipe that is terminanted. It
- * indentifies that job as being killed.
+ * Reaps every child that has exited, finding its job by pid, and schedules
+ * restarts for those that are allowed to be restarted. This is the fallback
+ * used on SIGCHLD when the kernel does not support pidfds.
  *
- * sig: the signal sent
+ * jobs: pointer to array containing the jobs
+ *
+ * wheel: the timer wheel that restarts are scheduled on
+ *
+ * reactor: the reactor watching the jobs' outputs
  *
- * info: pointer to struct containting information about sending process
+ * allowRestart: false once input has ended, as restarted jobs would have no
+ * input to process.
  *
- * ucontext: contains signal context information
+ * verbose: whether verbose mode is set
  */
-void dead_pipe_handler(int sig, siginfo_t* info, void* ucontext);
+void reap_restart_jobs(Jobs* jobs, TimerWheel* wheel, Reactor* reactor, 
+        bool allowRestart, bool verbose);
+
+/* restart_due_jobs()
+ * ------------------
+ * Restarts every job whose restart timer has expired, and checks whether 
+ * running replicas whose timer has expired have gone idle. Restarts that 
+ * come due after input has ended are dropped.
+ *
+ * jobs: pointer to array containing the jobs
+ *
+ * wheel: the timer wheel that restarts are scheduled on
+ *
+ * reactor: the reactor watching the jobs' outputs
+ *
+ * allowRestart: false once input has ended
+ *
+ * verbose: whether verbose mode is set
+ */
+void restart_due_jobs(Jobs* jobs, TimerWheel* wheel, Reactor* reactor, 
+        bool allowRestart, bool verbose);
+
+/* handle_shard_replies()
+ * ----------------------
+ * Applies every reply the I/O threads have sent, and schedules the restart
+ * of each job whose exit the replies finished, if it is allowed to be 
+ * restarted.
+ *
+ * jobs: pointer to array containing the jobs
+ *
+ * wheel: the timer wheel that restarts are scheduled on
+ *
+ * reactor: the reactor watching the jobs' inputs
+ *
+ * allowRestart: false once input has ended
+ *
+ * verbose: whether verbose mode is set
+ */
+void handle_shard_replies(Jobs* jobs, TimerWheel* wheel, Reactor* reactor, 
+        bool allowRestart, bool verbose);
+
+/* process_input()
+ * ---------------
+ * Reads and handles input that is ready, either as lines or, in zero-copy
+ * broadcast mode, as raw chunks. In threaded mode the input has already 
+ * been read by the reader thread.
+ *
+ * params: the setup paramters specified by command line arguments
+ *
+ * input: the line buffer used to read input
+ *
+ * broadcast: the zero-copy broadcast state
+ *
+ * jobs: pointer to array containing the jobs
+ *
+ * reactor: the reactor watching the jobs' pipes
+ *
+ * Returns: false if EOF was reached on the input, true otherwise.
+ */
+bool process_input(Params* params, LineBuffer* input, Broadcast* broadcast,
+        Jobs* jobs, Reactor* reactor);
+
+/* check_viable_workers()
+ * ----------------------
+ * Exits if no job can run any more and no children are left.
+ *
+ * jobs: pointer to array containing the jobs
+ *
+ * input: the line buffer used to read input
+ *
+ * params: the setup paramters specified by command line arguments
+ */
+void check_viable_workers(Jobs* jobs, LineBuffer* input, Params* params);
+
+/* exit_jobthing()
+ * ---------------
+ * Releases every job's resources and exits.
+ *
+ * jobs: pointer to array containing the jobs
+ *
+ * input: the line buffer used to read input
+ *
+ * params: the setup paramters specified by command line arguments
+ */
+void exit_jobthing(Jobs* jobs, LineBuffer* input, Params* params);
+
+/* dead_pipe_handler()
+ * -------------------
+ * Is called when jobthing tries to write to a pipe that is terminated. It 
+ * does nothing, so that the write fails with EPIPE, where the job is marked
+ * as killed from the event loop.
+ *
+ * sig: the signal sent
+ */
+void dead_pipe_handler(int sig);
 
 /* report_stats()
  * --------------
- * Reports statistics on all jobs specified in jobfile.
+ * Reports statistics on all jobs specified in jobfile. Called from the main
+ * loop when SIGHUP is received.
  * 
- * sig: the signal causing invocation of function *
+ * jobs: pointer to array containing the jobs
  */
-void report_stats(int sig);     
+void report_stats(Jobs* jobs);
+
+//Global so that the metrics socket is removed however jobthing exits
+MetricsServer metricsServer;
 
-//Global variable for signal handler to access jobs
-Jobs* sigHandlerJobs;
+//Global for the same reason as metricsServer
+ControlServer controlServer;
 
 int main(int argc, char** argv) { 
+    //A jobthing started by a handover takes over the jobs of the one before
+    //it instead of loading the jobfile
+    int handoverFd = handover_fd();
     Params params;
     init_params(&params);
-    validate_commands(&params, argc, argv);
+    validate_commands(&params, argc, argv, handoverFd != -1);
+    init_writer(&output, STDOUT_FILENO, params.flushPolicy, params.flushSize,
+            params.flushDeadlineMs);
+    output.framed = params.framed;
 
     Jobs jobs;
     init_jobs(&jobs);
-    sigHandlerJobs = &jobs;
-    populate_jobs(&jobs, &params);
+    jobs.trackLatency = params.latency;
+    srandom(getpid() ^ now_ms());
+    if (!init_metrics_server(&metricsServer, params.metricsSocket)) {
+        fprintf(stderr, "Error: Unable to open metrics socket\n");
+        exit(INVALID_METRICS_EXIT);
+    }
+    if (!init_control_server(&controlServer, params.controlSocket)) {
+        fprintf(stderr, "Error: Unable to open control socket\n");
+        free_metrics_server(&metricsServer);
+        exit(INVALID_CONTROL_EXIT);
+    }
+    Handover handover;
+    if (handoverFd != -1 && !(load_handover(&handover, handoverFd) && 
+            resume_jobs(&handover, &jobs, &params))) {
+        fprintf(stderr, "Error: Unable to resume handed over jobs\n");
+        exit(INVALID_JOBFILE_EXIT);
+    } else if (handoverFd == -1) {
+        populate_jobs(&jobs, &params);
+    }
 
-    int totalWorkers = 0;
-    int numJobs = jobs.numberJobs;
+    //Each job's exit is delivered through its own pidfd. Without pidfd 
+    //support, a SIGCHLD signalfd is used instead, which must be in place 
+    //before the first child can exit. It is also used after a handover, 
+    //as jobs may have exited during the exec, and as a subreaper jobthing
+    //has to reap children that are not its jobs.
+    Reactor reactor;
+    if (!init_reactor(&reactor)) {
+        perror("epoll_create1");
+        exit(EXIT_FAILURE);
+    }
+    int childExitFd = -1;
+    if (!pidfds_supported() || handoverFd != -1) {
+        childExitFd = block_child_signals();
+        reactor_watch(&reactor, childExitFd, WATCH_CHILD_EXIT, 0, EPOLLIN);
+        jobs.reapAny = true;
+    }
+    watch_metrics_server(&metricsServer, &reactor);
+    watch_control_server(&controlServer, &reactor);
+
+    //SIGHUP is read in the main loop so that reporting stats is free to use
+    //stdio and look at jobs mid-update
+    int reportFd = block_report_signal();
+    reactor_watch(&reactor, reportFd, WATCH_REPORT_SIGNAL, 0, EPOLLIN);
+
+    //Started before the jobs, whose output pipes are handed to it
+    Engine engine;
+    if (params.numThreads) {
+        start_engine(&engine, params.numThreads, jobs.numberJobs, &params, 
+                jobs.trackLatency);
+        jobs.engine = &engine;
+        reactor_watch(&reactor, engine.replyWakeFd, WATCH_SHARD_REPLIES, 0, 
+                EPOLLIN);
+    }
+
+    //Each job's pipes are registered with the io_uring as it starts
+    Uring uring;
+    if (params.uring && init_uring(&uring, URING_ENTRIES, 
+            jobs.numberJobs * FILE_SLOTS_PER_JOB)) {
+        jobs.uring = &uring;
+    } else if (params.uring && params.verbose) {
+        fprintf(stderr, "io_uring is unavailable, using epoll\n");
+    }
+
+    int numJobs = handoverFd == -1 ? jobs.numberJobs : 0;
+    if (handoverFd != -1) {
+        watch_resumed_jobs(&jobs, &reactor);
+    }
     for (int i = 0; i < numJobs; i++) {
-        start_job(jobs.tasks[i], &totalWorkers, false, params.verbose);
+        if (jobs.tasks[i].parked) {
+            number_job(&jobs, &jobs.tasks[i]);
+        } else {
+            start_job(&jobs, &jobs.tasks[i], false, &reactor, 
+                    params.verbose);
+        }
     }
     
     //Setup signal handlers
-    struct sigaction reportStats;
-    setup_sighandler(&reportStats, report_stats, SIGHUP);
     struct sigaction block;
     setup_sighandler(&block, block_signal, SIGINT);
     
-    //deadPipe sigaction is setup seperately as it uses .sa_sigaction
+    //SIGPIPE is caught rather than ignored, as jobs would inherit it being
+    //ignored across their exec
     struct sigaction deadPipe;
-    memset(&deadPipe, 0, sizeof(deadPipe));
-    deadPipe.sa_sigaction = dead_pipe_handler;
-    deadPipe.sa_flags = SA_RESTART | SA_NOCLDSTOP | SA_SIGINFO;
-    sigaction(SIGPIPE, &deadPipe, 0);
+    setup_sighandler(&deadPipe, dead_pipe_handler, SIGPIPE);
 
-    usleep(1000000);
-    operation(&jobs, &params); 
+    operation(&jobs, &params, &reactor, childExitFd, reportFd, 
+            handoverFd == -1 ? NULL : &handover);
     return 0;
 }
 
-void operation(Jobs* jobs, Params* params) {
-    FILE* inputFile = fdopen(params->inputFile, "r");
+void operation(Jobs* jobs, Params* params, Reactor* reactor, 
+        int childExitFd, int reportFd, Handover* handover) {
+    LineBuffer input;
+    init_line_buffer(&input);
+    input.framed = params->framed;
+    bool inputOpen = true;
+    bool outputBacklog = false;
+    bool inputPaused = false;
+    Broadcast broadcast;
+    //Pools, the reader thread and framed records need input split into 
+    //lines, so zero-copy broadcast is not used with them
+    init_broadcast(&broadcast, params->broadcast && !jobs->numPools && 
+            !jobs->engine && !params->framed);
+    long long drainDeadline = 0;
+    TimerWheel wheel;
+    if (!init_timer_wheel(&wheel)) {
+        perror("timerfd_create");
+        exit(EXIT_FAILURE);
+    }
+    reactor_watch(reactor, wheel.timerFd, WATCH_RESTART_TIMER, 0, EPOLLIN);
+    
+    //Regular files cannot be watched by epoll, but reading them never 
+    //blocks, so they are read once per pass instead. In threaded mode what
+    //is watched is the reader thread's eventfd.
+    int inputFd = jobs->engine ? jobs->engine->inputWakeFd : 
+            params->inputFile;
+    bool inputAlwaysReady = !reactor_watch(reactor, inputFd, WATCH_INPUT, 0,
+            EPOLLIN);
+    if (handover) {
+        resume_operation(handover, params, &input, jobs, &wheel, reactor);
+    }
+
+    //Without pidfds, jobs may have exited before the first wait
+    if (childExitFd != -1) {
+        reap_restart_jobs(jobs, &wheel, reactor, inputOpen, params->verbose);
+    }
+    check_viable_workers(jobs, &input, params);
     while(true) {
-        //Reap and report on jobs
-        for (int i = 0; i < jobs->numberJobs; i++) {
-            Job* job = jobs->tasks[i]; 
-            if (!job->runnable) {
-                continue;
+        int timeout = WAIT_FOREVER;
+        if (!inputOpen) {
+            timeout = drainDeadline - now_ms();
+            //Jobs being drained by an I/O thread still have their exit to
+            //report
+            if (timeout <= 0 || (!jobs->numOutputsOpen && 
+                    !jobs->numDraining)) {
+                exit_jobthing(jobs, &input, params);
             }
-            reap_process_job(job, params->verbose);
         }
+        if ((inputOpen && inputAlwaysReady && !input_blocked(jobs)) || 
+                outputBacklog) {
+            timeout = 0;
+        }
+        //Never sleep past the writer's flush deadline, and flush whatever
+        //is pending before blocking so output is not held back while idle
+        int flushTimeout = writer_timeout(&output);
+        if (flushTimeout != NO_DEADLINE && (timeout == WAIT_FOREVER || 
+                flushTimeout < timeout)) {
+            timeout = flushTimeout;
+        }
+        //Nor past when an ordered pool's oldest line is to be skipped
+        int orderTimeout = order_timeout(jobs);
+        if (orderTimeout != NO_DEADLINE && (timeout == WAIT_FOREVER || 
+                orderTimeout < timeout)) {
+            timeout = orderTimeout;
+        }
+        //Nor past the end of a *sleep
+        int sleepTimeout = sleep_timeout(jobs);
+        if (sleepTimeout != NO_DEADLINE && (timeout == WAIT_FOREVER || 
+                sleepTimeout < timeout)) {
+            timeout = sleepTimeout;
+        }
+        //Nor past when a pending *handover is given up on
+        int handoverTimeout = handover_timeout(jobs);
+        if (handoverTimeout != NO_DEADLINE && (timeout == WAIT_FOREVER || 
+                handoverTimeout < timeout)) {
+            timeout = handoverTimeout;
+        }
+        if (timeout != 0) {
+            writer_idle(&output);
+        }
+        int numReady = reactor_wait(reactor, timeout);
+        writer_check_deadline(&output);
 
-        //Restart jobs
-        for (int i = 0; i < jobs->numberJobs; i++) {
-            Job* job = jobs->tasks[i]; 
-            if (!job->restart || !job->runnable) {
-                continue;
+        //Input held back by a *sleep that has run its course is handled 
+        //before any more is read
+        if (jobs->sleepUntilMs && now_ms() >= jobs->sleepUntilMs) {
+            if (!inputOpen) {
+                jobs->sleepUntilMs = 0;
+            } else if (!(inputOpen = end_input_sleep(params, &input, jobs, 
+                    reactor)) && !inputAlwaysReady) {
+                reactor_unwatch(reactor, inputFd);
+            }
+        }
+        if (inputOpen && inputAlwaysReady && !input_blocked(jobs)) {
+            inputOpen = process_input(params, &input, &broadcast, jobs, 
+                    reactor);
+        }
+        for (int i = 0; i < numReady; i++) {
+            struct epoll_event* event = &reactor->events[i];
+            switch (event_kind(event)) {
+                case WATCH_INPUT:
+                    inputOpen = process_input(params, &input, &broadcast, 
+                            jobs, reactor);
+                    if (!inputOpen) {
+                        reactor_unwatch(reactor, inputFd);
+                    }
+                    break;
+                case WATCH_JOB_INPUT:
+                    flush_job_input(jobs, event_index(event), reactor);
+                    break;
+                case WATCH_JOB_OUTPUT:
+                    mark_output_ready(jobs, event_index(event));
+                    break;
+                case WATCH_JOB_EXIT:
+                    reap_restart_job(jobs, &jobs->tasks[event_index(event)], 
+                            &wheel, reactor, inputOpen, params->verbose);
+                    break;
+                case WATCH_CHILD_EXIT:
+                    drain_signalfd(childExitFd);
+                    reap_restart_jobs(jobs, &wheel, reactor, inputOpen, 
+                            params->verbose);
+                    break;
+                case WATCH_RESTART_TIMER:
+                    advance_timer_wheel(&wheel);
+                    restart_due_jobs(jobs, &wheel, reactor, inputOpen, 
+                            params->verbose);
+                    break;
+                case WATCH_REPORT_SIGNAL:
+                    drain_signalfd(reportFd);
+                    report_stats(jobs);
+                    break;
+                case WATCH_METRICS_LISTEN:
+                    accept_metrics_clients(&metricsServer, reactor);
+                    break;
+                case WATCH_METRICS_CLIENT:
+                    handle_metrics_client(&metricsServer, 
+                            event_index(event), jobs, reactor);
+                    break;
+                case WATCH_CONTROL_LISTEN:
+                    accept_control_clients(&controlServer, reactor);
+                    break;
+                case WATCH_CONTROL_CLIENT:
+                    handle_control_client(&controlServer, 
+                            event_index(event), event->events, jobs, 
+                            reactor);
+                    break;
+                case WATCH_SHARD_REPLIES:
+                    handle_shard_replies(jobs, &wheel, reactor, inputOpen, 
+                            params->verbose);
+                    break;
+                default:
+                    break;
             }
-            restart_job(job, params->verbose);
         }
 
-        if (waitpid(-1, NULL, WNOHANG) == -1 && all_jobs_unrunnable(jobs)) { 
-            close_all_runnable_fds(jobs);
-            fclose(inputFile);
-            free_tasks(jobs->numberJobs, jobs->tasks);
-            fprintf(stderr, "No more viable workers, exiting\n");
-            exit(SUCCESSFUL_EXIT);
+        //Replicas woken by this pass's input are started with it queued
+        if (jobs->numWaking) {
+            start_woken_jobs(jobs, &wheel, reactor, params->verbose);
+        }
+
+        //A *reload is carried out between passes, and its rollout moves on
+        //as the jobs it replaces exit
+        if (jobs->reloadPending && inputOpen) {
+            reload_jobs(jobs, params, &wheel, reactor);
+            //Zero-copy broadcast does not know about pools
+            if (broadcast.enabled && jobs->numPools) {
+                free_broadcast(&broadcast);
+            }
+        }
+        if (jobs->numHeld && inputOpen) {
+            advance_rollout(jobs, &wheel, reactor, params->verbose);
+        }
+
+        outputBacklog = relay_ready_outputs(jobs, reactor, params->verbose);
+        release_ordered_pools(jobs, false);
+
+        //Input is paused while a QUEUE_BLOCK job's input queue is full, or
+        //input sleeps
+        if (inputOpen && !inputAlwaysReady && 
+                inputPaused != input_blocked(jobs)) {
+            inputPaused = !inputPaused;
+            reactor_modify(reactor, inputFd, WATCH_INPUT, 0, 
+                    inputPaused ? 0 : EPOLLIN);
+        }
+
+        //On EOF jobs are sent EOF in turn and given a grace period to
+        //finish writing their output before jobthing exits.
+        if (!inputOpen && !drainDeadline) {
+            close_job_inputs(jobs);
+            drainDeadline = now_ms() + DRAIN_TIMEOUT_MS;
+        } else if (inputOpen) {
+            check_viable_workers(jobs, &input, params);
         }
-        if (!read_process_input(params, inputFile, jobs)) {
-            //Continue to top if a command is sent from the input file
+
+        //A *handover execs once nothing it could lose is in flight
+        if (jobs->handoverPending && inputOpen) {
+            check_handover(jobs, params, &input);
+        }
+    }
+}
+
+bool process_input(Params* params, LineBuffer* input, Broadcast* broadcast,
+        Jobs* jobs, Reactor* reactor) {
+    if (broadcast->enabled) {
+        return broadcast_input(broadcast, params, input, jobs, reactor);
+    }
+    if (jobs->engine) {
+        return read_input_chunks(params, input, jobs, reactor);
+    }
+    return read_process_input(params, input, jobs, reactor);
+}
+
+void check_viable_workers(Jobs* jobs, LineBuffer* input, Params* params) {
+    if (!jobs->numRunnable && !jobs->numRunning) { 
+        flush_writer(&output);
+        fprintf(stderr, "No more viable workers, exiting\n");
+        exit_jobthing(jobs, input, params);
+    }
+}
+
+void reap_restart_job(Jobs* jobs, Job* job, TimerWheel* wheel, 
+        Reactor* reactor, bool allowRestart, bool verbose) {
+    if (!job_state(jobs, job->index, JOB_RUNNABLE)) {
+        return;
+    }
+    reap_process_job(jobs, job, reactor, verbose);
+    if (job->restart && job_state(jobs, job->index, JOB_RUNNABLE) && 
+            allowRestart) {
+        schedule_restart(jobs, job, wheel, reactor, verbose);
+    }
+}
+
+void reap_restart_jobs(Jobs* jobs, TimerWheel* wheel, Reactor* reactor, 
+        bool allowRestart, bool verbose) {
+    //Only the jobs that have exited are visited, found by pid
+    pid_t pid;
+    int status;
+    struct rusage usage;
+    while ((pid = wait4(-1, &status, WNOHANG, &usage)) > 0) {
+        int index = pid_map_get(&jobs->pidIndex, pid);
+        if (index == NO_INDEX) {
             continue;
-        } 
-        usleep(1000000);
-        process_job_output(jobs, params->verbose); 
+        }
+        Job* job = &jobs->tasks[index];
+        job_exited(jobs, job, status, &usage, reactor, verbose);
+        if (job->restart && job_state(jobs, index, JOB_RUNNABLE) && 
+                allowRestart) {
+            schedule_restart(jobs, job, wheel, reactor, verbose);
+        }
     }
 }
 
-void dead_pipe_handler(int sig, siginfo_t* info, void* ucontext) {
-    int pid = info->si_pid;
-    int length = sigHandlerJobs->numberJobs;
-    for (int i = 0; i < length; i++) {
-        Job* job = sigHandlerJobs->tasks[i];
-        if (job->pid == pid) {
-            job->killed = true;
+void handle_shard_replies(Jobs* jobs, TimerWheel* wheel, Reactor* reactor, 
+        bool allowRestart, bool verbose) {
+    clear_wakeups(jobs->engine->replyWakeFd);
+    ShardReply reply;
+    while (next_shard_reply(jobs->engine, &reply)) {
+        Job* job = &jobs->tasks[reply.index];
+        if (apply_shard_reply(jobs, &reply, reactor) && job->restart && 
+                job_state(jobs, reply.index, JOB_RUNNABLE) && allowRestart) {
+            schedule_restart(jobs, job, wheel, reactor, verbose);
+        }
+    }
+}
+
+void restart_due_jobs(Jobs* jobs, TimerWheel* wheel, Reactor* reactor, 
+        bool allowRestart, bool verbose) {
+    int index;
+    while ((index = pop_expired_timer(wheel)) != NO_TIMER) {
+        Job* job = &jobs->tasks[index];
+        if (job->restart && job_state(jobs, index, JOB_RUNNABLE) && 
+                allowRestart) {
+            restart_job(jobs, job, reactor, verbose);
+            watch_job_idle(jobs, job, wheel);
+        } else if (allowRestart && job_state(jobs, index, JOB_RUNNING) && 
+                job_retirable(jobs, job)) {
+            //A running job's timer is its idle check
+            check_idle_job(jobs, job, wheel, verbose);
         }
     }
 }
 
-void report_stats(int sig) {
-    int length = sigHandlerJobs->numberJobs;
+void exit_jobthing(Jobs* jobs, LineBuffer* input, Params* params) {
+    //Answers still waiting on unanswered lines are relayed without them
+    release_ordered_pools(jobs, true);
+    close_all_runnable_fds(jobs);
+    close(params->inputFile);
+    free_line_buffer(input);
+    if (jobs->engine) {
+        stop_engine(jobs->engine);
+    }
+    if (jobs->uring) {
+        close_uring(jobs->uring);
+    }
+    free_jobs(jobs);
+    free_writer(&output);
+    free_metrics_server(&metricsServer);
+    free_control_server(&controlServer);
+    exit(SUCCESSFUL_EXIT);
+}
+
+void dead_pipe_handler(int sig) {
+    //Nothing is touched here, as the main loop may be part way through 
+    //changing the jobs
+}
+
+void report_stats(Jobs* jobs) {
+    int length = jobs->numberJobs;
     for (int i = 0; i < length; i++) {
-        Job* job = sigHandlerJobs->tasks[i];
+        Job* job = &jobs->tasks[i];
+        //Released slots are no longer jobs
+        if (job->released) {
+            continue;
+        }
         fprintf(stderr, "%d:%d:%d\n", job->jobNumber, job->startCount, 
                 job->inputReceived);
     }
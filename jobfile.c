@@ -0,0 +1,197 @@
+#include "jobfile.h"
+
+bool load_jobfile(JobFile* jobFile, FILE* file, const JobAttrs* defaults) {
+    int fd = fileno(file);
+    struct stat info;
+    jobFile->data = NULL;
+    jobFile->size = 0;
+    jobFile->mapped = false;
+    jobFile->chunks = NULL;
+    jobFile->numChunks = 0;
+
+    if (fstat(fd, &info) == -1) {
+        return false;
+    }
+    if (S_ISREG(info.st_mode) && info.st_size > 0) {
+        jobFile->data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 
+                0);
+        if (jobFile->data != MAP_FAILED) {
+            jobFile->size = info.st_size;
+            jobFile->mapped = true;
+            madvise(jobFile->data, jobFile->size, MADV_SEQUENTIAL);
+        } else {
+            jobFile->data = NULL;
+        }
+    }
+    if (!jobFile->mapped && !read_jobfile(jobFile, fd)) {
+        return false;
+    }
+
+    //The first chunk is parsed on this thread, as is any chunk whose thread
+    //cannot be created
+    split_jobfile(jobFile, defaults);
+    for (int i = 1; i < jobFile->numChunks; i++) {
+        JobChunk* chunk = &jobFile->chunks[i];
+        chunk->threaded = !pthread_create(&chunk->thread, NULL, 
+                parse_job_chunk, chunk);
+        if (!chunk->threaded) {
+            parse_job_chunk(chunk);
+        }
+    }
+    parse_job_chunk(&jobFile->chunks[0]);
+    for (int i = 1; i < jobFile->numChunks; i++) {
+        if (jobFile->chunks[i].threaded) {
+            pthread_join(jobFile->chunks[i].thread, NULL);
+        }
+    }
+    return true;
+}
+
+bool read_jobfile(JobFile* jobFile, int fd) {
+    size_t capacity = 0;
+    while (true) {
+        if (jobFile->size == capacity) {
+            capacity = capacity ? capacity * 2 : MIN_CHUNK_BYTES;
+            jobFile->data = realloc(jobFile->data, capacity);
+        }
+        ssize_t numRead = read(fd, jobFile->data + jobFile->size, 
+                capacity - jobFile->size);
+        if (numRead == 0) {
+            return true;
+        } else if (numRead == -1 && errno != EINTR) {
+            return false;
+        } else if (numRead > 0) {
+            jobFile->size += numRead;
+        }
+    }
+}
+
+void split_jobfile(JobFile* jobFile, const JobAttrs* defaults) {
+    long numCpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int numChunks = jobFile->size / MIN_CHUNK_BYTES + 1;
+    if (numChunks > numCpus) {
+        numChunks = numCpus > 0 ? numCpus : 1;
+    }
+    if (numChunks > MAX_LOAD_THREADS) {
+        numChunks = MAX_LOAD_THREADS;
+    }
+    jobFile->chunks = malloc(sizeof(JobChunk) * numChunks);
+
+    //Each chunk ends just after the first newline past its share of the 
+    //file, so a long line can leave later chunks empty
+    const char* end = jobFile->data + jobFile->size;
+    const char* start = jobFile->data;
+    for (int i = 0; i < numChunks; i++) {
+        const char* chunkEnd = jobFile->data + 
+                jobFile->size * (i + 1) / numChunks;
+        if (chunkEnd < start) {
+            chunkEnd = start;
+        }
+        if (chunkEnd < end) {
+            const char* newline = memchr(chunkEnd, '\n', end - chunkEnd);
+            chunkEnd = newline ? newline + 1 : end;
+        }
+        JobChunk* chunk = &jobFile->chunks[i];
+        chunk->start = start;
+        chunk->end = chunkEnd;
+        chunk->defaults = defaults;
+        chunk->specs = NULL;
+        chunk->numSpecs = 0;
+        chunk->capacity = 0;
+        chunk->threaded = false;
+        start = chunkEnd;
+    }
+    jobFile->numChunks = numChunks;
+}
+
+void* parse_job_chunk(void* arg) {
+    JobChunk* chunk = arg;
+    const char* line = chunk->start;
+    while (line < chunk->end) {
+        const char* newline = memchr(line, '\n', chunk->end - line);
+        const char* lineEnd = newline ? newline : chunk->end;
+        size_t length = lineEnd - line;
+        if (length && line[0] != JOBFILE_COMMENT) {
+            if (chunk->numSpecs == chunk->capacity) {
+                chunk->capacity = chunk->capacity ? chunk->capacity * 2 : 
+                        INITIAL_SPEC_COUNT;
+                chunk->specs = realloc(chunk->specs, 
+                        sizeof(JobSpec) * chunk->capacity);
+            }
+            JobSpec* spec = &chunk->specs[chunk->numSpecs++];
+            spec->attrs = *chunk->defaults;
+            parse_job_line(line, length, spec);
+        }
+        line = lineEnd + 1;
+    }
+    return NULL;
+}
+
+void parse_job_line(const char* line, size_t length, JobSpec* spec) {
+    //Fields are found by their separators; the command cannot contain one
+    JobField fields[MAX_JOB_FIELDS];
+    int numFields = 0;
+    const char* fieldStart = line;
+    const char* end = line + length;
+    spec->line.start = line;
+    spec->line.length = length;
+    spec->valid = false;
+    for (const char* c = line; c <= end; c++) {
+        if (c == end || *c == JOBFILE_SEPARATOR) {
+            if (numFields == MAX_JOB_FIELDS) {
+                return;
+            }
+            fields[numFields].start = fieldStart;
+            fields[numFields++].length = c - fieldStart;
+            fieldStart = c + 1;
+        }
+    }
+    if (numFields < MAX_JOB_FIELDS - 1) {
+        return;
+    }
+
+    spec->restarts = fields[RESTARTS_FIELD];
+    spec->input = fields[INPUT_FIELD];
+    spec->output = fields[OUTPUT_FIELD];
+    spec->cmd = fields[numFields - 1];
+    spec->attrsField.start = NULL;
+    spec->attrsField.length = 0;
+    if (numFields == MAX_JOB_FIELDS) {
+        spec->attrsField = fields[numFields - 2];
+        if (!parse_spec_attrs(&spec->attrsField, &spec->attrs)) {
+            return;
+        }
+    }
+
+    //A command is correct if it is not empty and doesn't start with a space
+    spec->valid = all_digits(&spec->restarts) && spec->cmd.length && 
+            spec->cmd.start[0] != ' ';
+}
+
+bool parse_spec_attrs(JobField* field, JobAttrs* attrs) {
+    char* copy = strndup(field->start, field->length);
+    bool valid = parse_job_attrs(copy, attrs);
+    free(copy);
+    return valid;
+}
+
+bool all_digits(JobField* field) {
+    for (size_t i = 0; i < field->length; i++) {
+        if (!isdigit(field->start[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void free_jobfile(JobFile* jobFile) {
+    for (int i = 0; i < jobFile->numChunks; i++) {
+        free(jobFile->chunks[i].specs);
+    }
+    free(jobFile->chunks);
+    if (jobFile->mapped) {
+        munmap(jobFile->data, jobFile->size);
+    } else {
+        free(jobFile->data);
+    }
+}
@@ -0,0 +1,161 @@
+#ifndef JOBFILE_H
+#define JOBFILE_H
+
+#include "helper.h"
+#include "attrs.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define JOBFILE_SEPARATOR ':'
+#define JOBFILE_COMMENT '#'
+#define MAX_JOB_FIELDS 5
+#define RESTARTS_FIELD 0
+#define INPUT_FIELD 1
+#define OUTPUT_FIELD 2
+#define MAX_LOAD_THREADS 16
+//Chunks smaller than this are not worth a thread
+#define MIN_CHUNK_BYTES (256 * KIBIBYTE)
+#define INITIAL_SPEC_COUNT 64
+
+//A span of the jobfile, which is not NUL-terminated
+typedef struct {
+    const char* start;
+    size_t length;
+} JobField;
+
+//A parsed jobfile line. Fields point into the jobfile until the job is 
+//made. Invalid lines are kept so they can be reported in order.
+typedef struct {
+    JobField line;
+    JobField restarts;
+    JobField input;
+    JobField output;
+    JobField cmd;
+    JobField attrsField;
+    JobAttrs attrs;
+    bool valid;
+} JobSpec;
+
+//A run of whole lines of the jobfile parsed by one thread
+typedef struct {
+    const char* start;
+    const char* end;
+    const JobAttrs* defaults;
+    JobSpec* specs;
+    int numSpecs;
+    int capacity;
+    pthread_t thread;
+    bool threaded;
+} JobChunk;
+
+//A jobfile mapped into memory and split into chunks that are parsed in 
+//parallel. Files that cannot be mapped, such as pipes, are read into memory
+//instead.
+typedef struct {
+    char* data;
+    size_t size;
+    bool mapped;
+    JobChunk* chunks;
+    int numChunks;
+} JobFile;
+
+#endif //JOBFILE_H
+
+/* load_jobfile()
+ * --------------
+ * Maps or reads a jobfile and parses every line, splitting the file into 
+ * chunks of whole lines that are parsed on separate threads when it is 
+ * large. The chunks and the specs within them are in file order.
+ *
+ * jobFile: the jobfile to be filled in.
+ *
+ * file: the open jobfile.
+ *
+ * defaults: the attributes each job starts with before its attribute field
+ * is applied.
+ *
+ * Returns: true if the file could be read, false otherwise.
+ */
+bool load_jobfile(JobFile* jobFile, FILE* file, const JobAttrs* defaults);
+
+/* read_jobfile()
+ * --------------
+ * Reads the whole of a jobfile that cannot be mapped into memory.
+ *
+ * jobFile: the jobfile whose data is to be read.
+ *
+ * fd: the file descriptor of the jobfile.
+ *
+ * Returns: true if the file was read, false on a read error.
+ */
+bool read_jobfile(JobFile* jobFile, int fd);
+
+/* split_jobfile()
+ * ---------------
+ * Splits the jobfile's data into chunks of roughly equal size that end on
+ * line boundaries.
+ *
+ * jobFile: the jobfile to be split.
+ *
+ * defaults: the default attributes of each job.
+ */
+void split_jobfile(JobFile* jobFile, const JobAttrs* defaults);
+
+/* parse_job_chunk()
+ * -----------------
+ * Parses every line of a chunk. Used as a thread's start routine.
+ *
+ * arg: the JobChunk to be parsed.
+ *
+ * Returns: NULL.
+ */
+void* parse_job_chunk(void* arg);
+
+/* parse_job_line()
+ * ----------------
+ * Parses and validates a jobfile line of the form 
+ * numrestarts:input:output:[attributes:]cmd.
+ *
+ * line: the start of the line.
+ *
+ * length: the length of the line without its newline.
+ *
+ * spec: the spec to be filled in, with its attributes already set to their
+ * defaults.
+ */
+void parse_job_line(const char* line, size_t length, JobSpec* spec);
+
+/* parse_spec_attrs()
+ * ------------------
+ * Parses a job's attribute field from a copy, as parsing modifies it.
+ *
+ * field: the attribute field.
+ *
+ * attrs: the attributes to be filled in.
+ *
+ * Returns: true if the attributes are valid, false otherwise.
+ */
+bool parse_spec_attrs(JobField* field, JobAttrs* attrs);
+
+/* all_digits()
+ * ------------
+ * Returns: true if every character of the field is a digit (including when
+ * it is empty), false otherwise.
+ */
+bool all_digits(JobField* field);
+
+/* free_jobfile()
+ * --------------
+ * Unmaps or frees a jobfile's data and frees its parsed chunks. Strings 
+ * that are still needed must be copied out first.
+ *
+ * jobFile: the jobfile to be freed.
+ */
+void free_jobfile(JobFile* jobFile);
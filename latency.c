@@ -0,0 +1,116 @@
+#include "latency.h"
+
+void init_latency(Latency* latency) {
+    latency->counts = NULL;
+    latency->numSamples = 0;
+    latency->maxUs = 0;
+    latency->pending = NULL;
+    latency->pendingCapacity = 0;
+    latency->pendingHead = 0;
+    latency->numPending = 0;
+    latency->numUnanswered = 0;
+}
+
+void latency_sent(Latency* latency, long long nowUs) {
+    if (latency->numPending == latency->pendingCapacity) {
+        if (latency->pendingCapacity == MAX_PENDING_LINES) {
+            //Give up on the oldest line to make room
+            latency->pendingHead = (latency->pendingHead + 1) %
+                    latency->pendingCapacity;
+            latency->numPending--;
+            latency->numUnanswered++;
+        } else {
+            //Grow the ring, unwrapping it to the start of the new array
+            int capacity = latency->pendingCapacity ?
+                    latency->pendingCapacity * 2 : INITIAL_PENDING_LINES;
+            long long* pending = malloc(sizeof(long long) * capacity);
+            for (int i = 0; i < latency->numPending; i++) {
+                pending[i] = latency->pending[(latency->pendingHead + i) %
+                        latency->pendingCapacity];
+            }
+            free(latency->pending);
+            latency->pending = pending;
+            latency->pendingCapacity = capacity;
+            latency->pendingHead = 0;
+        }
+    }
+    int tail = (latency->pendingHead + latency->numPending) %
+            latency->pendingCapacity;
+    latency->pending[tail] = nowUs;
+    latency->numPending++;
+}
+
+void latency_answered(Latency* latency, long long nowUs) {
+    if (!latency->numPending) {
+        return;
+    }
+    long long sentUs = latency->pending[latency->pendingHead];
+    latency->pendingHead = (latency->pendingHead + 1) %
+            latency->pendingCapacity;
+    latency->numPending--;
+
+    if (!latency->counts) {
+        latency->counts = calloc(LATENCY_BUCKETS, sizeof(unsigned int));
+    }
+    unsigned long long us = nowUs > sentUs ? nowUs - sentUs : 0;
+    latency->counts[latency_bucket(us)]++;
+    latency->numSamples++;
+    if (us > latency->maxUs) {
+        latency->maxUs = us;
+    }
+}
+
+void forget_pending_lines(Latency* latency) {
+    latency->numUnanswered += latency->numPending;
+    latency->pendingHead = 0;
+    latency->numPending = 0;
+}
+
+int latency_bucket(unsigned long long us) {
+    if (us > LATENCY_MAX_US) {
+        us = LATENCY_MAX_US;
+    }
+    if (us < LATENCY_SUB_COUNT) {
+        return us;
+    }
+    //Buckets are LATENCY_SUB_COUNT wide in units of 2^shift, where shift
+    //keeps the top LATENCY_SUB_BITS + 1 bits of the latency
+    int shift = 63 - __builtin_clzll(us) - LATENCY_SUB_BITS;
+    return (shift + 1) * LATENCY_SUB_COUNT + (us >> shift) -
+            LATENCY_SUB_COUNT;
+}
+
+unsigned long long bucket_upper_bound(int bucket) {
+    if (bucket < LATENCY_SUB_COUNT) {
+        return bucket;
+    }
+    int shift = bucket / LATENCY_SUB_COUNT - 1;
+    unsigned long long lower = (unsigned long long) (LATENCY_SUB_COUNT +
+            bucket % LATENCY_SUB_COUNT) << shift;
+    return lower + (1ULL << shift) - 1;
+}
+
+unsigned long long latency_percentile(Latency* latency, double fraction) {
+    if (!latency->numSamples) {
+        return 0;
+    }
+    unsigned long long target = fraction * latency->numSamples;
+    if (target < fraction * latency->numSamples || !target) {
+        target++;
+    }
+    unsigned long long seen = 0;
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += latency->counts[i];
+        if (seen >= target) {
+            unsigned long long upper = bucket_upper_bound(i);
+            return upper < latency->maxUs ? upper : latency->maxUs;
+        }
+    }
+    return latency->maxUs;
+}
+
+void free_latency(Latency* latency) {
+    free(latency->counts);
+    free(latency->pending);
+    init_latency(latency);
+}
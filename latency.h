@@ -0,0 +1,112 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include "helper.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+//Each power of two is split into 2^LATENCY_SUB_BITS linear buckets, so a
+//recorded latency is within about 3% of its true value.
+#define LATENCY_SUB_BITS 5
+#define LATENCY_SUB_COUNT (1 << LATENCY_SUB_BITS)
+//Latencies are capped at about 71 minutes
+#define LATENCY_MAX_US 0xFFFFFFFFULL
+#define LATENCY_BUCKETS ((32 - LATENCY_SUB_BITS + 1) * LATENCY_SUB_COUNT)
+#define INITIAL_PENDING_LINES 64
+//A job that stops answering cannot make jobthing hold every line it is
+//sent. Beyond this, the oldest unanswered lines are given up on.
+#define MAX_PENDING_LINES (64 * 1024)
+
+//Pairs the lines sent to a job with the lines it sends back and records how
+//long each took in a log-bucketed (HDR-style) histogram of microseconds.
+//pending is a ring of the times unanswered lines were sent, oldest at head.
+//Both arrays are only allocated once the job is sent a line, so jobs that
+//never take input cost nothing.
+typedef struct {
+    unsigned int* counts;
+    unsigned long long numSamples;
+    unsigned long long maxUs;
+    long long* pending;
+    int pendingCapacity;
+    int pendingHead;
+    int numPending;
+    unsigned long long numUnanswered;
+} Latency;
+
+#endif //LATENCY_H
+
+/* init_latency()
+ * --------------
+ * Initialises an empty latency histogram.
+ *
+ * latency: the histogram to be initialised.
+ */
+void init_latency(Latency* latency);
+
+/* latency_sent()
+ * --------------
+ * Records that a line was sent to the job.
+ *
+ * latency: the job's histogram.
+ *
+ * nowUs: the time the line was sent, in microseconds.
+ */
+void latency_sent(Latency* latency, long long nowUs);
+
+/* latency_answered()
+ * ------------------
+ * Pairs a line sent back by the job with the oldest line it has not yet
+ * answered and records the time between them. Lines sent back when none are
+ * waiting (e.g., a job that prints a banner) are ignored.
+ *
+ * latency: the job's histogram.
+ *
+ * nowUs: the time the line was read back, in microseconds.
+ */
+void latency_answered(Latency* latency, long long nowUs);
+
+/* forget_pending_lines()
+ * ----------------------
+ * Forgets the lines the job has not answered, e.g., because it has exited.
+ *
+ * latency: the job's histogram.
+ */
+void forget_pending_lines(Latency* latency);
+
+/* latency_bucket()
+ * ----------------
+ * Finds the histogram bucket a latency is counted in.
+ *
+ * us: the latency in microseconds.
+ *
+ * Returns: the index of the bucket.
+ */
+int latency_bucket(unsigned long long us);
+
+/* bucket_upper_bound()
+ * --------------------
+ * Returns: the highest latency, in microseconds, counted in a bucket.
+ */
+unsigned long long bucket_upper_bound(int bucket);
+
+/* latency_percentile()
+ * --------------------
+ * Finds the latency that the given fraction of samples were no slower than.
+ *
+ * latency: the job's histogram.
+ *
+ * fraction: the fraction of samples, e.g., 0.99 for the 99th percentile.
+ *
+ * Returns: the latency in microseconds, or 0 if nothing has been recorded.
+ */
+unsigned long long latency_percentile(Latency* latency, double fraction);
+
+/* free_latency()
+ * --------------
+ * Frees the memory associated with a latency histogram.
+ *
+ * latency: the histogram to be freed.
+ */
+void free_latency(Latency* latency);
@@ -0,0 +1,155 @@
+#include "linebuf.h"
+
+void init_line_buffer(LineBuffer* buffer) {
+    buffer->data = NULL;
+    buffer->start = 0;
+    buffer->end = 0;
+    buffer->capacity = 0;
+    buffer->eof = false;
+    buffer->framed = false;
+}
+
+void reserve_line_buffer(LineBuffer* buffer, size_t extra) {
+    //Slide unread data to the front before growing, as consumed lines leave
+    //free space behind them.
+    if (buffer->start > 0) {
+        memmove(buffer->data, buffer->data + buffer->start, 
+                buffer->end - buffer->start);
+        buffer->end -= buffer->start;
+        buffer->start = 0;
+    }
+    //One byte is always kept spare for the terminator of a trailing line
+    while (buffer->capacity < buffer->end + extra + 1) {
+        buffer->capacity = buffer->capacity ? buffer->capacity * 2 : 
+                INITIAL_LINE_BUFFER;
+        buffer->data = realloc(buffer->data, buffer->capacity);
+    }
+}
+
+void reserve_next_read(LineBuffer* buffer) {
+    size_t available = buffer->end - buffer->start;
+    size_t wanted = 1;
+    if (buffer->framed && available >= FRAME_HEADER_LENGTH) {
+        size_t recordLength = FRAME_HEADER_LENGTH + 
+                get_frame_length(buffer->data + buffer->start);
+        if (recordLength > available) {
+            wanted = recordLength - available;
+        }
+        if (wanted > FRAME_RESERVE_LIMIT) {
+            wanted = FRAME_RESERVE_LIMIT;
+        }
+    }
+    reserve_line_buffer(buffer, wanted);
+}
+
+ssize_t fill_line_buffer(LineBuffer* buffer, int fd) {
+    reserve_next_read(buffer);
+
+    ssize_t numRead = read(fd, buffer->data + buffer->end, 
+            buffer->capacity - buffer->end - 1);
+    if (numRead > 0) {
+        buffer->end += numRead;
+    } else if (numRead == 0) {
+        buffer->eof = true;
+    }
+    return numRead;
+}
+
+void append_line_buffer(LineBuffer* buffer, const char* bytes, 
+        size_t length) {
+    reserve_line_buffer(buffer, length);
+    memcpy(buffer->data + buffer->end, bytes, length);
+    buffer->end += length;
+}
+
+char* next_line(LineBuffer* buffer, size_t* length) {
+    if (buffer->start == buffer->end) {
+        return NULL;
+    }
+    char* line = buffer->data + buffer->start;
+    size_t available = buffer->end - buffer->start;
+    if (buffer->framed) {
+        if (available < FRAME_HEADER_LENGTH || available - 
+                FRAME_HEADER_LENGTH < get_frame_length(line)) {
+            return NULL;
+        }
+        *length = get_frame_length(line);
+        buffer->start += FRAME_HEADER_LENGTH + *length;
+        return line + FRAME_HEADER_LENGTH;
+    }
+    char* newline = memchr(line, '\n', available);
+    
+    if (newline) {
+        *length = newline - line;
+        buffer->start += *length + 1;
+    } else if (buffer->eof) {
+        //Matches read_line() which returns a final unterminated line
+        *length = available;
+        buffer->start = buffer->end;
+    } else {
+        return NULL;
+    }
+    line[*length] = '\0';
+    return line;
+}
+
+bool has_buffered_line(LineBuffer* buffer) {
+    char* line = buffer->data + buffer->start;
+    size_t available = buffer->end - buffer->start;
+    if (buffer->framed) {
+        return available >= FRAME_HEADER_LENGTH && available - 
+                FRAME_HEADER_LENGTH >= get_frame_length(line);
+    }
+    return available && memchr(line, '\n', available);
+}
+
+int count_buffered_lines(LineBuffer* buffer) {
+    int numLines = 0;
+    char* at = buffer->data + buffer->start;
+    char* end = buffer->data + buffer->end;
+    if (buffer->framed) {
+        whole_records_end(buffer, &numLines);
+        return numLines;
+    }
+    char* newline;
+    while (at < end && (newline = memchr(at, '\n', end - at))) {
+        numLines++;
+        at = newline + 1;
+    }
+    return numLines + (at < end && buffer->eof);
+}
+
+void end_partial_line(LineBuffer* buffer) {
+    if (!buffer->framed) {
+        if (buffer->end > buffer->start && 
+                buffer->data[buffer->end - 1] != '\n') {
+            append_line_buffer(buffer, "\n", 1);
+        }
+        return;
+    }
+    int numRecords;
+    buffer->end = whole_records_end(buffer, &numRecords) - buffer->data;
+}
+
+char* whole_records_end(LineBuffer* buffer, int* numRecords) {
+    char* at = buffer->data + buffer->start;
+    char* end = buffer->data + buffer->end;
+    *numRecords = 0;
+    while (end - at >= FRAME_HEADER_LENGTH && end - at - 
+            FRAME_HEADER_LENGTH >= get_frame_length(at)) {
+        at += FRAME_HEADER_LENGTH + get_frame_length(at);
+        (*numRecords)++;
+    }
+    return at;
+}
+
+void reset_line_buffer(LineBuffer* buffer) {
+    buffer->start = 0;
+    buffer->end = 0;
+    buffer->eof = false;
+}
+
+void free_line_buffer(LineBuffer* buffer) {
+    free(buffer->data);
+    init_line_buffer(buffer);
+}
@@ -0,0 +1,157 @@
+#ifndef LINEBUF_H
+#define LINEBUF_H
+
+#include "frame.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/types.h>
+
+#define INITIAL_LINE_BUFFER 4096
+
+//Accumulates bytes read from a file descriptor and hands them back one
+//complete line at a time. Partial lines are kept until the rest arrives.
+//A framed buffer hands back length-prefixed records instead of lines.
+typedef struct {
+    char* data;
+    size_t start;
+    size_t end;
+    size_t capacity;
+    bool eof;
+    bool framed;
+} LineBuffer;
+
+#endif //LINEBUF_H
+
+/* init_line_buffer()
+ * ------------------
+ * Initialises an empty line buffer.
+ *
+ * buffer: the line buffer to be initialised.
+ */
+void init_line_buffer(LineBuffer* buffer);
+
+/* reserve_line_buffer()
+ * ---------------------
+ * Makes room for at least extra more bytes, plus a spare byte for a 
+ * terminator, moving unread data to the front of the buffer first.
+ *
+ * buffer: the line buffer to make room in.
+ *
+ * extra: the number of bytes that are about to be added.
+ */
+void reserve_line_buffer(LineBuffer* buffer, size_t extra);
+
+/* reserve_next_read()
+ * -------------------
+ * Makes room for the next read into the buffer. A framed buffer holding the
+ * header of an incomplete record makes room for the rest of the record, up
+ * to FRAME_RESERVE_LIMIT bytes, so that it is read in as few reads as can 
+ * be.
+ *
+ * buffer: the line buffer that is about to be read into.
+ */
+void reserve_next_read(LineBuffer* buffer);
+
+/* fill_line_buffer()
+ * ------------------
+ * Performs a single read() from fd into the free space of the buffer, growing
+ * the buffer if it is full of an incomplete line.
+ *
+ * buffer: the line buffer to read into.
+ *
+ * fd: the file descriptor to read from.
+ *
+ * Returns: the number of bytes read, 0 on end of file or -1 on error (with
+ * errno set). EOF is also recorded in the buffer.
+ */
+ssize_t fill_line_buffer(LineBuffer* buffer, int fd);
+
+/* append_line_buffer()
+ * --------------------
+ * Adds bytes that have already been read to the end of the buffer.
+ *
+ * buffer: the line buffer to add the bytes to.
+ *
+ * bytes: the bytes to be added.
+ *
+ * length: the number of bytes.
+ */
+void append_line_buffer(LineBuffer* buffer, const char* bytes, size_t length);
+
+/* next_line()
+ * -----------
+ * Removes the next complete line from the buffer. The newline is replaced by
+ * a null terminator so the result can be used as a string. Once end of file
+ * has been seen, a trailing line without a newline is also returned. A 
+ * framed buffer returns the data of its next complete record, which is not
+ * terminated, and never returns a record cut short by end of file.
+ *
+ * buffer: the line buffer to take the line from.
+ *
+ * length: set to the length of the line, excluding the terminator.
+ *
+ * Returns: a pointer to the line inside the buffer, valid until the next
+ * fill_line_buffer() call, or NULL if no complete line is buffered.
+ */
+char* next_line(LineBuffer* buffer, size_t* length);
+
+/* has_buffered_line()
+ * -------------------
+ * Returns: true if next_line() would find a complete line (or record) in 
+ * the buffer without reading more, apart from a trailing line at end of 
+ * file.
+ */
+bool has_buffered_line(LineBuffer* buffer);
+
+/* count_buffered_lines()
+ * ----------------------
+ * Counts the complete lines in the buffer, which next_line() would return.
+ *
+ * buffer: the line buffer whose lines are counted.
+ *
+ * Returns: the number of complete lines.
+ */
+int count_buffered_lines(LineBuffer* buffer);
+
+/* end_partial_line()
+ * ------------------
+ * Deals with an incomplete line left at end of file, so that the buffer 
+ * can go on to be filled from another file descriptor: a line is given its
+ * newline, while an incomplete record is discarded.
+ *
+ * buffer: the line buffer, which has seen end of file.
+ */
+void end_partial_line(LineBuffer* buffer);
+
+/* whole_records_end()
+ * -------------------
+ * Walks the complete records at the start of a framed buffer.
+ *
+ * buffer: the framed line buffer.
+ *
+ * numRecords: set to the number of complete records.
+ *
+ * Returns: a pointer just past the last complete record.
+ */
+char* whole_records_end(LineBuffer* buffer, int* numRecords);
+
+/* reset_line_buffer()
+ * -------------------
+ * Discards any buffered data and clears the end of file marker so the buffer
+ * can be reused for a new file descriptor.
+ *
+ * buffer: the line buffer to be reset.
+ */
+void reset_line_buffer(LineBuffer* buffer);
+
+/* free_line_buffer()
+ * ------------------
+ * Frees the memory associated with a line buffer.
+ *
+ * buffer: the line buffer to be freed.
+ */
+void free_line_buffer(LineBuffer* buffer);
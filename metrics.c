@@ -0,0 +1,338 @@
+#include "metrics.h"
+
+const Metric metrics[NUM_METRICS] = {
+    {"jobthing_job_up", "gauge", "Whether the job is running."},
+    {"jobthing_job_uptime_seconds", "gauge",
+            "Time since the job was last started, while it is running."},
+    {"jobthing_job_starts_total", "counter", "Times the job was started."},
+    {"jobthing_job_restarts_total", "counter",
+            "Times the job was restarted."},
+    {"jobthing_job_last_exit_code", "gauge",
+            "Exit code of the job's last process, if it exited."},
+    {"jobthing_job_last_exit_signal", "gauge",
+            "Signal that terminated the job's last process, if any."},
+    {"jobthing_job_input_lines_total", "counter",
+            "Lines of input sent to the job."},
+    {"jobthing_job_input_bytes_total", "counter",
+            "Bytes of input sent to the job."},
+    {"jobthing_job_output_lines_total", "counter",
+            "Lines of output read from the job."},
+    {"jobthing_job_output_bytes_total", "counter",
+            "Bytes of output read from the job."},
+    {"jobthing_job_queue_bytes", "gauge",
+            "Input queued for the job, in memory or spilled to disk."},
+    {"jobthing_job_queue_dropped_total", "counter",
+            "Lines of input dropped because the job's queue was full."},
+    {"jobthing_job_in_flight_lines", "gauge",
+            "Lines sent to the job's process that it has not answered."},
+    {"jobthing_job_cpu_user_seconds_total", "counter",
+            "User CPU time used by the job's exited processes."},
+    {"jobthing_job_cpu_system_seconds_total", "counter",
+            "System CPU time used by the job's exited processes."},
+    {"jobthing_job_max_rss_bytes", "gauge",
+            "Largest peak resident set size of the job's exited processes."},
+    {"jobthing_job_major_page_faults_total", "counter",
+            "Page faults of the job's exited processes that needed I/O."},
+    {"jobthing_job_voluntary_context_switches_total", "counter",
+            "Times the job's exited processes gave up the CPU to wait."},
+    {"jobthing_job_involuntary_context_switches_total", "counter",
+            "Times the job's exited processes were preempted."},
+    {"jobthing_job_read_bytes_total", "counter",
+            "Bytes the job's exited processes read from storage."},
+    {"jobthing_job_write_bytes_total", "counter",
+            "Bytes the job's exited processes wrote to storage."},
+    {"jobthing_jobs_runnable", "gauge", "Jobs that can still be run."},
+    {"jobthing_jobs_running", "gauge", "Jobs that are running."},
+    {"jobthing_stdout_bytes_total", "counter",
+            "Bytes written to standard output."},
+    {"jobthing_stdout_writes_total", "counter",
+            "write() calls made to standard output."},
+    {"jobthing_metrics_scrapes_total", "counter",
+            "Requests made to the metrics socket."}
+};
+
+bool init_metrics_server(MetricsServer* server, char* path) {
+    server->listenFd = -1;
+    server->path = path;
+    server->numScrapes = 0;
+    for (int i = 0; i < MAX_METRICS_CLIENTS; i++) {
+        server->clients[i].fd = -1;
+    }
+    if (!path) {
+        return true;
+    }
+
+    server->listenFd = listen_unix_socket(path, MAX_METRICS_CLIENTS);
+    if (server->listenFd == -1) {
+        server->path = NULL;
+        return false;
+    }
+    return true;
+}
+
+void watch_metrics_server(MetricsServer* server, Reactor* reactor) {
+    if (server->listenFd != -1) {
+        reactor_watch(reactor, server->listenFd, WATCH_METRICS_LISTEN, 0,
+                EPOLLIN);
+    }
+}
+
+void accept_metrics_clients(MetricsServer* server, Reactor* reactor) {
+    int fd;
+    while ((fd = accept4(server->listenFd, NULL, NULL,
+            SOCK_NONBLOCK | SOCK_CLOEXEC)) != -1) {
+        int index = 0;
+        while (index < MAX_METRICS_CLIENTS &&
+                server->clients[index].fd != -1) {
+            index++;
+        }
+        if (index == MAX_METRICS_CLIENTS) {
+            close(fd);
+            continue;
+        }
+
+        MetricsClient* client = &server->clients[index];
+        client->fd = fd;
+        client->responding = false;
+        client->http = false;
+        client->requestLength = 0;
+        client->metric = 0;
+        client->job = 0;
+        client->length = 0;
+        client->sent = 0;
+        reactor_watch(reactor, fd, WATCH_METRICS_CLIENT, index, EPOLLIN);
+    }
+}
+
+void handle_metrics_client(MetricsServer* server, int index, Jobs* jobs,
+        Reactor* reactor) {
+    MetricsClient* client = &server->clients[index];
+    if (!client->responding) {
+        int result = read_metrics_request(client);
+        if (result == REQUEST_FAILED) {
+            close_metrics_client(server, index, reactor);
+            return;
+        } else if (result == REQUEST_MORE) {
+            return;
+        }
+        client->responding = true;
+        server->numScrapes++;
+        if (client->http) {
+            client->length = sprintf(client->data, "HTTP/1.0 200 OK\r\n"
+                    "Content-Type: text/plain; version=0.0.4\r\n"
+                    "Connection: close\r\n\r\n");
+        }
+        reactor_modify(reactor, client->fd, WATCH_METRICS_CLIENT, index,
+                EPOLLOUT);
+    }
+
+    for (int i = 0; i < METRICS_BUFFERS_PER_PASS; i++) {
+        if (client->sent == client->length) {
+            client->length = 0;
+            client->sent = 0;
+            if (!render_metrics(server, client, jobs)) {
+                close_metrics_client(server, index, reactor);
+                return;
+            }
+        }
+        //MSG_NOSIGNAL as a scraper going away must not raise SIGPIPE
+        ssize_t numSent = send(client->fd, client->data + client->sent,
+                client->length - client->sent, MSG_NOSIGNAL);
+        if (numSent == -1 && (errno == EAGAIN || errno == EINTR)) {
+            return;
+        } else if (numSent == -1) {
+            close_metrics_client(server, index, reactor);
+            return;
+        }
+        client->sent += numSent;
+    }
+}
+
+int read_metrics_request(MetricsClient* client) {
+    bool eof = false;
+    while (!eof && client->requestLength < METRICS_REQUEST_SIZE - 1) {
+        ssize_t numRead = read(client->fd,
+                client->request + client->requestLength,
+                METRICS_REQUEST_SIZE - 1 - client->requestLength);
+        if (numRead == 0) {
+            eof = true;
+        } else if (numRead == -1 && errno == EINTR) {
+            continue;
+        } else if (numRead == -1 && errno == EAGAIN) {
+            break;
+        } else if (numRead == -1) {
+            return REQUEST_FAILED;
+        } else {
+            client->requestLength += numRead;
+        }
+    }
+    client->request[client->requestLength] = '\0';
+
+    //Anything that cannot be the start of an HTTP GET is answered as is
+    size_t prefixLength = strlen(HTTP_REQUEST);
+    size_t compared = client->requestLength < prefixLength ?
+            client->requestLength : prefixLength;
+    if (strncmp(client->request, HTTP_REQUEST, compared)) {
+        return REQUEST_DONE;
+    }
+    client->http = client->requestLength >= prefixLength;
+    if (eof || strstr(client->request, REQUEST_END) ||
+            client->requestLength == METRICS_REQUEST_SIZE - 1) {
+        return REQUEST_DONE;
+    }
+    return REQUEST_MORE;
+}
+
+bool render_metrics(MetricsServer* server, MetricsClient* client,
+        Jobs* jobs) {
+    if (client->metric == NUM_METRICS) {
+        return false;
+    }
+    while (client->metric < NUM_METRICS &&
+            client->length < METRICS_BUFFER_SIZE - MAX_METRIC_LINE) {
+        const Metric* metric = &metrics[client->metric];
+        char* out = client->data + client->length;
+        size_t space = METRICS_BUFFER_SIZE - client->length;
+        bool perJob = client->metric < NUM_JOB_METRICS;
+        double value;
+
+        //The help and type of a metric come before its first value
+        if (!client->job) {
+            client->length += snprintf(out, space,
+                    "# HELP %s %s\n# TYPE %s %s\n", metric->name,
+                    metric->help, metric->name, metric->type);
+        } else if (client->job > (perJob ? jobs->numberJobs : 1)) {
+            client->metric++;
+            client->job = 0;
+            continue;
+        } else if (perJob && jobs->tasks[client->job - 1].released) {
+            //Released slots are no longer jobs
+        } else if (!metric_value(server, jobs, client->metric,
+                client->job - 1, &value)) {
+            //The job has no value for this metric
+        } else if (perJob) {
+            client->length += snprintf(out, space, "%s{job=\"%d\"} %.15g\n",
+                    metric->name, jobs->tasks[client->job - 1].jobNumber,
+                    value);
+        } else {
+            client->length += snprintf(out, space, "%s %.15g\n",
+                    metric->name, value);
+        }
+        client->job++;
+    }
+    return true;
+}
+
+bool metric_value(MetricsServer* server, Jobs* jobs, MetricId metric,
+        int index, double* value) {
+    Job* job = &jobs->tasks[index];
+    switch (metric) {
+        case METRIC_UP:
+            *value = job_state(jobs, index, JOB_RUNNING);
+            return true;
+        case METRIC_UPTIME:
+            *value = (now_ms() - job->startedMs) / 1000.0;
+            return job_state(jobs, index, JOB_RUNNING);
+        case METRIC_STARTS:
+            *value = job->startCount;
+            return true;
+        case METRIC_RESTARTS:
+            *value = job->startCount > 1 ? job->startCount - 1 : 0;
+            return true;
+        case METRIC_LAST_EXIT_CODE:
+            *value = WEXITSTATUS(job->lastStatus);
+            return job->lastStatus != NO_STATUS &&
+                    WIFEXITED(job->lastStatus);
+        case METRIC_LAST_EXIT_SIGNAL:
+            *value = WTERMSIG(job->lastStatus);
+            return job->lastStatus != NO_STATUS &&
+                    WIFSIGNALED(job->lastStatus);
+        case METRIC_INPUT_LINES:
+            *value = job->inputReceived;
+            return true;
+        case METRIC_INPUT_BYTES:
+            *value = job->inputBytes;
+            return true;
+        case METRIC_OUTPUT_LINES:
+            *value = job->outputLines;
+            return true;
+        case METRIC_OUTPUT_BYTES:
+            *value = job->outputBytes;
+            return true;
+        case METRIC_QUEUE_BYTES:
+            *value = job->inQueue.length + job->inQueue.spillLength;
+            return true;
+        case METRIC_QUEUE_DROPPED:
+            *value = job->inQueue.dropped;
+            return true;
+        case METRIC_IN_FLIGHT:
+            *value = job->inFlight;
+            return true;
+        case METRIC_CPU_USER:
+            *value = job->usage.userUs / (double) US_PER_SECOND;
+            return true;
+        case METRIC_CPU_SYSTEM:
+            *value = job->usage.systemUs / (double) US_PER_SECOND;
+            return true;
+        case METRIC_MAX_RSS:
+            *value = job->usage.maxRssKb * (double) KIBIBYTE;
+            return true;
+        case METRIC_PAGE_FAULTS:
+            *value = job->usage.majorFaults;
+            return true;
+        case METRIC_VOLUNTARY_SWITCHES:
+            *value = job->usage.voluntarySwitches;
+            return true;
+        case METRIC_INVOLUNTARY_SWITCHES:
+            *value = job->usage.involuntarySwitches;
+            return true;
+        case METRIC_READ_BYTES:
+            *value = job->usage.inBlocks * (double) USAGE_BLOCK_SIZE;
+            return true;
+        case METRIC_WRITE_BYTES:
+            *value = job->usage.outBlocks * (double) USAGE_BLOCK_SIZE;
+            return true;
+        case METRIC_JOBS_RUNNABLE:
+            *value = jobs->numRunnable;
+            return true;
+        case METRIC_JOBS_RUNNING:
+            *value = jobs->numRunning;
+            return true;
+        case METRIC_STDOUT_BYTES:
+            //In threaded mode the writer thread does the writing
+            *value = jobs->engine ? engine_bytes_written(jobs->engine) :
+                    output.bytesWritten;
+            return true;
+        case METRIC_STDOUT_WRITES:
+            *value = jobs->engine ? engine_num_writes(jobs->engine) :
+                    output.numWrites;
+            return true;
+        case METRIC_SCRAPES:
+            *value = server->numScrapes;
+            return true;
+        default:
+            return false;
+    }
+}
+
+void close_metrics_client(MetricsServer* server, int index,
+        Reactor* reactor) {
+    MetricsClient* client = &server->clients[index];
+    reactor_unwatch(reactor, client->fd);
+    close(client->fd);
+    client->fd = -1;
+}
+
+void free_metrics_server(MetricsServer* server) {
+    for (int i = 0; i < MAX_METRICS_CLIENTS; i++) {
+        if (server->clients[i].fd != -1) {
+            close(server->clients[i].fd);
+            server->clients[i].fd = -1;
+        }
+    }
+    if (server->listenFd != -1) {
+        close(server->listenFd);
+        unlink(server->path);
+        server->listenFd = -1;
+    }
+}
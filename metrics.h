@@ -0,0 +1,226 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "job.h"
+#include "reactor.h"
+#include "writer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#define MAX_METRICS_CLIENTS 16
+#define METRICS_BUFFER_SIZE (16 * 1024)
+//Room left in the buffer for one more rendered line before it is sent
+#define MAX_METRIC_LINE 256
+//How many buffers are sent to a client per pass of the event loop, so that
+//scraping many jobs never holds up relaying input and output for long.
+#define METRICS_BUFFERS_PER_PASS 4
+#define METRICS_REQUEST_SIZE 1024
+#define REQUEST_END "\r\n\r\n"
+#define HTTP_REQUEST "GET "
+#define REQUEST_MORE 0
+#define REQUEST_DONE 1
+#define REQUEST_FAILED -1
+
+//A connection to the metrics socket. A client first sends a request, which
+//is either an HTTP GET, answered with an HTTP response, or anything else
+//(or nothing, by shutting down its end), answered with just the metrics.
+//The metrics are rendered a buffer at a time as the client reads them, with
+//metric and job as the position reached, so the response never has to be
+//held in full.
+typedef struct {
+    int fd;
+    bool responding;
+    bool http;
+    char request[METRICS_REQUEST_SIZE];
+    size_t requestLength;
+    int metric;
+    int job;
+    char data[METRICS_BUFFER_SIZE];
+    size_t length;
+    size_t sent;
+} MetricsClient;
+
+//Serves the jobs' counters in Prometheus text format on a Unix-domain
+//socket that the reactor watches alongside everything else.
+typedef struct {
+    int listenFd;
+    char* path;
+    MetricsClient clients[MAX_METRICS_CLIENTS];
+    unsigned long long numScrapes;
+} MetricsServer;
+
+//The exported metrics, in the order they are rendered. Those up to 
+//NUM_JOB_METRICS have a value for each job, the rest one for jobthing.
+typedef enum {
+    METRIC_UP,
+    METRIC_UPTIME,
+    METRIC_STARTS,
+    METRIC_RESTARTS,
+    METRIC_LAST_EXIT_CODE,
+    METRIC_LAST_EXIT_SIGNAL,
+    METRIC_INPUT_LINES,
+    METRIC_INPUT_BYTES,
+    METRIC_OUTPUT_LINES,
+    METRIC_OUTPUT_BYTES,
+    METRIC_QUEUE_BYTES,
+    METRIC_QUEUE_DROPPED,
+    METRIC_IN_FLIGHT,
+    METRIC_CPU_USER,
+    METRIC_CPU_SYSTEM,
+    METRIC_MAX_RSS,
+    METRIC_PAGE_FAULTS,
+    METRIC_VOLUNTARY_SWITCHES,
+    METRIC_INVOLUNTARY_SWITCHES,
+    METRIC_READ_BYTES,
+    METRIC_WRITE_BYTES,
+    NUM_JOB_METRICS,
+    METRIC_JOBS_RUNNABLE = NUM_JOB_METRICS,
+    METRIC_JOBS_RUNNING,
+    METRIC_STDOUT_BYTES,
+    METRIC_STDOUT_WRITES,
+    METRIC_SCRAPES,
+    NUM_METRICS
+} MetricId;
+
+//The name, Prometheus type and help text of a metric
+typedef struct {
+    const char* name;
+    const char* type;
+    const char* help;
+} Metric;
+
+//The name, type and help text of every metric, indexed by MetricId
+extern const Metric metrics[NUM_METRICS];
+
+#endif //METRICS_H
+
+/* init_metrics_server()
+ * ---------------------
+ * Creates the metrics socket at the given path, replacing a stale socket
+ * left there by an earlier run, and starts listening on it.
+ *
+ * server: the metrics server to be initialised.
+ *
+ * path: the path of the socket, or NULL if metrics are not served.
+ *
+ * Returns: true if the socket is listening or no path was given, false
+ * otherwise.
+ */
+bool init_metrics_server(MetricsServer* server, char* path);
+
+/* watch_metrics_server()
+ * ----------------------
+ * Adds the metrics socket to the reactor, if metrics are being served.
+ *
+ * server: the metrics server.
+ *
+ * reactor: the reactor to watch the socket with.
+ */
+void watch_metrics_server(MetricsServer* server, Reactor* reactor);
+
+/* accept_metrics_clients()
+ * ------------------------
+ * Accepts every pending connection to the metrics socket. Connections
+ * beyond MAX_METRICS_CLIENTS are closed straight away.
+ *
+ * server: the metrics server whose socket is ready.
+ *
+ * reactor: the reactor the clients are watched with.
+ */
+void accept_metrics_clients(MetricsServer* server, Reactor* reactor);
+
+/* handle_metrics_client()
+ * -----------------------
+ * Reads a client's request or, once it has been read, sends the client up
+ * to METRICS_BUFFERS_PER_PASS buffers of metrics. The client is closed once
+ * every metric has been sent or if it goes away.
+ *
+ * server: the metrics server.
+ *
+ * index: the client's slot in the server.
+ *
+ * jobs: the jobs whose metrics are served.
+ *
+ * reactor: the reactor the client is watched with.
+ */
+void handle_metrics_client(MetricsServer* server, int index, Jobs* jobs,
+        Reactor* reactor);
+
+/* read_metrics_request()
+ * ----------------------
+ * Reads what the client has sent so far.
+ *
+ * client: the client to read from.
+ *
+ * Returns: REQUEST_DONE once the whole request has been read, the client 
+ * has shut down its end or the request is not HTTP, REQUEST_MORE if more is
+ * to come.
+ * Errors: returns REQUEST_FAILED if the client has gone away.
+ */
+int read_metrics_request(MetricsClient* client);
+
+/* render_metrics()
+ * ----------------
+ * Renders metrics into the client's buffer, from where the last call left
+ * off, until the buffer is nearly full.
+ *
+ * server: the metrics server.
+ *
+ * client: the client the metrics are for.
+ *
+ * jobs: the jobs whose metrics are rendered.
+ *
+ * Returns: false if every metric has already been rendered, true otherwise.
+ */
+bool render_metrics(MetricsServer* server, MetricsClient* client,
+        Jobs* jobs);
+
+/* metric_value()
+ * --------------
+ * Gets the current value of a metric.
+ *
+ * server: the metrics server.
+ *
+ * jobs: the jobs whose metrics are served.
+ *
+ * metric: the metric to get.
+ *
+ * index: the index of the job to get the value for, ignored for metrics 
+ * that are not per job.
+ *
+ * value: set to the metric's value.
+ *
+ * Returns: false if the job has no value for the metric (e.g., the exit 
+ * code of a job that has not exited), true otherwise.
+ */
+bool metric_value(MetricsServer* server, Jobs* jobs, MetricId metric, 
+        int index, double* value);
+
+/* close_metrics_client()
+ * ----------------------
+ * Closes a client's connection and frees its slot.
+ *
+ * server: the metrics server.
+ *
+ * index: the client's slot in the server.
+ *
+ * reactor: the reactor the client is watched with.
+ */
+void close_metrics_client(MetricsServer* server, int index,
+        Reactor* reactor);
+
+/* free_metrics_server()
+ * ---------------------
+ * Closes the metrics socket and every client, and removes the socket from
+ * the file system.
+ *
+ * server: the metrics server to be freed.
+ */
+void free_metrics_server(MetricsServer* server);
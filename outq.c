@@ -0,0 +1,296 @@
+#include "outq.h"
+
+void reserve_queue_space(OutQueue* queue, size_t extra) {
+    if (queue->length + extra <= queue->capacity) {
+        return;
+    }
+    size_t capacity = queue->capacity ? queue->capacity : INITIAL_QUEUE_SIZE;
+    while (capacity < queue->length + extra) {
+        capacity *= 2;
+    }
+    char* data = malloc(capacity);
+    size_t first = queue->capacity - queue->head;
+    if (first > queue->length) {
+        first = queue->length;
+    }
+    if (queue->length) {
+        memcpy(data, queue->data + queue->head, first);
+        memcpy(data + first, queue->data, queue->length - first);
+    }
+    free(queue->data);
+    queue->data = data;
+    queue->capacity = capacity;
+    queue->head = 0;
+}
+
+void queue_write(OutQueue* queue, const char* bytes, size_t length) {
+    size_t tail = (queue->head + queue->length) % queue->capacity;
+    size_t first = queue->capacity - tail;
+    if (first > length) {
+        first = length;
+    }
+    memcpy(queue->data + tail, bytes, first);
+    memcpy(queue->data, bytes + first, length - first);
+    queue->length += length;
+}
+
+size_t queue_line_end(OutQueue* queue, size_t from) {
+    if (queue->framed) {
+        char header[FRAME_HEADER_LENGTH];
+        for (int i = 0; i < FRAME_HEADER_LENGTH; i++) {
+            header[i] = queue->data[(queue->head + from + i) % 
+                    queue->capacity];
+        }
+        return from + FRAME_HEADER_LENGTH + get_frame_length(header) - 1;
+    }
+    for (size_t i = from; i < queue->length; i++) {
+        if (queue->data[(queue->head + i) % queue->capacity] == '\n') {
+            return i;
+        }
+    }
+    return queue->length;
+}
+
+void advance_head_record(OutQueue* queue, size_t numWritten) {
+    size_t done = 0;
+    while (done < numWritten) {
+        if (!queue->headRecordLeft) {
+            queue->headRecordLeft = queue_line_end(queue, done) + 1 - done;
+        }
+        size_t step = numWritten - done;
+        if (step > queue->headRecordLeft) {
+            step = queue->headRecordLeft;
+        }
+        queue->headRecordLeft -= step;
+        done += step;
+    }
+}
+
+void drop_oldest_lines(OutQueue* queue, size_t needed) {
+    size_t keep = queue->headMidLine ? queue_line_end(queue, 0) + 1 : 0;
+    if (queue->framed) {
+        keep = queue->headRecordLeft;
+    }
+    size_t target = queue->limit / DROP_FRACTION;
+    if (target < needed) {
+        target = needed;
+    }
+
+    size_t dropEnd = keep;
+    while (dropEnd < queue->length && (dropEnd - keep < target || 
+            queue->length - (dropEnd - keep) + needed > queue->limit)) {
+        dropEnd = queue_line_end(queue, dropEnd) + 1;
+        queue->dropped++;
+    }
+    size_t numDropped = dropEnd - keep;
+
+    //Move the kept partial line up against the remaining lines
+    for (size_t i = keep; i > 0; i--) {
+        queue->data[(queue->head + numDropped + i - 1) % queue->capacity] = 
+                queue->data[(queue->head + i - 1) % queue->capacity];
+    }
+    queue->head = (queue->head + numDropped) % queue->capacity;
+    queue->length -= numDropped;
+}
+
+bool spill_bytes(OutQueue* queue, const char* bytes, size_t length, 
+        bool record) {
+    if (!queue->spill && !(queue->spill = tmpfile())) {
+        return false;
+    }
+    fseek(queue->spill, 0, SEEK_END);
+    if (record && queue->framed) {
+        char header[FRAME_HEADER_LENGTH];
+        put_frame_length(header, length);
+        fwrite(header, 1, FRAME_HEADER_LENGTH, queue->spill);
+    }
+    fwrite(bytes, 1, length, queue->spill);
+    if (record && !queue->framed) {
+        fputc('\n', queue->spill);
+    }
+    queue->spillLength += length + (record ? 
+            record_overhead(queue->framed) : 0);
+    return true;
+}
+
+void reload_spill(OutQueue* queue) {
+    if (!queue->spillLength || queue->length >= queue->limit) {
+        return;
+    }
+    size_t amount = queue->limit - queue->length;
+    if (amount > queue->spillLength) {
+        amount = queue->spillLength;
+    }
+    reserve_queue_space(queue, amount);
+    fflush(queue->spill);
+    fseek(queue->spill, queue->spillReadOffset, SEEK_SET);
+
+    size_t tail = (queue->head + queue->length) % queue->capacity;
+    size_t first = queue->capacity - tail;
+    if (first > amount) {
+        first = amount;
+    }
+    size_t numRead = fread(queue->data + tail, 1, first, queue->spill);
+    if (numRead == first && amount > first) {
+        numRead += fread(queue->data, 1, amount - first, queue->spill);
+    }
+    queue->length += numRead;
+    queue->spillLength -= numRead;
+    queue->spillReadOffset += numRead;
+
+    if (!queue->spillLength || !numRead) {
+        //Start the spill file afresh once everything has been read back
+        queue->spillLength = 0;
+        queue->spillReadOffset = 0;
+        ftruncate(fileno(queue->spill), 0);
+    }
+}
+
+void init_out_queue(OutQueue* queue, size_t limit, QueuePolicy policy) {
+    queue->data = NULL;
+    queue->capacity = 0;
+    queue->head = 0;
+    queue->length = 0;
+    queue->limit = limit;
+    queue->policy = policy;
+    queue->headMidLine = false;
+    queue->spill = NULL;
+    queue->spillLength = 0;
+    queue->spillReadOffset = 0;
+    queue->dropped = 0;
+    queue->framed = false;
+    queue->headRecordLeft = 0;
+}
+
+bool enqueue_line(OutQueue* queue, const char* line, size_t length) {
+    return enqueue_bytes(queue, line, length, true);
+}
+
+bool enqueue_bytes(OutQueue* queue, const char* bytes, size_t length, 
+        bool record) {
+    size_t needed = length + (record ? record_overhead(queue->framed) : 0);
+    
+    //Once spilling, every line goes through the spill file to keep order
+    if (queue->spillLength || (queue->policy == QUEUE_SPILL && 
+            queue->length + needed > queue->limit)) {
+        if (spill_bytes(queue, bytes, length, record)) {
+            return true;
+        }
+        queue->dropped++;
+        return false;
+    } 
+    if (queue->policy == QUEUE_DROP_OLDEST && 
+            queue->length + needed > queue->limit) {
+        if (needed > queue->limit) {
+            queue->dropped++;
+            return false;
+        }
+        drop_oldest_lines(queue, needed);
+    }
+
+    reserve_queue_space(queue, needed);
+    if (record && queue->framed) {
+        char header[FRAME_HEADER_LENGTH];
+        put_frame_length(header, length);
+        queue_write(queue, header, FRAME_HEADER_LENGTH);
+    }
+    queue_write(queue, bytes, length);
+    if (record && !queue->framed) {
+        queue_write(queue, "\n", 1);
+    }
+    return true;
+}
+
+FlushResult flush_out_queue(OutQueue* queue, int fd) {
+    struct iovec iov[2];
+    int numVectors;
+    while ((numVectors = out_queue_vectors(queue, iov))) {
+        ssize_t numWritten = writev(fd, iov, numVectors);
+        if (numWritten == -1 && errno == EINTR) {
+            continue;
+        } else if (numWritten == -1) {
+            return out_queue_written(queue, -errno);
+        }
+        out_queue_written(queue, numWritten);
+    }
+    return FLUSH_EMPTY;
+}
+
+int out_queue_vectors(OutQueue* queue, struct iovec iov[2]) {
+    reload_spill(queue);
+    if (!queue->length) {
+        queue->head = 0;
+        return 0;
+    }
+
+    int numVectors = 1;
+    size_t first = queue->capacity - queue->head;
+    if (first > queue->length) {
+        first = queue->length;
+    }
+    iov[0].iov_base = queue->data + queue->head;
+    iov[0].iov_len = first;
+    if (queue->length > first) {
+        iov[1].iov_base = queue->data;
+        iov[1].iov_len = queue->length - first;
+        numVectors++;
+    }
+    return numVectors;
+}
+
+FlushResult out_queue_written(OutQueue* queue, ssize_t result) {
+    if (result == -EAGAIN || result == -EINTR) {
+        return FLUSH_PENDING;
+    } else if (result < 0) {
+        clear_out_queue(queue);
+        return FLUSH_BROKEN;
+    }
+    if (result > 0 && queue->framed) {
+        //Only drop-oldest needs to know where records start, and its ring
+        //never holds part of a record
+        if (queue->policy == QUEUE_DROP_OLDEST) {
+            advance_head_record(queue, result);
+        }
+        queue->headMidLine = queue->headRecordLeft > 0;
+    } else if (result > 0) {
+        queue->headMidLine = queue->data[(queue->head + result - 1) % 
+                queue->capacity] != '\n';
+    }
+    if (result > 0) {
+        queue->head = (queue->head + result) % queue->capacity;
+        queue->length -= result;
+    }
+    return out_queue_empty(queue) ? FLUSH_EMPTY : FLUSH_PENDING;
+}
+
+bool out_queue_empty(OutQueue* queue) {
+    return !queue->length && !queue->spillLength;
+}
+
+bool out_queue_full(OutQueue* queue) {
+    return queue->length >= queue->limit;
+}
+
+size_t out_queue_depth(OutQueue* queue) {
+    return queue->length + queue->spillLength;
+}
+
+void clear_out_queue(OutQueue* queue) {
+    queue->head = 0;
+    queue->length = 0;
+    queue->headMidLine = false;
+    queue->headRecordLeft = 0;
+    if (queue->spill) {
+        ftruncate(fileno(queue->spill), 0);
+    }
+    queue->spillLength = 0;
+    queue->spillReadOffset = 0;
+}
+
+void free_out_queue(OutQueue* queue) {
+    free(queue->data);
+    if (queue->spill) {
+        fclose(queue->spill);
+    }
+    init_out_queue(queue, queue->limit, queue->policy);
+}
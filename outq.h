@@ -0,0 +1,270 @@
+#ifndef OUTQ_H
+#define OUTQ_H
+
+#include "frame.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#define INITIAL_QUEUE_SIZE 4096
+#define DEFAULT_QUEUE_LIMIT (1024 * 1024)
+//Drop-oldest frees at least this fraction of the limit at a time so that a
+//queue that stays full is not compacted for every line.
+#define DROP_FRACTION 8
+
+//What a job's queue does with a line that does not fit within its limit
+typedef enum {
+    QUEUE_BLOCK,
+    QUEUE_DROP_OLDEST,
+    QUEUE_SPILL
+} QueuePolicy;
+
+//Result of writing a queue to its file descriptor
+typedef enum {
+    FLUSH_EMPTY,
+    FLUSH_PENDING,
+    FLUSH_BROKEN
+} FlushResult;
+
+//A bounded queue of lines waiting to be written to a job's input pipe. Lines
+//are stored newline terminated in a ring buffer so that everything queued 
+//can be written with a single writev(). With QUEUE_SPILL, lines that do not
+//fit are appended to a temporary file and read back as the ring drains. A
+//framed queue holds length-prefixed records instead of lines, and for 
+//QUEUE_DROP_OLDEST tracks headRecordLeft, the bytes of the record at the 
+//head still to be written after a write that ended partway through it.
+typedef struct {
+    char* data;
+    size_t capacity;
+    size_t head;
+    size_t length;
+    size_t limit;
+    QueuePolicy policy;
+    bool headMidLine;
+    FILE* spill;
+    size_t spillLength;
+    long spillReadOffset;
+    unsigned long dropped;
+    bool framed;
+    size_t headRecordLeft;
+} OutQueue;
+
+#endif //OUTQ_H
+
+/* reserve_queue_space()
+ * ---------------------
+ * Grows the ring so that at least extra more bytes fit, unwrapping its 
+ * contents to the start of the new buffer.
+ *
+ * queue: the queue to be grown.
+ *
+ * extra: the number of bytes that are about to be added.
+ */
+void reserve_queue_space(OutQueue* queue, size_t extra);
+
+/* queue_write()
+ * -------------
+ * Copies bytes to the tail of the ring, which must already have room.
+ *
+ * queue: the queue to be written to.
+ *
+ * bytes: the bytes to be copied.
+ *
+ * length: the number of bytes to be copied.
+ */
+void queue_write(OutQueue* queue, const char* bytes, size_t length);
+
+/* queue_line_end()
+ * ----------------
+ * Finds the end of the queued line containing the given offset.
+ *
+ * queue: the queue to be searched.
+ *
+ * from: the offset from the head to start searching at, which in a framed
+ * queue is the start of a whole record.
+ *
+ * Returns: the offset from the head of the first newline at or after from,
+ * or the queue length if there is none. In a framed queue, the offset of 
+ * the last byte of the record.
+ */
+size_t queue_line_end(OutQueue* queue, size_t from);
+
+/* advance_head_record()
+ * ---------------------
+ * Keeps track of how much of the record at the head of a framed queue has
+ * been written, ahead of written bytes being removed from the queue.
+ *
+ * queue: the framed queue that was written.
+ *
+ * numWritten: the number of bytes written from the head.
+ */
+void advance_head_record(OutQueue* queue, size_t numWritten);
+
+/* drop_oldest_lines()
+ * -------------------
+ * Drops whole lines from the front of the queue until needed more bytes fit
+ * within the limit. A line that has been partly written is kept so that the
+ * job never receives half a line.
+ *
+ * queue: the queue to drop lines from.
+ *
+ * needed: the number of bytes that are about to be added.
+ */
+void drop_oldest_lines(OutQueue* queue, size_t needed);
+
+/* spill_bytes()
+ * -------------
+ * Appends bytes to the queue's spill file, creating it if needed.
+ *
+ * queue: the queue the bytes belong to.
+ *
+ * bytes: the bytes to be spilled.
+ *
+ * length: the number of bytes.
+ *
+ * record: whether the bytes are a whole line, which is followed by a 
+ * newline, or in a framed queue preceded by its frame header.
+ *
+ * Returns: true if the bytes were spilled, false if no spill file could be 
+ * created.
+ */
+bool spill_bytes(OutQueue* queue, const char* bytes, size_t length, 
+        bool record);
+
+/* reload_spill()
+ * --------------
+ * Moves spilled bytes back into the ring while it is below its limit.
+ *
+ * queue: the queue to be refilled from its spill file.
+ */
+void reload_spill(OutQueue* queue);
+
+/* init_out_queue()
+ * ----------------
+ * Initialises an empty queue. Memory is only allocated once lines are 
+ * queued.
+ *
+ * queue: the queue to be initialised.
+ *
+ * limit: the maximum number of bytes held in memory.
+ *
+ * policy: what to do with lines once the queue is full.
+ */
+void init_out_queue(OutQueue* queue, size_t limit, QueuePolicy policy);
+
+/* enqueue_line()
+ * --------------
+ * Adds a line, followed by a newline, to the end of the queue, or in a 
+ * framed queue a record, preceded by its frame header. A queue with
+ * QUEUE_BLOCK always accepts the line and reports being full through 
+ * out_queue_full() so that the caller can stop producing lines.
+ *
+ * queue: the queue to add the line to.
+ *
+ * line: the line to be queued.
+ *
+ * length: the length of the line.
+ *
+ * Returns: true if the line was queued, false if it was dropped.
+ */
+bool enqueue_line(OutQueue* queue, const char* line, size_t length);
+
+/* enqueue_bytes()
+ * ---------------
+ * Adds bytes to the end of the queue, applying the queue's policy in the 
+ * same way as enqueue_line().
+ *
+ * queue: the queue to add the bytes to.
+ *
+ * bytes: the bytes to be queued.
+ *
+ * length: the number of bytes.
+ *
+ * record: whether the bytes are a whole line, which is followed by a 
+ * newline, or in a framed queue preceded by its frame header.
+ *
+ * Returns: true if the bytes were queued, false if they were dropped.
+ */
+bool enqueue_bytes(OutQueue* queue, const char* bytes, size_t length, 
+        bool record);
+
+/* flush_out_queue()
+ * -----------------
+ * Writes as much of the queue as the file descriptor accepts, coalescing 
+ * every queued line into one writev() call per write.
+ *
+ * queue: the queue to be written.
+ *
+ * fd: the non-blocking file descriptor to write to.
+ *
+ * Returns: FLUSH_EMPTY if everything was written, FLUSH_PENDING if the file
+ * descriptor is full and FLUSH_BROKEN if the reader has gone away (EPIPE), 
+ * in which case the queue is emptied.
+ */
+FlushResult flush_out_queue(OutQueue* queue, int fd);
+
+/* out_queue_vectors()
+ * -------------------
+ * Describes everything in the ring, after reloading what fits from the 
+ * spill file, as the iovecs of one writev().
+ *
+ * queue: the queue to be written.
+ *
+ * iov: set to the queued bytes, in order.
+ *
+ * Returns: the number of iovecs used, 0 if the queue is empty.
+ */
+int out_queue_vectors(OutQueue* queue, struct iovec iov[2]);
+
+/* out_queue_written()
+ * -------------------
+ * Removes what a writev() of out_queue_vectors() wrote from the queue.
+ *
+ * queue: the queue that was written.
+ *
+ * result: the number of bytes written, or a negated errno on failure.
+ *
+ * Returns: FLUSH_EMPTY if the queue is now empty, FLUSH_PENDING if there is
+ * more to write or the write would have blocked and FLUSH_BROKEN if it 
+ * failed otherwise, in which case the queue is emptied.
+ */
+FlushResult out_queue_written(OutQueue* queue, ssize_t result);
+
+/* out_queue_empty()
+ * -----------------
+ * Returns: true if nothing is queued in memory or spilled, false otherwise.
+ */
+bool out_queue_empty(OutQueue* queue);
+
+/* out_queue_full()
+ * ----------------
+ * Returns: true if the queued bytes have reached the queue's limit.
+ */
+bool out_queue_full(OutQueue* queue);
+
+/* out_queue_depth()
+ * -----------------
+ * Returns: the number of bytes queued, including any spilled to file.
+ */
+size_t out_queue_depth(OutQueue* queue);
+
+/* clear_out_queue()
+ * -----------------
+ * Discards everything queued, e.g., because the reader has exited.
+ *
+ * queue: the queue to be cleared.
+ */
+void clear_out_queue(OutQueue* queue);
+
+/* free_out_queue()
+ * ----------------
+ * Frees the memory and spill file associated with a queue.
+ *
+ * queue: the queue to be freed.
+ */
+void free_out_queue(OutQueue* queue);
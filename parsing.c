@@ -1,23 +1,20 @@
 #include "parsing.h"
 
-bool correct_cmd_format(char* line) {
-    //A command is correct if it doesn't start with a space, hence the line[0],
-    //and is not empty.
-    return strcmp(line, "") && line[0] != ' ';
-}
-
-void validate_commands(Params* params, int argc, char** argv) {
+void validate_commands(Params* params, int argc, char** argv, 
+        bool resuming) {
     if (argc < MIN_ARG_COUNT || argc > MAX_ARG_COUNT) {
         format_error(); 
     }
 
-    //Tracks if there has been a -i argument 
+    //Tracks if there has been a -i or -w argument 
     bool isI = false;
+    bool isW = false;
     char* jobFile = NULL;
+    char* inputFile = NULL;
 
     for (int i = 1; i < argc; i++) {
-        if (!strcmp(argv[i - 1], "-i") && !params->inputFile) {
-            params->inputFile = open(argv[i], O_RDONLY);
+        if (!strcmp(argv[i - 1], "-i") && !inputFile) {
+            inputFile = argv[i];
         } else if (!strcmp(argv[i], "-i") && (i != argc - 1) && !isI) {
             //argc -1 as -i cannot be last argument
             isI = true;
@@ -27,6 +24,37 @@ void validate_commands(Params* params, int argc, char** argv) {
                 format_error();
             }
             params->verbose = true;
+        } else if (!strcmp(argv[i], "-b") && !params->broadcast) {
+            params->broadcast = true;
+        } else if (!strcmp(argv[i], "-n") && params->echo) {
+            params->echo = false;
+        } else if (!strcmp(argv[i], "-f") && !params->forkSpawn) {
+            params->forkSpawn = true;
+        } else if (!strcmp(argv[i], "-l") && !params->latency) {
+            params->latency = true;
+        } else if (!strcmp(argv[i], "-u") && !params->uring) {
+            params->uring = true;
+        } else if (!strcmp(argv[i], "-r") && !params->framed) {
+            params->framed = true;
+        } else if (!strcmp(argv[i], "-w") && (i != argc - 1) && !isW) {
+            isW = true;
+            if (!parse_flush_policy(argv[++i], &params->flushPolicy, 
+                    &params->flushSize, &params->flushDeadlineMs)) {
+                format_error();
+            }
+        } else if (!strcmp(argv[i], "-m") && (i != argc - 1) && 
+                !params->metricsSocket) {
+            params->metricsSocket = argv[++i];
+        } else if (!strcmp(argv[i], "-c") && (i != argc - 1) && 
+                !params->controlSocket) {
+            params->controlSocket = argv[++i];
+        } else if (!strcmp(argv[i], "-t") && (i != argc - 1) && 
+                !params->numThreads) {
+            if (!is_non_neg_int(argv[++i]) || !atoi(argv[i]) || 
+                    atoi(argv[i]) > MAX_IO_THREADS) {
+                format_error();
+            }
+            params->numThreads = atoi(argv[i]);
         } else if (!jobFile && (strlen(argv[i]) == 1 ||
                 strncmp(argv[i], "-", 1))) {
             //Will identify anything that begins with a '-' as a command, but 
@@ -40,7 +68,17 @@ void validate_commands(Params* params, int argc, char** argv) {
     if (!jobFile) {
         format_error();
     }
-    if (params->inputFile < 0) {
+    params->jobFileName = jobFile;
+    params->argv = argv;
+    //Found now, as a binary replaced while running no longer has its path
+    params->selfPath = realpath(SELF_PATH, NULL);
+    //A handover passes on the jobs and the open input, and the files may 
+    //have been moved or changed since they were opened
+    if (resuming) {
+        return;
+    }
+
+    if (inputFile && (params->inputFile = open(inputFile, O_RDONLY)) < 0) {
         fprintf(stderr, "Error: Unable to read input file\n");
         exit(INVALID_INPUTFILE_EXIT);
     } 
@@ -51,12 +89,30 @@ void validate_commands(Params* params, int argc, char** argv) {
 }
 
 void format_error() {
-    fprintf(stderr, "Usage: jobthing [-v] [-i inputfile] jobfile\n");
+    fprintf(stderr, 
+            "Usage: jobthing [-v] [-b] [-n] [-f] [-l] [-u] [-r] "
+            "[-w flushpolicy] [-m metricsocket] [-c controlsocket] "
+            "[-t threads] [-i inputfile] jobfile\n");
     exit(FORMAT_ERROR_EXIT);
 }
 
 void init_params(Params* params) {
     params->jobFile = NULL;
+    params->jobFileName = NULL;
+    params->argv = NULL;
+    params->selfPath = NULL;
     params->inputFile = STDIN_FILENO;
     params->verbose = false;
+    params->broadcast = false;
+    params->echo = true;
+    params->forkSpawn = false;
+    params->latency = false;
+    params->flushPolicy = FLUSH_ON_IDLE;
+    params->flushSize = 0;
+    params->flushDeadlineMs = DEFAULT_FLUSH_DEADLINE_MS;
+    params->metricsSocket = NULL;
+    params->controlSocket = NULL;
+    params->numThreads = 0;
+    params->uring = false;
+    params->framed = false;
 }
@@ -1,6 +1,7 @@
 #ifndef PARSING_H
 #define PARSING_H
 #include "helper.h"
+#include "writer.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -12,15 +13,39 @@
 #define INVALID_INPUTFILE_EXIT 3
 #define INVALID_JOBFILE_EXIT 2
 #define FORMAT_ERROR_EXIT 1
+#define INVALID_METRICS_EXIT 4
+#define INVALID_CONTROL_EXIT 5
 #define MIN_ARG_COUNT 2
-#define MAX_ARG_COUNT 5
+#define MAX_ARG_COUNT 19
+#define MAX_IO_THREADS 64
+#define SELF_PATH "/proc/self/exe"
 
 //Contains all the jobThing parameter information specified by
-//the command line arguments
+//the command line arguments. numThreads is the number of I/O threads, or 0
+//to do everything on the main thread. uring is whether job pipe I/O is 
+//batched on an io_uring. framed is whether input, job pipes and output 
+//carry length-prefixed records instead of lines. jobFileName is the path
+//the jobfile was opened from, which *reload reads it from again. argv and 
+//selfPath, the path of jobthing's own binary, are what *handover execs.
 typedef struct {
     FILE* jobFile;
+    char* jobFileName;
+    char** argv;
+    char* selfPath;
     int inputFile;
     bool verbose;
+    bool broadcast;
+    bool echo;
+    bool forkSpawn;
+    bool latency;
+    FlushPolicy flushPolicy;
+    size_t flushSize;
+    long long flushDeadlineMs;
+    char* metricsSocket;
+    char* controlSocket;
+    int numThreads;
+    bool uring;
+    bool framed;
 } Params;
 
 #endif //PARSING_H
@@ -52,19 +77,13 @@ void format_error();
  *
  * argv: the array of command line inputs.
  *
+ * resuming: whether jobthing was started by a handover, in which case the
+ * jobfile and input file are not opened, as the jobs and input are handed
+ * over instead.
+ *
  * Errors: will exit if inputFile cannot be opened with 
  * INVALID_INPUTFILE_EXIT (3) or if the jobFile cannot be read with 
  * INVALID_JOBFILE_EXIT(2).
  */
-void validate_commands(Params* params, int argc, char** argv);
-
-/* correct_cmd_format()
- * --------------------
- * Identifies if a command is in a correct format;
- *
- * line: the command to be checked
- *
- * Returns: true if the command is in the correct format and false if it is 
- * not.
- */
-bool correct_cmd_format(char* line);
+void validate_commands(Params* params, int argc, char** argv, 
+        bool resuming);
@@ -0,0 +1,87 @@
+#include "pidmap.h"
+
+//Multiplying by a large odd constant scatters the sequential pids the
+//kernel hands out
+#define PID_HASH_MULTIPLIER 2654435769u
+
+void init_pid_map(PidMap* map) {
+    map->numSlots = INITIAL_PID_MAP_SLOTS;
+    map->count = 0;
+    map->pids = calloc(map->numSlots, sizeof(pid_t));
+    map->indexes = malloc(sizeof(int) * map->numSlots);
+}
+
+int pid_map_slot(PidMap* map, pid_t pid) {
+    int mask = map->numSlots - 1;
+    int slot = ((unsigned) pid * PID_HASH_MULTIPLIER) & mask;
+    while (map->pids[slot] != NO_PID && map->pids[slot] != pid) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+void pid_map_put(PidMap* map, pid_t pid, int index) {
+    if (2 * (map->count + 1) > map->numSlots) {
+        grow_pid_map(map);
+    }
+    int slot = pid_map_slot(map, pid);
+    if (map->pids[slot] == NO_PID) {
+        map->pids[slot] = pid;
+        map->count++;
+    }
+    map->indexes[slot] = index;
+}
+
+int pid_map_get(PidMap* map, pid_t pid) {
+    if (pid == NO_PID) {
+        return NO_INDEX;
+    }
+    int slot = pid_map_slot(map, pid);
+    return map->pids[slot] == pid ? map->indexes[slot] : NO_INDEX;
+}
+
+void pid_map_remove(PidMap* map, pid_t pid) {
+    int mask = map->numSlots - 1;
+    int slot = pid_map_slot(map, pid);
+    if (map->pids[slot] != pid) {
+        return;
+    }
+    map->pids[slot] = NO_PID;
+    map->count--;
+
+    //Entries after the hole that would no longer be found are moved into it
+    int hole = slot;
+    for (slot = (slot + 1) & mask; map->pids[slot] != NO_PID; 
+            slot = (slot + 1) & mask) {
+        int home = ((unsigned) map->pids[slot] * PID_HASH_MULTIPLIER) & mask;
+        if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+            map->pids[hole] = map->pids[slot];
+            map->indexes[hole] = map->indexes[slot];
+            map->pids[slot] = NO_PID;
+            hole = slot;
+        }
+    }
+}
+
+void grow_pid_map(PidMap* map) {
+    pid_t* oldPids = map->pids;
+    int* oldIndexes = map->indexes;
+    int oldSlots = map->numSlots;
+
+    map->numSlots *= 2;
+    map->count = 0;
+    map->pids = calloc(map->numSlots, sizeof(pid_t));
+    map->indexes = malloc(sizeof(int) * map->numSlots);
+    for (int i = 0; i < oldSlots; i++) {
+        if (oldPids[i] != NO_PID) {
+            pid_map_put(map, oldPids[i], oldIndexes[i]);
+        }
+    }
+    free(oldPids);
+    free(oldIndexes);
+}
+
+void free_pid_map(PidMap* map) {
+    free(map->pids);
+    free(map->indexes);
+}
@@ -0,0 +1,90 @@
+#ifndef PIDMAP_H
+#define PIDMAP_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+#define NO_INDEX -1
+#define NO_PID 0
+#define INITIAL_PID_MAP_SLOTS 16
+
+//An open addressing hash table from the pid of a running job to its index 
+//in the jobs array. Slots are probed linearly and removal shifts later 
+//entries back, so no tombstones build up as jobs are restarted. The table
+//is kept at most half full.
+typedef struct {
+    pid_t* pids;
+    int* indexes;
+    int numSlots;
+    int count;
+} PidMap;
+
+#endif //PIDMAP_H
+
+/* init_pid_map()
+ * --------------
+ * Initialises an empty pid map.
+ *
+ * map: the pid map to be initialised.
+ */
+void init_pid_map(PidMap* map);
+
+/* pid_map_put()
+ * -------------
+ * Maps a pid to a job index, replacing any index it was mapped to.
+ *
+ * map: the pid map to be added to.
+ *
+ * pid: the pid, which must not be NO_PID.
+ *
+ * index: the index of the job.
+ */
+void pid_map_put(PidMap* map, pid_t pid, int index);
+
+/* pid_map_get()
+ * -------------
+ * Looks up the job index a pid is mapped to. This only reads the map, so it
+ * may be called from a signal handler.
+ *
+ * map: the pid map to be searched.
+ *
+ * pid: the pid to look up.
+ *
+ * Returns: the index of the job, or NO_INDEX if the pid is not mapped.
+ */
+int pid_map_get(PidMap* map, pid_t pid);
+
+/* pid_map_remove()
+ * ----------------
+ * Removes a pid from the map if it is mapped.
+ *
+ * map: the pid map to be removed from.
+ *
+ * pid: the pid to remove.
+ */
+void pid_map_remove(PidMap* map, pid_t pid);
+
+/* pid_map_slot()
+ * --------------
+ * Returns: the slot a pid is found in, or the empty slot where it would be 
+ * added.
+ */
+int pid_map_slot(PidMap* map, pid_t pid);
+
+/* grow_pid_map()
+ * --------------
+ * Doubles the number of slots in the map and rehashes every entry.
+ *
+ * map: the pid map to be grown.
+ */
+void grow_pid_map(PidMap* map);
+
+/* free_pid_map()
+ * --------------
+ * Frees the memory used by a pid map.
+ *
+ * map: the pid map to be freed.
+ */
+void free_pid_map(PidMap* map);
@@ -0,0 +1,142 @@
+#include "placement.h"
+
+void init_placement(Placement* placement) {
+    placement->numCpuRanges = 0;
+    placement->nice = INHERIT_NICE;
+    placement->schedPolicy = INHERIT_SCHED;
+    placement->rtPriority = DEFAULT_RT_PRIORITY;
+    placement->memLimit = NO_LIMIT;
+    placement->fileLimit = NO_LIMIT;
+    placement->pipeSize = 0;
+}
+
+bool parse_cpu_list(char* value, Placement* placement) {
+    if (!strcmp(value, AUTO_CPUS)) {
+        placement->numCpuRanges = SPREAD_CPUS;
+        return true;
+    }
+    placement->numCpuRanges = 0;
+    char* range = value;
+    while (placement->numCpuRanges < MAX_CPU_RANGES) {
+        char* pEnd;
+        if (!isdigit(range[0])) {
+            return false;
+        }
+        long first = strtol(range, &pEnd, 10);
+        long last = first;
+        if (*pEnd == CPU_RANGE) {
+            if (!isdigit(pEnd[1])) {
+                return false;
+            }
+            last = strtol(pEnd + 1, &pEnd, 10);
+        }
+        if (last < first || last >= CPU_SETSIZE || (*pEnd != '\0' &&
+                *pEnd != CPU_RANGE_SEPARATOR)) {
+            return false;
+        }
+        placement->cpuFirst[placement->numCpuRanges] = first;
+        placement->cpuLast[placement->numCpuRanges++] = last;
+        if (*pEnd == '\0') {
+            return true;
+        }
+        range = pEnd + 1;
+    }
+    return false;
+}
+
+bool parse_nice(char* value, int* nice) {
+    char* pEnd;
+    if (!isdigit(value[value[0] == '-'])) {
+        return false;
+    }
+    long parsed = strtol(value, &pEnd, 10);
+    *nice = parsed;
+    return *pEnd == '\0' && parsed >= PRIO_MIN && parsed < PRIO_MAX;
+}
+
+bool parse_sched_policy(char* value, int* policy) {
+    if (!strcmp(value, "other")) {
+        *policy = SCHED_OTHER;
+    } else if (!strcmp(value, "batch")) {
+        *policy = SCHED_BATCH;
+    } else if (!strcmp(value, "idle")) {
+        *policy = SCHED_IDLE;
+    } else if (!strcmp(value, "fifo")) {
+        *policy = SCHED_FIFO;
+    } else if (!strcmp(value, "rr")) {
+        *policy = SCHED_RR;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool job_placed(Placement* placement) {
+    return placement->numCpuRanges || placement->nice != INHERIT_NICE ||
+            placement->schedPolicy != INHERIT_SCHED ||
+            placement->memLimit != NO_LIMIT ||
+            placement->fileLimit != NO_LIMIT;
+}
+
+void spread_cpus(Placement* placement, cpu_set_t* available,
+        int spreadIndex) {
+    int numAvailable = CPU_COUNT(available);
+    int skip = numAvailable ? spreadIndex % numAvailable : 0;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, available) && !skip--) {
+            placement->numCpuRanges = 1;
+            placement->cpuFirst[0] = cpu;
+            placement->cpuLast[0] = cpu;
+            return;
+        }
+    }
+    //jobthing's CPUs are unknown, so the job runs on any of them
+    placement->numCpuRanges = 0;
+}
+
+bool apply_placement(Placement* placement) {
+    if (placement->memLimit != NO_LIMIT) {
+        struct rlimit limit = {placement->memLimit, placement->memLimit};
+        if (setrlimit(RLIMIT_AS, &limit) == -1) {
+            return false;
+        }
+    }
+    if (placement->fileLimit != NO_LIMIT) {
+        struct rlimit limit = {placement->fileLimit, placement->fileLimit};
+        if (setrlimit(RLIMIT_NOFILE, &limit) == -1) {
+            return false;
+        }
+    }
+
+    //The policy goes first, as a nice value only applies to the normal
+    //policies
+    if (placement->schedPolicy != INHERIT_SCHED) {
+        struct sched_param param = {0};
+        if (placement->schedPolicy == SCHED_FIFO ||
+                placement->schedPolicy == SCHED_RR) {
+            param.sched_priority = placement->rtPriority;
+        }
+        if (sched_setscheduler(0, placement->schedPolicy, &param) == -1) {
+            return false;
+        }
+    }
+    if (placement->nice != INHERIT_NICE &&
+            setpriority(PRIO_PROCESS, 0, placement->nice) == -1) {
+        return false;
+    }
+
+    if (placement->numCpuRanges > 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        for (int i = 0; i < placement->numCpuRanges; i++) {
+            for (int cpu = placement->cpuFirst[i];
+                    cpu <= placement->cpuLast[i]; cpu++) {
+                CPU_SET(cpu, &cpus);
+            }
+        }
+        if (sched_setaffinity(0, sizeof(cpus), &cpus) == -1) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,122 @@
+#ifndef PLACEMENT_H
+#define PLACEMENT_H
+
+#include "helper.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <ctype.h>
+#include <sched.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#define MAX_CPU_RANGES 4
+#define CPU_RANGE_SEPARATOR '+'
+#define CPU_RANGE '-'
+#define AUTO_CPUS "auto"
+#define SPREAD_CPUS -1
+#define INHERIT_NICE (PRIO_MAX + 1)
+#define INHERIT_SCHED -1
+#define DEFAULT_RT_PRIORITY 1
+#define MAX_RT_PRIORITY 99
+#define NO_LIMIT 0
+
+//Where and how a job's process runs, applied in the child before it execs.
+//The job may run on the CPUs in its numCpuRanges ranges, from cpuFirst to
+//cpuLast, or anywhere jobthing may if there are none. SPREAD_CPUS ranges
+//mean one CPU of jobthing's own is picked for the job when it is made, in
+//turn with the other spread jobs. nice and schedPolicy (with rtPriority for
+//the real-time policies) are inherited unless set. memLimit (address
+//space, in bytes) and fileLimit (open files) are not limited unless set.
+//pipeSize is the capacity asked for the job's pipes, or the default of 0.
+typedef struct {
+    int numCpuRanges;
+    int cpuFirst[MAX_CPU_RANGES];
+    int cpuLast[MAX_CPU_RANGES];
+    int nice;
+    int schedPolicy;
+    int rtPriority;
+    size_t memLimit;
+    long fileLimit;
+    size_t pipeSize;
+} Placement;
+
+#endif //PLACEMENT_H
+
+/* init_placement()
+ * ----------------
+ * Initialises a placement that leaves everything as jobthing has it.
+ *
+ * placement: the placement to be initialised.
+ */
+void init_placement(Placement* placement);
+
+/* parse_cpu_list()
+ * ----------------
+ * Parses the CPUs a job may run on: up to MAX_CPU_RANGES CPUs or ranges
+ * joined by '+', e.g., "0-3+8", or "auto" to spread jobs over jobthing's
+ * CPUs.
+ *
+ * value: the list to be parsed.
+ *
+ * placement: set to run on the listed CPUs.
+ *
+ * Returns: true if the value is a valid list, false otherwise.
+ */
+bool parse_cpu_list(char* value, Placement* placement);
+
+/* parse_nice()
+ * ------------
+ * Parses a nice value, from -20 to 19.
+ *
+ * value: the value to be parsed.
+ *
+ * nice: set to the nice value.
+ *
+ * Returns: true if the value is a valid nice value, false otherwise.
+ */
+bool parse_nice(char* value, int* nice);
+
+/* parse_sched_policy()
+ * --------------------
+ * Parses the name of a scheduling policy: other, batch, idle, fifo or rr.
+ *
+ * value: the name of the policy.
+ *
+ * policy: set to the policy.
+ *
+ * Returns: true if the name is a known policy, false otherwise.
+ */
+bool parse_sched_policy(char* value, int* policy);
+
+/* job_placed()
+ * ------------
+ * Returns: true if the placement has anything to apply in the child, false
+ * if the child runs as jobthing does.
+ */
+bool job_placed(Placement* placement);
+
+/* spread_cpus()
+ * -------------
+ * Picks the CPU a job spread over jobthing's CPUs runs on.
+ *
+ * placement: the placement of the job, whose ranges are SPREAD_CPUS.
+ *
+ * available: the CPUs jobthing may run on.
+ *
+ * spreadIndex: how many jobs were spread before this one.
+ */
+void spread_cpus(Placement* placement, cpu_set_t* available,
+        int spreadIndex);
+
+/* apply_placement()
+ * -----------------
+ * Applies a placement to the calling process. Nothing but system calls are
+ * made, so it may be used between fork() and exec.
+ *
+ * placement: the placement to be applied.
+ *
+ * Returns: true if all of it was applied, false otherwise.
+ */
+bool apply_placement(Placement* placement);
@@ -0,0 +1,175 @@
+#include "pool.h"
+
+void init_pool(Pool* pool, const char* name, DispatchMode mode,
+        int keyField) {
+    pool->name = strdup(name);
+    pool->mode = mode;
+    pool->keyField = keyField;
+    pool->members = NULL;
+    pool->numMembers = 0;
+    pool->capacity = 0;
+    pool->next = 0;
+    pool->scalable = false;
+    pool->minActive = 0;
+    pool->numActive = 0;
+    pool->numParked = 0;
+    pool->scaleAt = DEFAULT_SCALE_AT;
+    pool->idleMs = DEFAULT_IDLE_MS;
+    pool->orderWindow = UNORDERED;
+    pool->orderTimeoutMs = NO_ORDER_TIMEOUT;
+    pool->dropStragglers = false;
+    pool->owners = NULL;
+    pool->sentMs = NULL;
+    pool->orderSlots = 0;
+    pool->nextSeq = 0;
+    pool->nextRelease = 0;
+    pool->windowFull = false;
+}
+
+void set_pool_scaling(Pool* pool, int scaleAt, long long idleMs) {
+    pool->scalable = true;
+    pool->scaleAt = scaleAt;
+    pool->idleMs = idleMs;
+}
+
+void set_pool_order(Pool* pool, int window, long long timeoutMs, 
+        bool dropStragglers) {
+    pool->orderWindow = window;
+    pool->orderTimeoutMs = timeoutMs;
+    pool->dropStragglers = dropStragglers;
+}
+
+void number_pool_line(Pool* pool, int index, long long nowMs) {
+    int numWaiting = pool->nextSeq - pool->nextRelease;
+    if (numWaiting == pool->orderSlots) {
+        //Grow the ring, keeping each waiting line at its number's slot
+        int slots = pool->orderSlots ? pool->orderSlots * 2 : 
+                INITIAL_ORDER_SLOTS;
+        int* owners = malloc(sizeof(int) * slots);
+        long long* sentMs = malloc(sizeof(long long) * slots);
+        for (unsigned long long seq = pool->nextRelease; seq < pool->nextSeq;
+                seq++) {
+            owners[seq & (slots - 1)] = pool->owners[order_slot(pool, seq)];
+            sentMs[seq & (slots - 1)] = pool->sentMs[order_slot(pool, seq)];
+        }
+        free(pool->owners);
+        free(pool->sentMs);
+        pool->owners = owners;
+        pool->sentMs = sentMs;
+        pool->orderSlots = slots;
+    }
+    int slot = order_slot(pool, pool->nextSeq++);
+    pool->owners[slot] = index;
+    pool->sentMs[slot] = nowMs;
+}
+
+int order_slot(Pool* pool, unsigned long long seq) {
+    return seq & (pool->orderSlots - 1);
+}
+
+void add_pool_member(Pool* pool, int index, bool parked) {
+    if (pool->numMembers == pool->capacity) {
+        pool->capacity = pool->capacity ? pool->capacity * 2 :
+                INITIAL_POOL_MEMBERS;
+        pool->members = realloc(pool->members,
+                sizeof(int) * pool->capacity);
+    }
+    pool->members[pool->numMembers++] = index;
+    if (parked) {
+        pool->numParked++;
+    } else {
+        pool->numActive++;
+    }
+}
+
+void remove_pool_member(Pool* pool, int index) {
+    int at = 0;
+    while (at < pool->numMembers && pool->members[at] != index) {
+        at++;
+    }
+    if (at == pool->numMembers) {
+        return;
+    }
+    //Members stay in order, so the turn carries on from the same job
+    memmove(pool->members + at, pool->members + at + 1, 
+            sizeof(int) * (pool->numMembers - at - 1));
+    pool->numMembers--;
+    if (at < pool->next) {
+        pool->next--;
+    }
+    if (pool->next >= pool->numMembers) {
+        pool->next = 0;
+    }
+}
+
+bool parse_straggler_policy(char* value, bool* dropStragglers) {
+    if (!strcmp(value, "late")) {
+        *dropStragglers = false;
+    } else if (!strcmp(value, "drop")) {
+        *dropStragglers = true;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool parse_dispatch_mode(char* value, DispatchMode* mode) {
+    if (!strcmp(value, "rr")) {
+        *mode = DISPATCH_ROUND_ROBIN;
+    } else if (!strcmp(value, "least")) {
+        *mode = DISPATCH_LEAST_LOADED;
+    } else if (!strcmp(value, "hash")) {
+        *mode = DISPATCH_HASH;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+uint64_t hash_line_key(const char* line, size_t length, int keyField) {
+    const char* key = line;
+    const char* end = line + length;
+    if (keyField != WHOLE_LINE_KEY) {
+        //Skip to the start of the key field, then find its end
+        for (int field = 1; key < end; field++) {
+            while (key < end && (*key == ' ' || *key == '\t')) {
+                key++;
+            }
+            const char* fieldEnd = key;
+            while (fieldEnd < end && *fieldEnd != ' ' && *fieldEnd != '\t') {
+                fieldEnd++;
+            }
+            if (field == keyField) {
+                end = fieldEnd;
+                break;
+            }
+            key = fieldEnd;
+        }
+    }
+
+    uint64_t hash = FNV_OFFSET_BASIS;
+    for (; key < end; key++) {
+        hash ^= (unsigned char) *key;
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+uint64_t member_weight(uint64_t keyHash, int jobNumber) {
+    //splitmix64 finaliser, so that nearby job numbers get unrelated weights
+    uint64_t weight = keyHash ^ ((uint64_t) jobNumber * WEIGHT_SPREAD);
+    weight = (weight ^ (weight >> 30)) * WEIGHT_MIX1;
+    weight = (weight ^ (weight >> 27)) * WEIGHT_MIX2;
+    return weight ^ (weight >> 31);
+}
+
+void free_pool(Pool* pool) {
+    free(pool->name);
+    free(pool->members);
+    free(pool->owners);
+    free(pool->sentMs);
+    pool->members = NULL;
+    pool->owners = NULL;
+    pool->sentMs = NULL;
+    pool->numMembers = 0;
+}
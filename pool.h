@@ -0,0 +1,238 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define NO_POOL -1
+#define WHOLE_LINE_KEY 0
+#define INITIAL_POOL_MEMBERS 4
+#define DEFAULT_SCALE_AT 8
+#define DEFAULT_IDLE_MS 30000
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+#define WEIGHT_SPREAD 0x9e3779b97f4a7c15ULL
+#define WEIGHT_MIX1 0xbf58476d1ce4e5b9ULL
+#define WEIGHT_MIX2 0x94d049bb133111ebULL
+#define UNORDERED 0
+#define NO_ORDER_TIMEOUT -1
+#define INITIAL_ORDER_SLOTS 64
+#define NO_OWNER -1
+
+//How the lines of input are shared between jobs. DISPATCH_BROADCAST sends
+//every line to every job and is what jobs outside a pool get. The others
+//send each line to one job of a pool: the next in turn, the one with the
+//fewest lines in flight, or the one a key field of the line hashes to.
+typedef enum {
+    DISPATCH_BROADCAST,
+    DISPATCH_ROUND_ROBIN,
+    DISPATCH_LEAST_LOADED,
+    DISPATCH_HASH
+} DispatchMode;
+
+//A group of jobs that share the lines of input between them, each line
+//going to one member chosen by mode. Members are job indexes. next is
+//where the round-robin (and, between equally loaded jobs, least loaded)
+//search next starts. keyField is the field of the line hashed by
+//DISPATCH_HASH, counted from 1, or WHOLE_LINE_KEY.
+//
+//A pool whose jobs were given a replica range is scalable. Members that are
+//parked are registered but not running. One is started when every running
+//member has scaleAt lines in flight or a full input queue, and a started 
+//member idle for idleMs is retired back to parked while more than 
+//minActive members are active (not parked).
+//
+//An ordered pool relays its answers in the order the lines were sent. Each
+//line sent is numbered in turn, and the index of the member it went to is 
+//kept in the owners ring (orderSlots long, a power of two) along with when
+//it was sent. Answers wait in their member's output buffer until every 
+//line numbered before theirs has been answered, nextRelease being the 
+//number of the next line to be answered. A line is answered once its 
+//member sends a line back, as members answer their lines in turn. Input is
+//paused (windowFull) while orderWindow lines are waiting. A line unanswered
+//for orderTimeoutMs is skipped, and its answer relayed whenever it comes, 
+//or dropped if dropStragglers is set. A skipped line's owner is NO_OWNER.
+typedef struct {
+    char* name;
+    DispatchMode mode;
+    int keyField;
+    int* members;
+    int numMembers;
+    int capacity;
+    int next;
+    bool scalable;
+    int minActive;
+    int numActive;
+    int numParked;
+    int scaleAt;
+    long long idleMs;
+    int orderWindow;
+    long long orderTimeoutMs;
+    bool dropStragglers;
+    int* owners;
+    long long* sentMs;
+    int orderSlots;
+    unsigned long long nextSeq;
+    unsigned long long nextRelease;
+    bool windowFull;
+} Pool;
+
+#endif //POOL_H
+
+/* init_pool()
+ * -----------
+ * Initialises an empty pool.
+ *
+ * pool: the pool to be initialised.
+ *
+ * name: the name of the pool, which is copied.
+ *
+ * mode: how lines are shared between the pool's jobs.
+ *
+ * keyField: the field hashed by DISPATCH_HASH.
+ */
+void init_pool(Pool* pool, const char* name, DispatchMode mode,
+        int keyField);
+
+/* set_pool_scaling()
+ * ------------------
+ * Makes a pool scalable.
+ *
+ * pool: the pool to be made scalable.
+ *
+ * scaleAt: the lines in flight at which a running member counts as busy.
+ *
+ * idleMs: how long a started member may go without a line in or out before
+ * it is retired.
+ */
+void set_pool_scaling(Pool* pool, int scaleAt, long long idleMs);
+
+/* set_pool_order()
+ * ----------------
+ * Makes a pool relay its answers in the order its lines were sent.
+ *
+ * pool: the pool to be ordered.
+ *
+ * window: the number of unanswered lines at which input is paused.
+ *
+ * timeoutMs: how long a line may go unanswered before the answers after it
+ * are relayed without it, or NO_ORDER_TIMEOUT.
+ *
+ * dropStragglers: whether the answer to a skipped line is dropped rather 
+ * than relayed when it comes.
+ */
+void set_pool_order(Pool* pool, int window, long long timeoutMs, 
+        bool dropStragglers);
+
+/* number_pool_line()
+ * ------------------
+ * Numbers a line sent to a member of an ordered pool, growing the owners 
+ * ring if it is full.
+ *
+ * pool: the ordered pool.
+ *
+ * index: the index of the job the line was sent to.
+ *
+ * nowMs: when the line was sent.
+ */
+void number_pool_line(Pool* pool, int index, long long nowMs);
+
+/* order_slot()
+ * ------------
+ * Finds where a numbered line is kept in the owners ring.
+ *
+ * pool: the ordered pool.
+ *
+ * seq: the number of the line, which must not have been answered yet.
+ *
+ * Returns: the index of the line in owners and sentMs.
+ */
+int order_slot(Pool* pool, unsigned long long seq);
+
+/* add_pool_member()
+ * -----------------
+ * Adds a job to a pool.
+ *
+ * pool: the pool to be added to.
+ *
+ * index: the index of the job.
+ *
+ * parked: whether the job is registered without being started.
+ */
+void add_pool_member(Pool* pool, int index, bool parked);
+
+/* remove_pool_member()
+ * --------------------
+ * Takes a job out of a pool's members. The pool's counts of active and 
+ * parked members are left to the caller.
+ *
+ * pool: the pool to be taken out of.
+ *
+ * index: the index of the job.
+ */
+void remove_pool_member(Pool* pool, int index);
+
+/* parse_straggler_policy()
+ * ------------------------
+ * Parses the value of a straggler attribute: late or drop.
+ *
+ * value: the value to be parsed.
+ *
+ * dropStragglers: set to whether late answers are dropped.
+ *
+ * Returns: true if the value is a straggler policy, false otherwise.
+ */
+bool parse_straggler_policy(char* value, bool* dropStragglers);
+
+/* parse_dispatch_mode()
+ * ---------------------
+ * Parses the value of a dispatch attribute: rr, least or hash.
+ *
+ * value: the value to be parsed.
+ *
+ * mode: set to the dispatch mode.
+ *
+ * Returns: true if the value is a dispatch mode, false otherwise.
+ */
+bool parse_dispatch_mode(char* value, DispatchMode* mode);
+
+/* hash_line_key()
+ * ---------------
+ * Hashes the key field of a line with 64-bit FNV-1a. Fields are separated
+ * by spaces or tabs. A line with fewer fields than keyField has an empty
+ * key.
+ *
+ * line: the line, which need not be null terminated.
+ *
+ * length: the length of the line.
+ *
+ * keyField: the field to be hashed, counted from 1, or WHOLE_LINE_KEY.
+ *
+ * Returns: the hash of the key.
+ */
+uint64_t hash_line_key(const char* line, size_t length, int keyField);
+
+/* member_weight()
+ * ---------------
+ * Mixes a key's hash with a job number, for rendezvous hashing. The job with
+ * the highest weight for a key gets the key's lines, so that a job leaving
+ * or rejoining the pool only moves the keys that are its own.
+ *
+ * keyHash: the hash of the line's key.
+ *
+ * jobNumber: the number of the job.
+ *
+ * Returns: the weight of the job for the key.
+ */
+uint64_t member_weight(uint64_t keyHash, int jobNumber);
+
+/* free_pool()
+ * -----------
+ * Frees the memory associated with a pool.
+ *
+ * pool: the pool to be freed.
+ */
+void free_pool(Pool* pool);
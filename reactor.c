@@ -0,0 +1,56 @@
+#include "reactor.h"
+
+//The kind is stored in the upper half of the epoll data and the job index
+//in the lower half.
+#define KIND_SHIFT 32
+#define INDEX_MASK 0xffffffffu
+
+bool init_reactor(Reactor* reactor) {
+    reactor->numReady = 0;
+    reactor->epollFd = epoll_create1(EPOLL_CLOEXEC);
+    return reactor->epollFd != -1;
+}
+
+bool reactor_watch(Reactor* reactor, int fd, WatchKind kind, int index, 
+        uint32_t events) {
+    struct epoll_event event;
+    event.events = events;
+    event.data.u64 = ((uint64_t) kind << KIND_SHIFT) | 
+            ((uint32_t) index & INDEX_MASK);
+    return epoll_ctl(reactor->epollFd, EPOLL_CTL_ADD, fd, &event) == 0;
+}
+
+void reactor_modify(Reactor* reactor, int fd, WatchKind kind, int index, 
+        uint32_t events) {
+    struct epoll_event event;
+    event.events = events;
+    event.data.u64 = ((uint64_t) kind << KIND_SHIFT) | 
+            ((uint32_t) index & INDEX_MASK);
+    epoll_ctl(reactor->epollFd, EPOLL_CTL_MOD, fd, &event);
+}
+
+void reactor_unwatch(Reactor* reactor, int fd) {
+    epoll_ctl(reactor->epollFd, EPOLL_CTL_DEL, fd, NULL);
+}
+
+int reactor_wait(Reactor* reactor, int timeoutMs) {
+    reactor->numReady = epoll_wait(reactor->epollFd, reactor->events, 
+            MAX_READY_EVENTS, timeoutMs);
+    if (reactor->numReady == -1) {
+        //EINTR from a signal handler (e.g., SIGHUP) is not an error
+        reactor->numReady = 0;
+    }
+    return reactor->numReady;
+}
+
+WatchKind event_kind(struct epoll_event* event) {
+    return (WatchKind) (event->data.u64 >> KIND_SHIFT);
+}
+
+int event_index(struct epoll_event* event) {
+    return (int) (event->data.u64 & INDEX_MASK);
+}
+
+void close_reactor(Reactor* reactor) {
+    close(reactor->epollFd);
+}
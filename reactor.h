@@ -0,0 +1,137 @@
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+#define MAX_READY_EVENTS 64
+#define WAIT_FOREVER -1
+
+//Identifies what a watched file descriptor belongs to so that ready events
+//can be routed back to the right handler.
+typedef enum {
+    WATCH_INPUT,
+    WATCH_JOB_OUTPUT,
+    WATCH_JOB_INPUT,
+    WATCH_JOB_EXIT,
+    WATCH_CHILD_EXIT,
+    WATCH_RESTART_TIMER,
+    WATCH_REPORT_SIGNAL,
+    WATCH_METRICS_LISTEN,
+    WATCH_METRICS_CLIENT,
+    WATCH_CONTROL_LISTEN,
+    WATCH_CONTROL_CLIENT,
+    WATCH_SHARD_MESSAGES,
+    WATCH_SHARD_REPLIES
+} WatchKind;
+
+//Wraps an epoll instance and the events returned by the last wait. Watched 
+//descriptors are tagged with their kind and, for jobs, the index of the job
+//in the jobs array rather than a pointer so the tag survives the array being
+//reallocated.
+typedef struct {
+    int epollFd;
+    struct epoll_event events[MAX_READY_EVENTS];
+    int numReady;
+} Reactor;
+
+#endif //REACTOR_H
+
+/* init_reactor()
+ * --------------
+ * Initialises the reactor and creates its epoll instance.
+ *
+ * reactor: the reactor to be initialised.
+ *
+ * Returns: true if the epoll instance was created, false otherwise.
+ */
+bool init_reactor(Reactor* reactor);
+
+/* reactor_watch()
+ * ---------------
+ * Starts watching a file descriptor for the given events.
+ *
+ * reactor: the reactor to add the file descriptor to.
+ *
+ * fd: the file descriptor to be watched.
+ *
+ * kind: what the file descriptor belongs to.
+ *
+ * index: the index of the job the file descriptor belongs to, or 0 if it 
+ * does not belong to a job.
+ *
+ * events: the epoll events to wait for e.g., EPOLLIN.
+ *
+ * Returns: true if the file descriptor is now watched, false otherwise. 
+ * Errors: regular files cannot be watched and fail with errno set to EPERM.
+ */
+bool reactor_watch(Reactor* reactor, int fd, WatchKind kind, int index, 
+        uint32_t events);
+
+/* reactor_modify()
+ * ----------------
+ * Changes the events a watched file descriptor is waited on for.
+ *
+ * reactor: the reactor watching the file descriptor.
+ *
+ * fd: the watched file descriptor.
+ *
+ * kind: what the file descriptor belongs to.
+ *
+ * index: the index of the job the file descriptor belongs to, or 0.
+ *
+ * events: the epoll events to wait for, or 0 to pause the watch.
+ */
+void reactor_modify(Reactor* reactor, int fd, WatchKind kind, int index, 
+        uint32_t events);
+
+/* reactor_unwatch()
+ * -----------------
+ * Stops watching a file descriptor. Must be called before the descriptor is
+ * closed, as a copy held by a child would otherwise keep it registered.
+ *
+ * reactor: the reactor to remove the file descriptor from.
+ *
+ * fd: the file descriptor to stop watching.
+ */
+void reactor_unwatch(Reactor* reactor, int fd);
+
+/* reactor_wait()
+ * --------------
+ * Blocks until at least one watched file descriptor is ready or the timeout
+ * expires. Interruptions by signal handlers are reported as no events.
+ *
+ * reactor: the reactor to wait on.
+ *
+ * timeoutMs: the maximum time to wait in milliseconds, 0 to poll or 
+ * WAIT_FOREVER (-1) to block until an event arrives.
+ *
+ * Returns: the number of ready events stored in the reactor.
+ */
+int reactor_wait(Reactor* reactor, int timeoutMs);
+
+/* event_kind()
+ * ------------
+ * Returns: the kind of the watched descriptor that produced the event.
+ */
+WatchKind event_kind(struct epoll_event* event);
+
+/* event_index()
+ * -------------
+ * Returns: the job index the watched descriptor that produced the event was
+ * registered with.
+ */
+int event_index(struct epoll_event* event);
+
+/* close_reactor()
+ * ---------------
+ * Closes the reactor's epoll instance.
+ *
+ * reactor: the reactor to be closed.
+ */
+void close_reactor(Reactor* reactor);
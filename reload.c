@@ -0,0 +1,234 @@
+#include "reload.h"
+
+void reload_jobs(Jobs* jobs, Params* params, TimerWheel* wheel,
+        Reactor* reactor) {
+    jobs->reloadPending = false;
+    JobAttrs defaults;
+    init_job_attrs(&defaults);
+    defaults.forkSpawn = params->forkSpawn;
+    FILE* file = fopen(params->jobFileName, "r");
+    JobFile jobFile;
+    if (!file || !load_jobfile(&jobFile, file, &defaults)) {
+        writer_printf(&output, "Error: Unable to reload job file\n");
+        if (file) {
+            fclose(file);
+        }
+        return;
+    }
+
+    //The valid lines, in file order
+    int numSpecs = 0;
+    for (int i = 0; i < jobFile.numChunks; i++) {
+        numSpecs += jobFile.chunks[i].numSpecs;
+    }
+    JobSpec** specs = malloc(sizeof(JobSpec*) * (numSpecs + 1));
+    numSpecs = 0;
+    for (int i = 0; i < jobFile.numChunks; i++) {
+        JobChunk* chunk = &jobFile.chunks[i];
+        for (int j = 0; j < chunk->numSpecs; j++) {
+            JobSpec* spec = &chunk->specs[j];
+            if (spec->valid) {
+                specs[numSpecs++] = spec;
+            } else if (params->verbose) {
+                fprintf(stderr, "Error: invalid job specification: %.*s\n",
+                        (int) spec->line.length, spec->line.start);
+            }
+        }
+    }
+
+    //Removed jobs that could not be released when they exited, as output 
+    //was still to be relayed, are released now
+    for (int i = 0; i < jobs->numberJobs; i++) {
+        release_removed_job(jobs, &jobs->tasks[i]);
+    }
+
+    //Entries still live are found by their line and by their command
+    int numOldJobs = jobs->numberJobs;
+    EntryKey* byLine = malloc(sizeof(EntryKey) * numOldJobs);
+    EntryKey* byCmd = malloc(sizeof(EntryKey) * numOldJobs);
+    int numEntries = 0;
+    for (int i = 0; i < numOldJobs; i++) {
+        Job* job = &jobs->tasks[i];
+        if (job->entry != i || job->removed) {
+            continue;
+        }
+        byLine[numEntries].hash = job->specHash;
+        byLine[numEntries].entry = i;
+        byCmd[numEntries].hash = hash_line_key(job->cmd, strlen(job->cmd),
+                WHOLE_LINE_KEY);
+        byCmd[numEntries++].entry = i;
+    }
+    qsort(byLine, numEntries, sizeof(EntryKey), compare_entry_keys);
+    qsort(byCmd, numEntries, sizeof(EntryKey), compare_entry_keys);
+
+    //Unchanged lines are matched first, so that a changed line is only
+    //paired with an entry no unchanged line wants
+    bool* matched = calloc(numOldJobs + 1, sizeof(bool));
+    int* matches = malloc(sizeof(int) * (numSpecs + 1));
+    int numUnchanged = 0;
+    for (int i = 0; i < numSpecs; i++) {
+        matches[i] = find_entry(jobs, byLine, numEntries,
+                hash_line_key(specs[i]->line.start, specs[i]->line.length,
+                WHOLE_LINE_KEY), specs[i], matched);
+        numUnchanged += matches[i] != NO_INDEX;
+    }
+
+    //Changed entries are replaced by the rollout, while new ones start now.
+    //Each is made in the slots of a released entry if one fits.
+    jobs->rollout = realloc(jobs->rollout, sizeof(int) * (numSpecs + 1));
+    jobs->rolloutFrom = 0;
+    int numChanged = 0;
+    int numAdded = 0;
+    for (int i = 0; i < numSpecs; i++) {
+        if (matches[i] != NO_INDEX) {
+            continue;
+        }
+        int replaces = find_entry(jobs, byCmd, numEntries,
+                hash_line_key(specs[i]->cmd.start, specs[i]->cmd.length,
+                WHOLE_LINE_KEY), specs[i], matched);
+        int entry = add_entry(jobs, specs[i], params, replaces, 
+                find_released_entry(jobs, specs[i]->attrs.maxReplicas));
+        if (replaces != NO_INDEX) {
+            jobs->rollout[numChanged++] = entry;
+        } else {
+            numAdded++;
+            start_entry(jobs, entry, wheel, reactor, params->verbose);
+        }
+    }
+
+    int numRemoved = 0;
+    for (int i = 0; i < numEntries; i++) {
+        if (!matched[byLine[i].entry]) {
+            remove_entry(jobs, byLine[i].entry, false);
+            numRemoved++;
+        }
+    }
+    writer_printf(&output, "Reloaded job file: %d added, %d removed, "
+            "%d changed, %d unchanged\n", numAdded, numRemoved, numChanged,
+            numUnchanged);
+
+    free(matches);
+    free(matched);
+    free(byCmd);
+    free(byLine);
+    free(specs);
+    free_jobfile(&jobFile);
+    fclose(file);
+}
+
+int find_released_entry(Jobs* jobs, int numReplicas) {
+    for (int i = 0; i < jobs->numberJobs; i++) {
+        Job* first = &jobs->tasks[i];
+        if (first->entry != i || !first->released || 
+                first->attrs.maxReplicas != numReplicas) {
+            continue;
+        }
+        int replica = 1;
+        while (replica < numReplicas && jobs->tasks[i + replica].released) {
+            replica++;
+        }
+        if (replica == numReplicas) {
+            return i;
+        }
+    }
+    return NO_INDEX;
+}
+
+int find_entry(Jobs* jobs, EntryKey* keys, int numKeys, uint64_t hash,
+        JobSpec* spec, bool* matched) {
+    //The first key with the hash is found by binary search
+    int low = 0;
+    int high = numKeys;
+    while (low < high) {
+        int middle = low + (high - low) / 2;
+        if (keys[middle].hash < hash) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    for (int i = low; i < numKeys && keys[i].hash == hash; i++) {
+        int entry = keys[i].entry;
+        char* cmd = jobs->tasks[entry].cmd;
+        if (!matched[entry] && strlen(cmd) == spec->cmd.length &&
+                !strncmp(cmd, spec->cmd.start, spec->cmd.length)) {
+            matched[entry] = true;
+            return entry;
+        }
+    }
+    return NO_INDEX;
+}
+
+int compare_entry_keys(const void* a, const void* b) {
+    const EntryKey* first = a;
+    const EntryKey* second = b;
+    if (first->hash != second->hash) {
+        return first->hash < second->hash ? -1 : 1;
+    }
+    return first->entry - second->entry;
+}
+
+void start_entry(Jobs* jobs, int entry, TimerWheel* wheel, Reactor* reactor,
+        bool verbose) {
+    int numReplicas = jobs->tasks[entry].attrs.maxReplicas;
+    for (int i = entry; i < entry + numReplicas; i++) {
+        Job* job = &jobs->tasks[i];
+        if (job->held) {
+            job->held = false;
+            jobs->numHeld--;
+        }
+        if (job->parked) {
+            if (!job->jobNumber) {
+                number_job(jobs, job);
+            }
+            set_job_state(jobs, i, JOB_RUNNABLE, true);
+            continue;
+        }
+        start_job(jobs, job, false, reactor, verbose);
+        watch_job_idle(jobs, job, wheel);
+    }
+}
+
+void remove_entry(Jobs* jobs, int entry, bool rolling) {
+    Job* first = &jobs->tasks[entry];
+    if (first->pool != NO_POOL) {
+        jobs->pools[first->pool].minActive -= first->attrs.minReplicas;
+    }
+    for (int i = entry; i < entry + first->attrs.maxReplicas; i++) {
+        Job* job = &jobs->tasks[i];
+        job->removed = true;
+        if (job->pool == NO_POOL) {
+            jobs->numBroadcastJobs--;
+        } else if (job->parked) {
+            job->parked = false;
+            jobs->pools[job->pool].numParked--;
+        } else if (!job->retiring) {
+            jobs->pools[job->pool].numActive--;
+        }
+
+        //A job waiting to be restarted is simply never restarted
+        if (!job_state(jobs, i, JOB_RUNNING)) {
+            set_job_state(jobs, i, JOB_RUNNABLE, false);
+            release_removed_job(jobs, job);
+            continue;
+        }
+        if (rolling) {
+            job->rolling = true;
+            jobs->numRolling++;
+        }
+        //A retiring job's input is already closed
+        if (job->in.isPipe && !job->retiring) {
+            end_job_input(jobs, job);
+        }
+    }
+}
+
+void advance_rollout(Jobs* jobs, TimerWheel* wheel, Reactor* reactor,
+        bool verbose) {
+    while (jobs->numHeld && jobs->numRolling < jobs->surge) {
+        int entry = jobs->rollout[jobs->rolloutFrom++];
+        int replaces = jobs->tasks[entry].replaces;
+        start_entry(jobs, entry, wheel, reactor, verbose);
+        remove_entry(jobs, replaces, true);
+    }
+}
@@ -0,0 +1,138 @@
+#ifndef RELOAD_H
+#define RELOAD_H
+
+#include "job.h"
+#include "timerwheel.h"
+#include "reactor.h"
+#include "writer.h"
+#include "pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+//A live jobfile entry, found by the hash of its line or of its command.
+//Keys are sorted by hash, and then by entry so that entries repeated in the
+//jobfile are matched in file order.
+typedef struct {
+    uint64_t hash;
+    int entry;
+} EntryKey;
+
+#endif //RELOAD_H
+
+/* reload_jobs()
+ * -------------
+ * Reads the jobfile again and brings the jobs in line with it. Each entry
+ * whose line is unchanged keeps its jobs running as they are, with their
+ * pipes, queues and stats. Each entry whose command is still there but whose
+ * line has changed gets new jobs, held for the rollout to swap in. Entries
+ * new to the jobfile are started straight away, and the jobs of entries no
+ * longer in it are removed. A summary, or why the jobfile could not be
+ * read, is written to the output.
+ *
+ * jobs: pointer to array containing the jobs
+ *
+ * params: the setup parameters, holding the path of the jobfile
+ *
+ * wheel: the timer wheel idle checks of new jobs are scheduled on
+ *
+ * reactor: the reactor new jobs are watched with
+ */
+void reload_jobs(Jobs* jobs, Params* params, TimerWheel* wheel,
+        Reactor* reactor);
+
+/* find_released_entry()
+ * ---------------------
+ * Finds an entry with the given number of replicas whose jobs have all been
+ * released, so that a new entry can be made in its slots.
+ *
+ * jobs: pointer to array containing the jobs
+ *
+ * numReplicas: the number of replicas of the new entry
+ *
+ * Returns: the index of the entry's first job, or NO_INDEX if there is none.
+ */
+int find_released_entry(Jobs* jobs, int numReplicas);
+
+/* find_entry()
+ * ------------
+ * Finds a live entry not yet matched whose key has the given hash and whose
+ * command is the spec's, and marks it matched.
+ *
+ * jobs: pointer to array containing the jobs
+ *
+ * keys: the keys of the live entries, sorted
+ *
+ * numKeys: the number of keys
+ *
+ * hash: the hash to be found
+ *
+ * spec: the parsed jobfile line being matched
+ *
+ * matched: whether each entry, by index, has been matched
+ *
+ * Returns: the index of the entry, or NO_INDEX if there is none.
+ */
+int find_entry(Jobs* jobs, EntryKey* keys, int numKeys, uint64_t hash,
+        JobSpec* spec, bool* matched);
+
+/* compare_entry_keys()
+ * --------------------
+ * Orders entry keys by hash and then by entry, for qsort().
+ *
+ * Returns: negative, zero or positive as the first key sorts before, with or
+ * after the second.
+ */
+int compare_entry_keys(const void* a, const void* b);
+
+/* start_entry()
+ * -------------
+ * Starts the jobs of an entry added by a reload. Parked replicas are left
+ * runnable to be woken by input, as at startup.
+ *
+ * jobs: pointer to array containing the jobs
+ *
+ * entry: the index of the entry's first job
+ *
+ * wheel: the timer wheel idle checks are scheduled on
+ *
+ * reactor: the reactor the jobs are watched with
+ *
+ * verbose: whether jobthing is in verbose mode
+ */
+void start_entry(Jobs* jobs, int entry, TimerWheel* wheel, Reactor* reactor,
+        bool verbose);
+
+/* remove_entry()
+ * --------------
+ * Removes the jobs of an entry from their pool or broadcast and sends those
+ * running end of file, leaving them to exit. None is restarted. Those not
+ * running are released straight away.
+ *
+ * jobs: pointer to array containing the jobs
+ *
+ * entry: the index of the entry's first job
+ *
+ * rolling: whether the entry is being replaced by the rollout, which waits
+ * for its running jobs to exit
+ */
+void remove_entry(Jobs* jobs, int entry, bool rolling);
+
+/* advance_rollout()
+ * -----------------
+ * Replaces changed entries in turn, starting the held jobs of one and
+ * removing the jobs it replaces, while fewer than surge replaced jobs are
+ * still winding down.
+ *
+ * jobs: pointer to array containing the jobs
+ *
+ * wheel: the timer wheel idle checks are scheduled on
+ *
+ * reactor: the reactor the jobs are watched with
+ *
+ * verbose: whether jobthing is in verbose mode
+ */
+void advance_rollout(Jobs* jobs, TimerWheel* wheel, Reactor* reactor,
+        bool verbose);
@@ -11,3 +11,43 @@ void setup_sighandler(struct sigaction* sa, void (*handler)(int),
     sa->sa_flags = SA_RESTART;
     sigaction(signal, sa, 0);
 }
+
+int block_child_signals(void) {
+    return open_signalfd(SIGCHLD);
+}
+
+int block_report_signal(void) {
+    return open_signalfd(SIGHUP);
+}
+
+int open_signalfd(int signal) {
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, signal);
+    sigprocmask(SIG_BLOCK, &signals, NULL);
+    return signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+}
+
+void drain_signalfd(int fd) {
+    struct signalfd_siginfo info;
+    while (read(fd, &info, sizeof(info)) == sizeof(info)) {
+        continue;
+    }
+}
+
+int open_child_pidfd(pid_t pid) {
+#ifdef SYS_pidfd_open
+    return syscall(SYS_pidfd_open, pid, 0);
+#else
+    return -1;
+#endif
+}
+
+bool pidfds_supported(void) {
+    int pidFd = open_child_pidfd(getpid());
+    if (pidFd == -1) {
+        return false;
+    }
+    close(pidFd);
+    return true;
+}
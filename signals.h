@@ -12,6 +12,8 @@
 #include <fcntl.h>
 #include <ctype.h>
 #include <signal.h>
+#include <sys/signalfd.h>
+#include <sys/syscall.h>
 
 #endif //SIGNALS_H
 
@@ -34,4 +36,59 @@ void block_signal(int sig);
  */
 void setup_sighandler(struct sigaction* sa, void (*handler)(int), int signal);
 
+/* block_child_signals()
+ * ---------------------
+ * Blocks SIGCHLD and creates a signalfd that becomes readable whenever a 
+ * child changes state, so child exits can be waited on alongside other
+ * file descriptors. Must be called before any job is spawned.
+ *
+ * Returns: the signalfd, or -1 if it could not be created.
+ */
+int block_child_signals(void);
+
+/* block_report_signal()
+ * ----------------------
+ * Blocks SIGHUP and creates a signalfd that becomes readable when it is 
+ * received, so that the statistics it asks for are reported from the main
+ * loop rather than from a signal handler.
+ *
+ * Returns: the signalfd, or -1 if it could not be created.
+ */
+int block_report_signal(void);
 
+/* open_signalfd()
+ * ---------------
+ * Blocks a signal and creates a non-blocking signalfd for it.
+ *
+ * signal: the signal to be received through the signalfd.
+ *
+ * Returns: the signalfd, or -1 if it could not be created.
+ */
+int open_signalfd(int signal);
+
+/* drain_signalfd()
+ * ----------------
+ * Reads every pending signal from a signalfd so that it stops being 
+ * readable. Pending SIGCHLDs are merged, so the caller must check every
+ * child that may have exited.
+ *
+ * fd: the signalfd to drain.
+ */
+void drain_signalfd(int fd);
+
+/* open_child_pidfd()
+ * ------------------
+ * Opens a pidfd for a child process. The pidfd becomes readable once the 
+ * child exits, so each job's exit can be waited on individually.
+ *
+ * pid: the process id of the child.
+ *
+ * Returns: the pidfd, or -1 if pidfds are not supported by the kernel.
+ */
+int open_child_pidfd(pid_t pid);
+
+/* pidfds_supported()
+ * ------------------
+ * Returns: true if the kernel supports pidfd_open(), false otherwise.
+ */
+bool pidfds_supported(void);
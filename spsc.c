@@ -0,0 +1,56 @@
+#include "spsc.h"
+
+void init_spsc_ring(SpscRing* ring, size_t slotSize, size_t capacity) {
+    ring->capacity = 1;
+    while (ring->capacity < capacity) {
+        ring->capacity *= 2;
+    }
+    ring->slotSize = slotSize;
+    ring->slots = malloc(slotSize * ring->capacity);
+    ring->head = 0;
+    ring->tail = 0;
+}
+
+bool spsc_push(SpscRing* ring, const void* item) {
+    //The producer is the only writer of tail, so its own read needs no 
+    //ordering. Acquiring head makes sure the consumer is done with a slot
+    //before it is reused.
+    size_t tail = ring->tail;
+    if (tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == 
+            ring->capacity) {
+        return false;
+    }
+    memcpy(ring->slots + (tail & (ring->capacity - 1)) * ring->slotSize, 
+            item, ring->slotSize);
+    __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+void spsc_push_wait(SpscRing* ring, const void* item) {
+    while (!spsc_push(ring, item)) {
+        usleep(SPSC_WAIT_US);
+    }
+}
+
+void* spsc_peek(SpscRing* ring) {
+    size_t head = ring->head;
+    if (head == __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE)) {
+        return NULL;
+    }
+    return ring->slots + (head & (ring->capacity - 1)) * ring->slotSize;
+}
+
+bool spsc_pop(SpscRing* ring, void* item) {
+    void* slot = spsc_peek(ring);
+    if (!slot) {
+        return false;
+    }
+    memcpy(item, slot, ring->slotSize);
+    __atomic_store_n(&ring->head, ring->head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+void free_spsc_ring(SpscRing* ring) {
+    free(ring->slots);
+    ring->slots = NULL;
+}
@@ -0,0 +1,90 @@
+#ifndef SPSC_H
+#define SPSC_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+
+#define CACHE_LINE 64
+#define SPSC_WAIT_US 100
+
+//A lock-free ring of fixed size items passed from exactly one producer 
+//thread to exactly one consumer thread. head is only written by the 
+//consumer and tail only by the producer, each published with release 
+//ordering, so an item is fully written before it can be seen. They sit on
+//separate cache lines so the two threads do not contend for one. capacity
+//is a power of two, so positions wrap with a mask.
+typedef struct {
+    char* slots;
+    size_t slotSize;
+    size_t capacity;
+    size_t head __attribute__((aligned(CACHE_LINE)));
+    size_t tail __attribute__((aligned(CACHE_LINE)));
+} SpscRing;
+
+#endif //SPSC_H
+
+/* init_spsc_ring()
+ * ----------------
+ * Initialises an empty ring.
+ *
+ * ring: the ring to be initialised.
+ *
+ * slotSize: the size of each item.
+ *
+ * capacity: the most items the ring holds, rounded up to a power of two.
+ */
+void init_spsc_ring(SpscRing* ring, size_t slotSize, size_t capacity);
+
+/* spsc_push()
+ * -----------
+ * Adds an item to the ring. Only called by the producer.
+ *
+ * ring: the ring to add to.
+ *
+ * item: the item, which is copied.
+ *
+ * Returns: true if the item was added, false if the ring is full.
+ */
+bool spsc_push(SpscRing* ring, const void* item);
+
+/* spsc_push_wait()
+ * ----------------
+ * Adds an item to the ring, sleeping for SPSC_WAIT_US at a time while it is
+ * full. Only called by the producer, and only where the consumer never 
+ * waits on the producer, so that the two cannot wait on each other.
+ *
+ * ring: the ring to add to.
+ *
+ * item: the item, which is copied.
+ */
+void spsc_push_wait(SpscRing* ring, const void* item);
+
+/* spsc_peek()
+ * -----------
+ * Returns: the oldest item in the ring, which stays in place until it is 
+ * popped, or NULL if the ring is empty. Only called by the consumer.
+ */
+void* spsc_peek(SpscRing* ring);
+
+/* spsc_pop()
+ * ----------
+ * Takes the oldest item from the ring. Only called by the consumer.
+ *
+ * ring: the ring to take from.
+ *
+ * item: where the item is copied to.
+ *
+ * Returns: true if an item was taken, false if the ring is empty.
+ */
+bool spsc_pop(SpscRing* ring, void* item);
+
+/* free_spsc_ring()
+ * ----------------
+ * Frees the memory associated with a ring. Items still in it are dropped.
+ *
+ * ring: the ring to be freed.
+ */
+void free_spsc_ring(SpscRing* ring);
@@ -0,0 +1,40 @@
+#!/bin/sh
+# Regression test for the arguments a handover execs jobthing with: a 
+# jobthing started with -w size=4K hands over to itself, which must be run 
+# with the same arguments and carry on relaying.
+# Usage: tests/handoverargs.sh [jobthing]
+PROG=${1:-./jobthing}
+DIR=$(mktemp -d)
+trap 'rm -rf "$DIR"' EXIT
+
+echo ":::cat" > "$DIR/jobfile"
+mkfifo "$DIR/input"
+"$PROG" -w size=4K "$DIR/jobfile" < "$DIR/input" > "$DIR/output" 2>&1 &
+pid=$!
+(sleep 10; kill $pid 2> /dev/null) &
+watchdog=$!
+exec 3> "$DIR/input"
+echo one >&3
+echo "*handover" >&3
+sleep 1
+args=$(tr '\0' ' ' < /proc/$pid/cmdline)
+echo two >&3
+exec 3>&-
+wait $pid
+status=$?
+kill $watchdog 2> /dev/null
+
+case "$args" in
+    *" -w size=4K "*) ;;
+    *)
+        echo "handoverargs: FAIL (handed over to: $args)"
+        exit 1
+        ;;
+esac
+if [ $status -ne 0 ] || grep -q Error "$DIR/output" || 
+        ! grep -q "^1->'two'$" "$DIR/output"; then
+    echo "handoverargs: FAIL (exit $status)"
+    cat "$DIR/output"
+    exit 1
+fi
+echo "handoverargs: ok ($args)"
@@ -0,0 +1,28 @@
+#!/bin/sh
+# Regression test for the io_uring batches: more jobs than the completion
+# ring holds each get 50 input lines at once, and every line must be relayed
+# back exactly once. Usage: tests/uringjobs.sh [jobthing] [numJobs]
+PROG=${1:-./jobthing}
+NUM_JOBS=${2:-600}
+NUM_LINES=50
+DIR=$(mktemp -d)
+trap 'rm -rf "$DIR"' EXIT
+
+i=0
+while [ $i -lt $NUM_JOBS ]; do
+    echo "1:::cat"
+    i=$((i + 1))
+done > "$DIR/jobfile"
+seq $NUM_LINES > "$DIR/input"
+
+timeout 60 "$PROG" -n -u -i "$DIR/input" "$DIR/jobfile" > "$DIR/output" \
+        2> /dev/null
+status=$?
+relayed=$(grep -c -- '->' "$DIR/output")
+expected=$((NUM_JOBS * NUM_LINES))
+if [ $status -ne 0 ] || [ "$relayed" -ne $expected ]; then
+    echo "uringjobs: FAIL ($NUM_JOBS jobs, exit $status," \
+            "$relayed of $expected lines relayed)"
+    exit 1
+fi
+echo "uringjobs: ok ($NUM_JOBS jobs, $relayed lines relayed)"
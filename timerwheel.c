@@ -0,0 +1,159 @@
+#include "timerwheel.h"
+
+//slotOf holds one of these for timers that are not in a slot
+#define TIMER_IDLE -1
+#define TIMER_EXPIRED -2
+
+bool init_timer_wheel(TimerWheel* wheel) {
+    for (int i = 0; i < WHEEL_SLOTS; i++) {
+        wheel->slots[i] = NO_TIMER;
+    }
+    wheel->next = NULL;
+    wheel->prev = NULL;
+    wheel->slotOf = NULL;
+    wheel->rounds = NULL;
+    wheel->capacity = 0;
+    wheel->expired = NO_TIMER;
+    wheel->numPending = 0;
+    wheel->startMs = now_ms();
+    wheel->currentTick = 0;
+    wheel->timerFd = timerfd_create(CLOCK_MONOTONIC, 
+            TFD_NONBLOCK | TFD_CLOEXEC);
+    return wheel->timerFd != -1;
+}
+
+void ensure_timer_capacity(TimerWheel* wheel, int id) {
+    if (id < wheel->capacity) {
+        return;
+    }
+    int capacity = wheel->capacity ? wheel->capacity : INITIAL_TIMER_CAPACITY;
+    while (capacity <= id) {
+        capacity *= 2;
+    }
+    wheel->next = realloc(wheel->next, sizeof(int) * capacity);
+    wheel->prev = realloc(wheel->prev, sizeof(int) * capacity);
+    wheel->slotOf = realloc(wheel->slotOf, sizeof(int) * capacity);
+    wheel->rounds = realloc(wheel->rounds, sizeof(int) * capacity);
+    for (int i = wheel->capacity; i < capacity; i++) {
+        wheel->slotOf[i] = TIMER_IDLE;
+    }
+    wheel->capacity = capacity;
+}
+
+void unlink_timer(TimerWheel* wheel, int id) {
+    int slot = wheel->slotOf[id];
+    if (wheel->prev[id] != NO_TIMER) {
+        wheel->next[wheel->prev[id]] = wheel->next[id];
+    } else {
+        wheel->slots[slot] = wheel->next[id];
+    }
+    if (wheel->next[id] != NO_TIMER) {
+        wheel->prev[wheel->next[id]] = wheel->prev[id];
+    }
+    wheel->slotOf[id] = TIMER_IDLE;
+}
+
+void schedule_timer(TimerWheel* wheel, int id, long long delayMs) {
+    ensure_timer_capacity(wheel, id);
+    cancel_timer(wheel, id);
+
+    //The current tick has already been processed, so a timer always lands
+    //at least one tick ahead.
+    long long ticks = (delayMs + WHEEL_TICK_MS - 1) / WHEEL_TICK_MS;
+    long long elapsedTicks = (now_ms() - wheel->startMs) / WHEEL_TICK_MS;
+    long long expiresTick = (elapsedTicks > wheel->currentTick ? 
+            elapsedTicks : wheel->currentTick) + (ticks ? ticks : 1);
+    long long turns = (expiresTick - wheel->currentTick - 1) / WHEEL_SLOTS;
+    int slot = expiresTick % WHEEL_SLOTS;
+
+    wheel->rounds[id] = turns;
+    wheel->slotOf[id] = slot;
+    wheel->prev[id] = NO_TIMER;
+    wheel->next[id] = wheel->slots[slot];
+    if (wheel->slots[slot] != NO_TIMER) {
+        wheel->prev[wheel->slots[slot]] = id;
+    }
+    wheel->slots[slot] = id;
+    if (wheel->numPending++ == 0) {
+        arm_timer_wheel(wheel, true);
+    }
+}
+
+void cancel_timer(TimerWheel* wheel, int id) {
+    if (id >= wheel->capacity || wheel->slotOf[id] == TIMER_IDLE) {
+        return;
+    }
+    if (wheel->slotOf[id] == TIMER_EXPIRED) {
+        //Expired timers are singly linked through next
+        int* link = &wheel->expired;
+        while (*link != id) {
+            link = &wheel->next[*link];
+        }
+        *link = wheel->next[id];
+        wheel->slotOf[id] = TIMER_IDLE;
+        return;
+    }
+    unlink_timer(wheel, id);
+    if (--wheel->numPending == 0) {
+        arm_timer_wheel(wheel, false);
+    }
+}
+
+bool timer_pending(TimerWheel* wheel, int id) {
+    return id < wheel->capacity && wheel->slotOf[id] != TIMER_IDLE;
+}
+
+void advance_timer_wheel(TimerWheel* wheel) {
+    uint64_t expirations;
+    read(wheel->timerFd, &expirations, sizeof(expirations));
+
+    long long nowTick = (now_ms() - wheel->startMs) / WHEEL_TICK_MS;
+    while (wheel->currentTick < nowTick && wheel->numPending) {
+        int slot = ++wheel->currentTick % WHEEL_SLOTS;
+        int id = wheel->slots[slot];
+        while (id != NO_TIMER) {
+            int next = wheel->next[id];
+            if (wheel->rounds[id]-- == 0) {
+                unlink_timer(wheel, id);
+                wheel->numPending--;
+                wheel->slotOf[id] = TIMER_EXPIRED;
+                wheel->next[id] = wheel->expired;
+                wheel->expired = id;
+            }
+            id = next;
+        }
+    }
+    //Ticks with nothing pending need not be visited one at a time
+    if (wheel->currentTick < nowTick) {
+        wheel->currentTick = nowTick;
+    }
+    if (!wheel->numPending) {
+        arm_timer_wheel(wheel, false);
+    }
+}
+
+int pop_expired_timer(TimerWheel* wheel) {
+    int id = wheel->expired;
+    if (id != NO_TIMER) {
+        wheel->expired = wheel->next[id];
+        wheel->slotOf[id] = TIMER_IDLE;
+    }
+    return id;
+}
+
+void arm_timer_wheel(TimerWheel* wheel, bool ticking) {
+    struct itimerspec spec = {0};
+    if (ticking) {
+        spec.it_value.tv_nsec = WHEEL_TICK_MS * NS_PER_MS;
+        spec.it_interval.tv_nsec = WHEEL_TICK_MS * NS_PER_MS;
+    }
+    timerfd_settime(wheel->timerFd, 0, &spec, NULL);
+}
+
+void free_timer_wheel(TimerWheel* wheel) {
+    free(wheel->next);
+    free(wheel->prev);
+    free(wheel->slotOf);
+    free(wheel->rounds);
+    close(wheel->timerFd);
+}
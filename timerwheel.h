@@ -0,0 +1,137 @@
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include "helper.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <sys/timerfd.h>
+
+#define NO_TIMER -1
+#define WHEEL_TICK_MS 10
+//Enough slots to cover the longest restart delay in a single turn, so that
+//almost every timer expires the first time its slot comes round.
+#define WHEEL_SLOTS 4096
+#define INITIAL_TIMER_CAPACITY 64
+
+//A hashed timing wheel of one-shot timers. Each timer is identified by a 
+//small integer id (a job index) and linked into the slot of the tick it 
+//expires on through the next and prev arrays, so scheduling and cancelling
+//are O(1) and each tick only visits the timers in one slot. Timers further
+//away than one turn of the wheel wait out the extra turns in rounds. The 
+//timerfd ticks while any timer is pending and is watched by the reactor.
+typedef struct {
+    int slots[WHEEL_SLOTS];
+    int* next;
+    int* prev;
+    int* slotOf;
+    int* rounds;
+    int capacity;
+    int expired;
+    int numPending;
+    long long startMs;
+    long long currentTick;
+    int timerFd;
+} TimerWheel;
+
+#endif //TIMERWHEEL_H
+
+/* init_timer_wheel()
+ * ------------------
+ * Initialises an empty timer wheel and creates its timerfd.
+ *
+ * wheel: the timer wheel to be initialised.
+ *
+ * Returns: true if the timerfd was created, false otherwise.
+ */
+bool init_timer_wheel(TimerWheel* wheel);
+
+/* schedule_timer()
+ * ----------------
+ * Starts a timer, replacing it if it is already pending.
+ *
+ * wheel: the timer wheel to add the timer to.
+ *
+ * id: the non-negative id of the timer.
+ *
+ * delayMs: the time until the timer expires in milliseconds. It is rounded
+ * up to a whole number of ticks.
+ */
+void schedule_timer(TimerWheel* wheel, int id, long long delayMs);
+
+/* cancel_timer()
+ * --------------
+ * Stops a timer if it is pending.
+ *
+ * wheel: the timer wheel the timer belongs to.
+ *
+ * id: the id of the timer.
+ */
+void cancel_timer(TimerWheel* wheel, int id);
+
+/* timer_pending()
+ * ---------------
+ * Returns: true if the timer with the given id is pending or has expired 
+ * without being popped, false otherwise.
+ */
+bool timer_pending(TimerWheel* wheel, int id);
+
+/* advance_timer_wheel()
+ * ---------------------
+ * Moves the wheel forward to the current time, collecting every timer that
+ * has expired so that pop_expired_timer() can return them. Expirations of
+ * the timerfd are consumed.
+ *
+ * wheel: the timer wheel to advance.
+ */
+void advance_timer_wheel(TimerWheel* wheel);
+
+/* pop_expired_timer()
+ * -------------------
+ * Takes one expired timer from the wheel.
+ *
+ * wheel: the timer wheel to take the timer from.
+ *
+ * Returns: the id of the expired timer, or NO_TIMER if none have expired.
+ */
+int pop_expired_timer(TimerWheel* wheel);
+
+/* ensure_timer_capacity()
+ * -----------------------
+ * Grows the per-timer arrays so that ids up to id can be used.
+ *
+ * wheel: the timer wheel to be grown.
+ *
+ * id: the largest id that will be used.
+ */
+void ensure_timer_capacity(TimerWheel* wheel, int id);
+
+/* unlink_timer()
+ * --------------
+ * Removes a pending timer from its slot.
+ *
+ * wheel: the timer wheel the timer belongs to.
+ *
+ * id: the id of the timer.
+ */
+void unlink_timer(TimerWheel* wheel, int id);
+
+/* arm_timer_wheel()
+ * -----------------
+ * Starts or stops the timerfd ticking.
+ *
+ * wheel: the timer wheel whose timerfd is to be changed.
+ *
+ * ticking: true to tick every WHEEL_TICK_MS, false to stop.
+ */
+void arm_timer_wheel(TimerWheel* wheel, bool ticking);
+
+/* free_timer_wheel()
+ * ------------------
+ * Frees the memory and closes the timerfd of a timer wheel.
+ *
+ * wheel: the timer wheel to be freed.
+ */
+void free_timer_wheel(TimerWheel* wheel);
@@ -0,0 +1,146 @@
+#include "uring.h"
+
+bool init_uring(Uring* uring, unsigned entries, int numFiles) {
+    memset(uring, 0, sizeof(Uring));
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    uring->ringFd = syscall(__NR_io_uring_setup, entries, &params);
+    if (uring->ringFd == -1) {
+        return false;
+    }
+
+    //With IORING_FEAT_SINGLE_MMAP both rings share one mapping
+    uring->sqRingSize = params.sq_off.array + 
+            params.sq_entries * sizeof(unsigned);
+    uring->cqRingSize = params.cq_off.cqes + 
+            params.cq_entries * sizeof(struct io_uring_cqe);
+    bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single && uring->cqRingSize > uring->sqRingSize) {
+        uring->sqRingSize = uring->cqRingSize;
+    }
+    uring->sqRing = mmap(NULL, uring->sqRingSize, PROT_READ | PROT_WRITE, 
+            MAP_SHARED | MAP_POPULATE, uring->ringFd, IORING_OFF_SQ_RING);
+    uring->cqRing = single ? uring->sqRing : mmap(NULL, uring->cqRingSize,
+            PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, 
+            uring->ringFd, IORING_OFF_CQ_RING);
+    uring->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    uring->sqes = mmap(NULL, uring->sqesSize, PROT_READ | PROT_WRITE, 
+            MAP_SHARED | MAP_POPULATE, uring->ringFd, IORING_OFF_SQES);
+    if (uring->sqRing == MAP_FAILED || uring->cqRing == MAP_FAILED || 
+            uring->sqes == MAP_FAILED) {
+        close(uring->ringFd);
+        return false;
+    }
+
+    char* sq = uring->sqRing;
+    uring->sqHead = (unsigned*) (sq + params.sq_off.head);
+    uring->sqTail = (unsigned*) (sq + params.sq_off.tail);
+    uring->sqArray = (unsigned*) (sq + params.sq_off.array);
+    uring->sqMask = *(unsigned*) (sq + params.sq_off.ring_mask);
+    uring->sqEntries = params.sq_entries;
+    char* cq = uring->cqRing;
+    uring->cqHead = (unsigned*) (cq + params.cq_off.head);
+    uring->cqTail = (unsigned*) (cq + params.cq_off.tail);
+    uring->cqMask = *(unsigned*) (cq + params.cq_off.ring_mask);
+    uring->cqEntries = params.cq_entries;
+    uring->cqes = (struct io_uring_cqe*) (cq + params.cq_off.cqes);
+
+    //Slots start empty, and are filled as files are opened
+    int* fds = malloc(sizeof(int) * numFiles);
+    for (int i = 0; i < numFiles; i++) {
+        fds[i] = -1;
+    }
+    if (numFiles && syscall(__NR_io_uring_register, uring->ringFd, 
+            IORING_REGISTER_FILES, fds, numFiles) == 0) {
+        uring->numFiles = numFiles;
+    }
+    free(fds);
+    return true;
+}
+
+void uring_set_file(Uring* uring, int slot, int fd) {
+    if (slot < 0 || slot >= uring->numFiles) {
+        return;
+    }
+    struct io_uring_files_update update;
+    memset(&update, 0, sizeof(update));
+    update.offset = slot;
+    update.fds = (unsigned long) &fd;
+    syscall(__NR_io_uring_register, uring->ringFd, 
+            IORING_REGISTER_FILES_UPDATE, &update, 1);
+}
+
+bool uring_full(Uring* uring) {
+    //A result left on a full completion ring would be lost
+    return uring->numInFlight >= uring->sqEntries || 
+            uring->numInFlight >= uring->cqEntries;
+}
+
+void uring_prep(Uring* uring, int opcode, int fd, int slot, void* addr, 
+        unsigned length, unsigned long long userData) {
+    unsigned tail = *uring->sqTail;
+    unsigned index = tail & uring->sqMask;
+    struct io_uring_sqe* sqe = &uring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = opcode;
+    if (slot >= 0 && slot < uring->numFiles) {
+        sqe->fd = slot;
+        sqe->flags = IOSQE_FIXED_FILE;
+    } else {
+        sqe->fd = fd;
+    }
+    //Reads and writes at the file's current position, as read() does
+    sqe->off = (unsigned long long) -1;
+    //Operations that would block fail with -EAGAIN rather than waiting
+    sqe->rw_flags = RWF_NOWAIT;
+    sqe->addr = (unsigned long) addr;
+    sqe->len = length;
+    sqe->user_data = userData;
+    uring->sqArray[index] = index;
+    __atomic_store_n(uring->sqTail, tail + 1, __ATOMIC_RELEASE);
+    uring->numQueued++;
+    uring->numInFlight++;
+}
+
+void uring_submit(Uring* uring) {
+    while (uring->numQueued) {
+        uring->numEnters++;
+        int numSubmitted = syscall(__NR_io_uring_enter, uring->ringFd, 
+                uring->numQueued, uring->numQueued, IORING_ENTER_GETEVENTS,
+                NULL, 0);
+        if (numSubmitted == -1 && errno == EINTR) {
+            continue;
+        } else if (numSubmitted <= 0) {
+            //Left queued, to go with the next submission
+            return;
+        }
+        uring->numQueued -= numSubmitted;
+    }
+}
+
+bool uring_next_result(Uring* uring, unsigned long long* userData, 
+        int* result) {
+    unsigned head = *uring->cqHead;
+    if (head == __atomic_load_n(uring->cqTail, __ATOMIC_ACQUIRE)) {
+        return false;
+    }
+    struct io_uring_cqe* cqe = &uring->cqes[head & uring->cqMask];
+    *userData = cqe->user_data;
+    *result = cqe->res;
+    uring->numInFlight--;
+    __atomic_store_n(uring->cqHead, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+void close_uring(Uring* uring) {
+    if (uring->ringFd == -1) {
+        return;
+    }
+    munmap(uring->sqes, uring->sqesSize);
+    if (uring->cqRing != uring->sqRing) {
+        munmap(uring->cqRing, uring->cqRingSize);
+    }
+    munmap(uring->sqRing, uring->sqRingSize);
+    close(uring->ringFd);
+    uring->ringFd = -1;
+}
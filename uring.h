@@ -0,0 +1,142 @@
+#ifndef URING_H
+#define URING_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+#define URING_ENTRIES 256
+#define NO_FILE_SLOT -1
+
+//A minimal io_uring, driven with the raw system calls. Operations are 
+//queued on the submission ring and submitted in one io_uring_enter(), and
+//their results are taken off the completion ring. The rings are shared 
+//with the kernel, so the kernel's ends are read with acquire and ours are
+//published with release ordering. numInFlight counts the operations queued
+//whose results have not yet been taken, which must fit in both rings. Files
+//may be registered in numFiles slots so that operations on them skip the 
+//kernel's file lookup. numEnters counts the io_uring_enter() calls made.
+typedef struct {
+    int ringFd;
+    void* sqRing;
+    size_t sqRingSize;
+    void* cqRing;
+    size_t cqRingSize;
+    struct io_uring_sqe* sqes;
+    size_t sqesSize;
+    unsigned* sqHead;
+    unsigned* sqTail;
+    unsigned* sqArray;
+    unsigned sqMask;
+    unsigned sqEntries;
+    unsigned* cqHead;
+    unsigned* cqTail;
+    unsigned cqMask;
+    unsigned cqEntries;
+    struct io_uring_cqe* cqes;
+    unsigned numQueued;
+    unsigned numInFlight;
+    int numFiles;
+    unsigned long long numEnters;
+} Uring;
+
+#endif //URING_H
+
+/* init_uring()
+ * ------------
+ * Creates an io_uring and maps its rings, and registers a table of empty 
+ * file slots.
+ *
+ * uring: the ring to be initialised.
+ *
+ * entries: the size of the submission ring.
+ *
+ * numFiles: the number of file slots. If they cannot be registered, files 
+ * are used without registering them.
+ *
+ * Returns: true if the ring was created, false if io_uring is unavailable.
+ */
+bool init_uring(Uring* uring, unsigned entries, int numFiles);
+
+/* uring_set_file()
+ * ----------------
+ * Registers a file in a slot, replacing what was there. The slot holds its
+ * own reference to the file, so a file that is closed must also be taken
+ * out of its slot for it to be released.
+ *
+ * uring: the ring whose slot is set.
+ *
+ * slot: the slot to be set.
+ *
+ * fd: the file to be registered, or -1 to empty the slot.
+ */
+void uring_set_file(Uring* uring, int slot, int fd);
+
+/* uring_full()
+ * ------------
+ * Returns: true if no more operations can be queued until those queued have
+ * been submitted and their results taken, as either ring would overflow,
+ * false otherwise.
+ */
+bool uring_full(Uring* uring);
+
+/* uring_prep()
+ * ------------
+ * Queues an operation. The ring must not be full.
+ *
+ * uring: the ring the operation is queued on.
+ *
+ * opcode: the operation, e.g., IORING_OP_READ.
+ *
+ * fd: the file operated on.
+ *
+ * slot: the file's registered slot, or NO_FILE_SLOT.
+ *
+ * addr: the buffer, or array of iovecs.
+ *
+ * length: the length of the buffer, or number of iovecs.
+ *
+ * userData: returned with the operation's result.
+ */
+void uring_prep(Uring* uring, int opcode, int fd, int slot, void* addr, 
+        unsigned length, unsigned long long userData);
+
+/* uring_submit()
+ * --------------
+ * Submits every queued operation and waits for them all to complete. 
+ * Operations on non-blocking files complete straight away, with -EAGAIN if
+ * they would have blocked.
+ *
+ * uring: the ring to be submitted.
+ */
+void uring_submit(Uring* uring);
+
+/* uring_next_result()
+ * -------------------
+ * Takes the next completed operation off the completion ring.
+ *
+ * uring: the ring to take the result from.
+ *
+ * userData: set to the user data the operation was queued with.
+ *
+ * result: set to the operation's result, a negated errno on failure.
+ *
+ * Returns: true if there was a result, false otherwise.
+ */
+bool uring_next_result(Uring* uring, unsigned long long* userData, 
+        int* result);
+
+/* close_uring()
+ * -------------
+ * Unmaps the rings and closes the io_uring.
+ *
+ * uring: the ring to be closed.
+ */
+void close_uring(Uring* uring);
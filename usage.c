@@ -0,0 +1,30 @@
+#include "usage.h"
+
+void init_usage(Usage* usage) {
+    usage->userUs = 0;
+    usage->systemUs = 0;
+    usage->maxRssKb = 0;
+    usage->majorFaults = 0;
+    usage->voluntarySwitches = 0;
+    usage->involuntarySwitches = 0;
+    usage->inBlocks = 0;
+    usage->outBlocks = 0;
+}
+
+void add_usage(Usage* usage, struct rusage* process) {
+    usage->userUs += timeval_us(&process->ru_utime);
+    usage->systemUs += timeval_us(&process->ru_stime);
+    if (process->ru_maxrss > usage->maxRssKb) {
+        usage->maxRssKb = process->ru_maxrss;
+    }
+    usage->majorFaults += process->ru_majflt;
+    usage->voluntarySwitches += process->ru_nvcsw;
+    usage->involuntarySwitches += process->ru_nivcsw;
+    usage->inBlocks += process->ru_inblock;
+    usage->outBlocks += process->ru_oublock;
+}
+
+unsigned long long timeval_us(struct timeval* time) {
+    return (unsigned long long) time->tv_sec * US_PER_SECOND + 
+            time->tv_usec;
+}
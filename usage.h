@@ -0,0 +1,54 @@
+#ifndef USAGE_H
+#define USAGE_H
+
+#include "helper.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+//ru_inblock and ru_oublock count blocks of this many bytes
+#define USAGE_BLOCK_SIZE 512
+
+//The resources used by every process of a job that has exited, totalled
+//from the rusage each one is reaped with. maxRssKb is the largest peak
+//resident set size of any of them, in kilobytes, and the block counts are
+//of reads from and writes to storage.
+typedef struct {
+    unsigned long long userUs;
+    unsigned long long systemUs;
+    long maxRssKb;
+    unsigned long long majorFaults;
+    unsigned long long voluntarySwitches;
+    unsigned long long involuntarySwitches;
+    unsigned long long inBlocks;
+    unsigned long long outBlocks;
+} Usage;
+
+#endif //USAGE_H
+
+/* init_usage()
+ * ------------
+ * Initialises usage totals to nothing used.
+ *
+ * usage: the totals to be initialised.
+ */
+void init_usage(Usage* usage);
+
+/* add_usage()
+ * -----------
+ * Adds what a reaped process used to the totals.
+ *
+ * usage: the totals to be added to.
+ *
+ * process: the rusage the process was reaped with.
+ */
+void add_usage(Usage* usage, struct rusage* process);
+
+/* timeval_us()
+ * ------------
+ * Returns: the time as a number of microseconds.
+ */
+unsigned long long timeval_us(struct timeval* time);
@@ -0,0 +1,233 @@
+#include "writer.h"
+#include "helper.h"
+
+Writer output;
+
+void init_writer(Writer* writer, int fd, FlushPolicy policy, 
+        size_t flushSize, long long deadlineMs) {
+    writer->fd = fd;
+    writer->capacity = WRITER_CAPACITY;
+    writer->data = malloc(writer->capacity);
+    writer->length = 0;
+    writer->policy = policy;
+    writer->flushSize = flushSize && flushSize < WRITER_CAPACITY ? 
+            flushSize : WRITER_CAPACITY;
+    writer->deadlineMs = deadlineMs;
+    writer->firstPendingMs = 0;
+    writer->flush = write_all;
+    writer->context = NULL;
+    writer->numWrites = 0;
+    writer->bytesWritten = 0;
+    writer->framed = false;
+    init_line_buffer(&writer->messages);
+}
+
+bool parse_flush_policy(char* value, FlushPolicy* policy, size_t* flushSize,
+        long long* deadlineMs) {
+    //A copy is split, as value is one of the arguments a handover execs 
+    //jobthing with again
+    char* name = strdup(value);
+    char* setting = strchr(name, '=');
+    if (setting) {
+        *setting++ = '\0';
+    }
+    bool valid = true;
+    if (!strcmp(name, "line") && !setting) {
+        *policy = FLUSH_EVERY_LINE;
+    } else if (!strcmp(name, "idle") && !setting) {
+        *policy = FLUSH_ON_IDLE;
+    } else if (!strcmp(name, "size")) {
+        *policy = FLUSH_ON_SIZE;
+        valid = !setting || (parse_size(setting, flushSize) && *flushSize);
+    } else if (!strcmp(name, "deadline")) {
+        *policy = FLUSH_ON_DEADLINE;
+        valid = !setting || parse_duration(setting, deadlineMs);
+    } else {
+        valid = false;
+    }
+    free(name);
+    return valid;
+}
+
+void write_relay_line(Writer* writer, int jobNumber, const char* arrow, 
+        const char* line, size_t length) {
+    if (writer->framed) {
+        write_relay_record(writer, jobNumber, arrow[0] == '<' ? RECORD_ECHO :
+                RECORD_ANSWER, line, length);
+        return;
+    }
+    //Number, arrow, two quotes and a newline around the line itself
+    reserve_writer(writer, MAX_INT_DIGITS + length + 5);
+
+    char* out = writer->data + writer->length;
+    out += format_int(out, jobNumber);
+    *out++ = arrow[0];
+    *out++ = arrow[1];
+    *out++ = '\'';
+    memcpy(out, line, length);
+    out += length;
+    *out++ = '\'';
+    *out++ = '\n';
+    writer->length = out - writer->data;
+    writer_record_done(writer);
+}
+
+void write_relay_record(Writer* writer, int jobNumber, char kind, 
+        const char* data, size_t length) {
+    reserve_writer(writer, RELAY_HEADER_LENGTH + length);
+    char* out = writer->data + writer->length;
+    put_frame_length(out, RELAY_HEADER_LENGTH - FRAME_HEADER_LENGTH + length);
+    put_frame_length(out + FRAME_HEADER_LENGTH, jobNumber);
+    out[FRAME_HEADER_LENGTH * 2] = kind;
+    memcpy(out + RELAY_HEADER_LENGTH, data, length);
+    writer->length += RELAY_HEADER_LENGTH + length;
+    writer_record_done(writer);
+}
+
+void reserve_writer(Writer* writer, size_t length) {
+    if (writer->capacity - writer->length < length) {
+        flush_writer(writer);
+        if (writer->capacity < length) {
+            writer->capacity = length;
+            writer->data = realloc(writer->data, writer->capacity);
+        }
+    }
+}
+
+void writer_printf(Writer* writer, const char* format, ...) {
+    va_list args;
+    if (writer->framed) {
+        char* text;
+        va_start(args, format);
+        int length = vasprintf(&text, format, args);
+        va_end(args);
+        if (length > 0) {
+            append_line_buffer(&writer->messages, text, length);
+        }
+        if (length >= 0) {
+            free(text);
+        }
+        char* line;
+        size_t lineLength;
+        while ((line = next_line(&writer->messages, &lineLength))) {
+            write_relay_record(writer, MESSAGE_JOB_NUMBER, RECORD_MESSAGE, 
+                    line, lineLength);
+        }
+        return;
+    }
+    va_start(args, format);
+    int length = vsnprintf(writer->data + writer->length, 
+            writer->capacity - writer->length, format, args);
+    va_end(args);
+    if (length >= 0 && (size_t) length >= writer->capacity - writer->length) {
+        //Did not fit, so it is formatted again into a big enough buffer
+        char* message = malloc(length + 1);
+        va_start(args, format);
+        vsnprintf(message, length + 1, format, args);
+        va_end(args);
+        writer_append(writer, message, length);
+        free(message);
+    } else if (length > 0) {
+        writer->length += length;
+    }
+    writer_record_done(writer);
+}
+
+void writer_append(Writer* writer, const char* bytes, size_t length) {
+    reserve_writer(writer, length);
+    memcpy(writer->data + writer->length, bytes, length);
+    writer->length += length;
+}
+
+int format_int(char* buffer, long long value) {
+    char digits[MAX_INT_DIGITS];
+    int numDigits = 0;
+    int length = 0;
+    unsigned long long magnitude = value;
+    if (value < 0) {
+        buffer[length++] = '-';
+        magnitude = -(unsigned long long) value;
+    }
+    do {
+        digits[numDigits++] = '0' + magnitude % 10;
+        magnitude /= 10;
+    } while (magnitude);
+    while (numDigits) {
+        buffer[length++] = digits[--numDigits];
+    }
+    return length;
+}
+
+void writer_record_done(Writer* writer) {
+    if (!writer->length) {
+        return;
+    }
+    if (writer->policy == FLUSH_EVERY_LINE || 
+            writer->length >= writer->flushSize) {
+        flush_writer(writer);
+    } else if (!writer->firstPendingMs) {
+        writer->firstPendingMs = now_ms();
+    }
+}
+
+void writer_idle(Writer* writer) {
+    if (writer->policy == FLUSH_ON_IDLE && writer->length) {
+        flush_writer(writer);
+    }
+}
+
+int writer_timeout(Writer* writer) {
+    if (writer->policy != FLUSH_ON_DEADLINE || !writer->length) {
+        return NO_DEADLINE;
+    }
+    long long remaining = writer->firstPendingMs + writer->deadlineMs - 
+            now_ms();
+    return remaining > 0 ? remaining : 0;
+}
+
+void writer_check_deadline(Writer* writer) {
+    if (writer_timeout(writer) == 0) {
+        flush_writer(writer);
+    }
+}
+
+bool flush_writer(Writer* writer) {
+    bool written = !writer->length || writer->flush(writer);
+    writer->length = 0;
+    writer->firstPendingMs = 0;
+    return written;
+}
+
+bool write_all(Writer* writer) {
+    size_t numWritten = 0;
+    while (numWritten < writer->length) {
+        ssize_t result = write(writer->fd, writer->data + numWritten, 
+                writer->length - numWritten);
+        if (result > 0) {
+            numWritten += result;
+            writer->bytesWritten += result;
+            writer->numWrites++;
+        } else if (result == -1 && errno == EAGAIN) {
+            struct pollfd writable = {.fd = writer->fd, .events = POLLOUT};
+            poll(&writable, 1, -1);
+        } else if (result == -1 && errno != EINTR) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void free_writer(Writer* writer) {
+    //A message left without its newline still goes out as a record
+    writer->messages.eof = true;
+    char* line;
+    size_t length;
+    while (writer->framed && (line = next_line(&writer->messages, &length))) {
+        write_relay_record(writer, MESSAGE_JOB_NUMBER, RECORD_MESSAGE, line,
+                length);
+    }
+    free_line_buffer(&writer->messages);
+    flush_writer(writer);
+    free(writer->data);
+    writer->data = NULL;
+}
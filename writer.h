@@ -0,0 +1,239 @@
+#ifndef WRITER_H
+#define WRITER_H
+
+#include "frame.h"
+#include "linebuf.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+
+#define WRITER_CAPACITY (64 * 1024)
+#define DEFAULT_FLUSH_DEADLINE_MS 50
+#define MAX_INT_DIGITS 12
+#define NO_DEADLINE -1
+
+//When buffered output is written out. Output is always written once the
+//flush size is reached, and before jobthing exits.
+typedef enum {
+    FLUSH_EVERY_LINE,
+    FLUSH_ON_IDLE,
+    FLUSH_ON_SIZE,
+    FLUSH_ON_DEADLINE
+} FlushPolicy;
+
+//Buffers everything jobthing writes to standard output so that many lines
+//go out in one write(). flush writes out the buffer and may be replaced, 
+//e.g., to hand the buffer to another thread. firstPendingMs is when the 
+//oldest buffered output was added, for FLUSH_ON_DEADLINE. context is for
+//a replacement flush to find where the buffer goes. A framed writer writes
+//relayed records rather than lines, and keeps the text of messages in 
+//messages until each line of it is complete and can be written as a 
+//record.
+typedef struct Writer {
+    int fd;
+    char* data;
+    size_t length;
+    size_t capacity;
+    FlushPolicy policy;
+    size_t flushSize;
+    long long deadlineMs;
+    long long firstPendingMs;
+    bool (*flush)(struct Writer*);
+    void* context;
+    unsigned long long numWrites;
+    unsigned long long bytesWritten;
+    bool framed;
+    LineBuffer messages;
+} Writer;
+
+//The writer for standard output, which every part of jobthing shares
+extern Writer output;
+
+#endif //WRITER_H
+
+/* init_writer()
+ * -------------
+ * Initialises a writer with an empty buffer.
+ *
+ * writer: the writer to be initialised.
+ *
+ * fd: the file descriptor output is written to.
+ *
+ * policy: when buffered output is written.
+ *
+ * flushSize: the amount of buffered output that is always written, at most
+ * WRITER_CAPACITY. 0 means WRITER_CAPACITY.
+ *
+ * deadlineMs: for FLUSH_ON_DEADLINE, the longest output may stay buffered.
+ */
+void init_writer(Writer* writer, int fd, FlushPolicy policy, 
+        size_t flushSize, long long deadlineMs);
+
+/* parse_flush_policy()
+ * --------------------
+ * Parses a flush policy: "line", "idle", "size[=bytes]" or 
+ * "deadline[=duration]", e.g., "size=256K" or "deadline=20ms".
+ *
+ * value: the policy. It is modified by parsing.
+ *
+ * policy: set to the policy.
+ *
+ * flushSize: set to the flush size given, or left unchanged.
+ *
+ * deadlineMs: set to the deadline given, or left unchanged.
+ *
+ * Returns: true if the policy is valid, false otherwise.
+ */
+bool parse_flush_policy(char* value, FlushPolicy* policy, size_t* flushSize,
+        long long* deadlineMs);
+
+/* write_relay_line()
+ * ------------------
+ * Buffers a line relayed to or from a job in the form N->'line' or 
+ * N<-'line', without going through printf(). A framed writer buffers it as
+ * a relayed record instead.
+ *
+ * writer: the writer to buffer the line in.
+ *
+ * jobNumber: the number of the job.
+ *
+ * arrow: "->" for output from the job or "<-" for input to it.
+ *
+ * line: the line, without its newline.
+ *
+ * length: the length of the line.
+ */
+void write_relay_line(Writer* writer, int jobNumber, const char* arrow, 
+        const char* line, size_t length);
+
+/* write_relay_record()
+ * --------------------
+ * Buffers a relayed record, as described in frame.h.
+ *
+ * writer: the writer to buffer the record in.
+ *
+ * jobNumber: the number of the job, or MESSAGE_JOB_NUMBER.
+ *
+ * kind: RECORD_ANSWER, RECORD_ECHO or RECORD_MESSAGE.
+ *
+ * data: the data of the record.
+ *
+ * length: the length of the data.
+ */
+void write_relay_record(Writer* writer, int jobNumber, char kind, 
+        const char* data, size_t length);
+
+/* reserve_writer()
+ * ----------------
+ * Makes room for length more bytes in a writer's buffer, flushing it if 
+ * they do not fit and growing it if they still would not.
+ *
+ * writer: the writer to make room in.
+ *
+ * length: the number of bytes about to be buffered.
+ */
+void reserve_writer(Writer* writer, size_t length);
+
+/* writer_printf()
+ * ---------------
+ * Buffers formatted output, for messages that are not on the hot path. A 
+ * framed writer writes each line of the output as a message record once 
+ * the line is complete.
+ *
+ * writer: the writer to buffer the output in.
+ *
+ * format: the printf() format.
+ */
+void writer_printf(Writer* writer, const char* format, ...);
+
+/* writer_append()
+ * ---------------
+ * Buffers bytes without checking the flush policy.
+ *
+ * writer: the writer to buffer the bytes in.
+ *
+ * bytes: the bytes to be buffered.
+ *
+ * length: the number of bytes.
+ */
+void writer_append(Writer* writer, const char* bytes, size_t length);
+
+/* format_int()
+ * ------------
+ * Writes the decimal digits of an integer.
+ *
+ * buffer: where the digits are written, with room for MAX_INT_DIGITS.
+ *
+ * value: the integer.
+ *
+ * Returns: the number of characters written.
+ */
+int format_int(char* buffer, long long value);
+
+/* writer_record_done()
+ * --------------------
+ * Applies the flush policy once a whole record (usually a line) has been
+ * buffered.
+ *
+ * writer: the writer the record was buffered in.
+ */
+void writer_record_done(Writer* writer);
+
+/* writer_idle()
+ * -------------
+ * Tells the writer jobthing is about to wait for events, at which point 
+ * FLUSH_ON_IDLE output is written.
+ *
+ * writer: the writer that may be flushed.
+ */
+void writer_idle(Writer* writer);
+
+/* writer_timeout()
+ * ----------------
+ * Returns: how long jobthing may wait before FLUSH_ON_DEADLINE output must 
+ * be written, or NO_DEADLINE if there is no deadline pending.
+ */
+int writer_timeout(Writer* writer);
+
+/* writer_check_deadline()
+ * -----------------------
+ * Writes FLUSH_ON_DEADLINE output whose deadline has passed.
+ *
+ * writer: the writer to be checked.
+ */
+void writer_check_deadline(Writer* writer);
+
+/* flush_writer()
+ * --------------
+ * Writes out everything buffered through the writer's flush function.
+ *
+ * writer: the writer to be flushed.
+ *
+ * Returns: true if everything was written, false on a write error, in which
+ * case the output is discarded.
+ */
+bool flush_writer(Writer* writer);
+
+/* write_all()
+ * -----------
+ * The default flush function, which writes the buffer to the writer's file
+ * descriptor, waiting if it is non-blocking and full.
+ *
+ * writer: the writer whose buffer is to be written.
+ *
+ * Returns: true if everything was written, false on a write error.
+ */
+bool write_all(Writer* writer);
+
+/* free_writer()
+ * -------------
+ * Flushes a writer, with any unfinished message, and frees its buffers.
+ *
+ * writer: the writer to be freed.
+ */
+void free_writer(Writer* writer);